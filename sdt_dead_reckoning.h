@@ -1,6 +1,6 @@
 /**
 
-sdt_dead_reckoning.h v1.0
+sdt_dead_reckoning.h v1.1
 By Stephan Soller <stephan.soller@helionweb.de>
 Implementation of the paper "The dead reckoning signed distance transform" by George J. Grevera
 Licensed under the MIT license
@@ -35,9 +35,14 @@ QUICK START
 
 DOCUMENTATION
 
-The library only contains one function:
+The library contains these functions:
 
 	void sdt_dead_reckoning(unsigned int width, unsigned int height, unsigned char threshold,  const unsigned char* image, float* distance_field);
+	void sdt_dead_reckoning_aa(unsigned int width, unsigned int height, const unsigned char* image, float* distance_field);
+	void sdt_dead_reckoning_f32(unsigned int width, unsigned int height, float threshold, const float* image, float* distance_field);
+	void sdt_dead_reckoning_u16(unsigned int width, unsigned int height, uint16_t threshold, const uint16_t* image, float* distance_field);
+	void sdt_dead_reckoning_multi(unsigned int width, unsigned int height, unsigned int threshold_count, const unsigned char* thresholds, const unsigned char* image, float* distance_fields);
+	void sdt_text_effects(unsigned int width, unsigned int height, const unsigned char* mask, const struct sdt_text_effect* effect, unsigned char* rgba);
 
 - `width` and `height` are the dimensions of the input bitmap and output distance field.
 - `threshold` defines which pixels of `image` are interpreted as inside or outside. Pixels greater than `threshold` are
@@ -47,7 +52,51 @@ The library only contains one function:
   bytes in total). It is overwritten with the finished distance field. The distance field is returned as floats so you
   can decide for yourself how to map the field into your target format (e.g. an 8 bit image or half-float).
 
-The function mallocs internal buffers. If that turns out to be a bottleneck feel free to move that out of the function.
+sdt_dead_reckoning_aa() works the same but interprets `image` as an anti-aliased coverage mask (e.g. a glyph rendered
+with anti-aliasing). It has no threshold, the outline is where the coverage is 50% (pixels > 127 are inside). Instead of
+snapping the outline to the pixel grid it uses the coverage of the partially covered edge pixels to place the outline at
+a sub-pixel position before the distances are propagated (see "Anti-aliased Euclidean distance transform" by Stefan
+Gustavson and Robin Strand). This gives you distances accurate to a fraction of a pixel instead of about half a pixel,
+so you can generate distance fields of the same quality at a lower resolution. Hard edges in the mask (fully covered
+pixels right next to uncovered ones) are placed half way between the two pixels.
+
+sdt_dead_reckoning_f32() and sdt_dead_reckoning_u16() take float or 16 bit images (e.g. density or height fields) and a
+`threshold` of the same type. Pixels greater than `threshold` are inside. Since these images usually contain smooth
+values the outline isn't snapped to the pixel grid. Instead the iso-contour is placed at a sub-pixel position between
+each inside and outside pixel by linearly interpolating their values (just like marching squares does). Only pixels
+within the image are used for that, so areas that touch the image border don't get an outline there.
+
+sdt_dead_reckoning_multi() creates one distance field for each of the `threshold_count` thresholds in `thresholds`
+(e.g. for contour lines of a height map). The result is the same as calling sdt_dead_reckoning() once for each threshold
+but all distance fields are calculated in one go. The image is read once for all thresholds and the state of all
+distance fields is interleaved in memory. Most of the time is spent propagating the distances though, and that's the
+same work as with separate calls. So don't expect it to be faster than calling sdt_dead_reckoning() for each threshold.
+With many thresholds the larger interleaved buffers can even make it a bit slower. `distance_fields` has to be large
+enough for `threshold_count` distance fields (width * height * threshold_count * sizeof(float) bytes). They're stored
+one after the other, the distance field for `thresholds[n]` starts at `distance_fields + n * width * height`.
+
+sdt_text_effects() renders text effects for an anti-aliased glyph mask in one go. Usually you would create a distance
+field for the outline and then blur thresholded copies of the mask for the glow and the drop shadow. Instead the
+function creates the distance field with sdt_dead_reckoning_aa() and derives all layers from it in a single pass over
+the field. The result is written as 8 bit RGBA (straight alpha) into `rgba` (width * height * 4 bytes). The layers are
+configured with a `struct sdt_text_effect` (set the colors alpha or the size of a layer to 0 to disable it):
+
+	struct sdt_text_effect effect = {
+		.fill_color = { 255, 255, 255, 255 },
+		.outline_color = { 0, 0, 0, 255 }, .outline_width = 2,
+		.glow_color = { 255, 200, 0, 192 }, .glow_sigma = 4,
+		.shadow_color = { 0, 0, 0, 128 }, .shadow_offset_x = 3, .shadow_offset_y = 3, .shadow_sigma = 2
+	};
+	uint8_t* rgba = malloc(width * height * 4);
+	sdt_text_effects(width, height, mask, &effect, rgba);
+
+The layers are composited from back to front: shadow, glow, outline and fill. The glow and shadow are a gauss blur (with
+`glow_sigma` and `shadow_sigma`) of the outlined glyph. A gauss blurred edge is just the error function of the distance
+to it, so both are calculated directly from the distance field (exact for straight edges, a close approximation for
+corners). No extra buffers or passes are needed and only pixels within 4 sigma of the outline do any work at all. The
+shadow is a hard shadow if `shadow_sigma` is 0.
+
+The functions malloc internal buffers. If that turns out to be a bottleneck feel free to move that out of the function.
 The source code is quite short and straight forward (even if the math isn't). A look at the paper might help, too.
 
 The function is an implementation of the paper "The dead reckoning signed distance transform" by George J. Grevera. The
@@ -70,15 +119,36 @@ This implementation differs from the paper pseudo-code and C++ implementation in
 VERSION HISTORY
 
 v1.0  2018-08-31  Initial release
+v1.1  2026-10-17  ADD: sdt_dead_reckoning_aa() to create sub-pixel accurate distance fields from anti-aliased masks.
+                  ADD: sdt_dead_reckoning_f32() and sdt_dead_reckoning_u16() for float and 16 bit images.
+                  ADD: sdt_text_effects() to render fill, outline, glow and shadow of a glyph in one pass.
+                  ADD: sdt_dead_reckoning_multi() to create distance fields for multiple thresholds at once.
 
 **/
 #ifndef SDT_DEAD_RECKONING_HEADER
 #define SDT_DEAD_RECKONING_HEADER
+#include <stdint.h>
 #ifdef __cplusplus
 	extern "C" {
 #endif
 
 void sdt_dead_reckoning(unsigned int width, unsigned int height, unsigned char threshold,  const unsigned char* image, float* distance_field);
+void sdt_dead_reckoning_aa(unsigned int width, unsigned int height, const unsigned char* image, float* distance_field);
+void sdt_dead_reckoning_f32(unsigned int width, unsigned int height, float threshold, const float* image, float* distance_field);
+void sdt_dead_reckoning_u16(unsigned int width, unsigned int height, uint16_t threshold, const uint16_t* image, float* distance_field);
+void sdt_dead_reckoning_multi(unsigned int width, unsigned int height, unsigned int threshold_count, const unsigned char* thresholds, const unsigned char* image, float* distance_fields);
+
+struct sdt_text_effect {
+	unsigned char fill_color[4];
+	unsigned char outline_color[4];
+	float outline_width;
+	unsigned char glow_color[4];
+	float glow_sigma;
+	unsigned char shadow_color[4];
+	float shadow_offset_x, shadow_offset_y;
+	float shadow_sigma;
+};
+void sdt_text_effects(unsigned int width, unsigned int height, const unsigned char* mask, const struct sdt_text_effect* effect, unsigned char* rgba);
 
 #ifdef __cplusplus
 	}
@@ -89,6 +159,154 @@ void sdt_dead_reckoning(unsigned int width, unsigned int height, unsigned char t
 #include <stdlib.h>
 #include <math.h>
 
+/**
+ * Internal function that performs the two passes of the dead reckoning algorithm. All buffers are padded by 1px and
+ * padded_width * padded_height elements large. Pixels on the border have to be initialized with the position of their
+ * border point (px and py) and the distance to it (padded_distance_field). All other pixels have to be initialized with
+ * a distance of INFINITY.
+ * 
+ * `levels` is the number of independent distance fields that are propagated at once (see sdt_dead_reckoning_multi()).
+ * The buffers then contain `levels` interleaved values for each pixel.
+ */
+static void sdt__propagate(unsigned int padded_width, unsigned int padded_height, unsigned int levels, float* px, float* py, float* padded_distance_field) {
+	#pragma push_macro("D")
+	#pragma push_macro("PX")
+	#pragma push_macro("PY")
+	#pragma push_macro("LENGTH")
+	// The state of all levels of a pixel is interleaved, l is the current level
+	#define D(x, y) padded_distance_field[((x) + (y) * padded_width) * levels + l]
+	#define PX(x, y) px[((x) + (y) * padded_width) * levels + l]
+	#define PY(x, y) py[((x) + (y) * padded_width) * levels + l]
+	// We use a macro instead of the hypotf() function because it's a major performance boost (~26ms down to ~17ms)
+	#define LENGTH(x, y) sqrtf((x)*(x) + (y)*(y))
+	
+	// Horizontal (dx), vertical (dy) and diagonal (dxy) distances between pixels
+	const float dx = 1.0, dy = 1.0, dxy = 1.4142135623730950488 /* sqrtf(2) */;
+	
+	// Perform the first pass
+	// We iterate over the padded internal buffers but skip the outermost pixel because we look 1px into each direction
+	for(unsigned int y = 1; y < padded_height-1; y++) {
+		for(unsigned int x = 1; x < padded_width-1; x++) {
+			for(unsigned int l = 0; l < levels; l++) {
+				if ( D(x-1, y-1) + dxy < D(x, y) ) {
+					PX(x, y) = PX(x-1, y-1);
+					PY(x, y) = PY(x-1, y-1);
+					D(x, y) = LENGTH(x - PX(x, y), y - PY(x, y));
+				}
+				if ( D(x, y-1) + dy < D(x, y) ) {
+					PX(x, y) = PX(x, y-1);
+					PY(x, y) = PY(x, y-1);
+					D(x, y) = LENGTH(x - PX(x, y), y - PY(x, y));
+				}
+				if ( D(x+1, y-1) + dxy < D(x, y) ) {
+					PX(x, y) = PX(x+1, y-1);
+					PY(x, y) = PY(x+1, y-1);
+					D(x, y) = LENGTH(x - PX(x, y), y - PY(x, y));
+				}
+				if ( D(x-1, y) + dx < D(x, y) ) {
+					PX(x, y) = PX(x-1, y);
+					PY(x, y) = PY(x-1, y);
+					D(x, y) = LENGTH(x - PX(x, y), y - PY(x, y));
+				}
+			}
+		}
+	}
+	
+	// Perform the final pass
+	for(unsigned int y = padded_height-2; y >= 1; y--) {
+		for(unsigned int x = padded_width-2; x >= 1; x--) {
+			for(unsigned int l = 0; l < levels; l++) {
+				if ( D(x+1, y) + dx < D(x, y) ) {
+					PX(x, y) = PX(x+1, y);
+					PY(x, y) = PY(x+1, y);
+					D(x, y) = LENGTH(x - PX(x, y), y - PY(x, y));
+				}
+				if ( D(x-1, y+1) + dxy < D(x, y) ) {
+					PX(x, y) = PX(x-1, y+1);
+					PY(x, y) = PY(x-1, y+1);
+					D(x, y) = LENGTH(x - PX(x, y), y - PY(x, y));
+				}
+				if ( D(x, y+1) + dy < D(x, y) ) {
+					PX(x, y) = PX(x, y+1);
+					PY(x, y) = PY(x, y+1);
+					D(x, y) = LENGTH(x - PX(x, y), y - PY(x, y));
+				}
+				if ( D(x+1, y+1) + dx < D(x, y) ) {
+					PX(x, y) = PX(x+1, y+1);
+					PY(x, y) = PY(x+1, y+1);
+					D(x, y) = LENGTH(x - PX(x, y), y - PY(x, y));
+				}
+			}
+		}
+	}
+	
+	#pragma pop_macro("D")
+	#pragma pop_macro("PX")
+	#pragma pop_macro("PY")
+	#pragma pop_macro("LENGTH")
+}
+
+/**
+ * Internal function that works like sdt__propagate() but for border points at sub-pixel positions (see
+ * sdt_dead_reckoning_aa()). The paper only takes the border point of a neighbor if the neighbors distance plus the
+ * distance to the neighbor is smaller than the current distance. That works well when all border pixels start with a
+ * distance of 0. But with sub-pixel border points it often misses a closer border point of a neighbor. So this function
+ * compares the actual distance to the neighbors border point instead. It also sweeps each row a second time in the
+ * opposite direction so border points can travel to the left and right in both passes. Otherwise a border point can
+ * only reach some pixels via diagonal neighbors and the result can be off by more than a pixel far away from the
+ * outline. That's a bit slower but gives proper results for sub-pixel border points.
+ */
+static void sdt__propagate_exact(unsigned int padded_width, unsigned int padded_height, float* px, float* py, float* padded_distance_field) {
+	#pragma push_macro("D")
+	#pragma push_macro("PX")
+	#pragma push_macro("PY")
+	#pragma push_macro("LENGTH")
+	#pragma push_macro("CLOSER")
+	#pragma push_macro("TAKE")
+	#define D(x, y) padded_distance_field[(x) + (y) * (padded_width)]
+	#define PX(x, y) px[(x) + (y) * padded_width]
+	#define PY(x, y) py[(x) + (y) * padded_width]
+	#define LENGTH(x, y) sqrtf((x)*(x) + (y)*(y))
+	// True if the border point of the neighbor nx, ny is closer than the current border point of x, y
+	#define CLOSER(nx, ny) ( D(nx, ny) < INFINITY && \
+		(x - PX(nx, ny))*(x - PX(nx, ny)) + (y - PY(nx, ny))*(y - PY(nx, ny)) < D(x, y)*D(x, y) )
+	// Use the border point of the neighbor nx, ny if it is closer
+	#define TAKE(nx, ny) if ( CLOSER(nx, ny) ) { \
+		PX(x, y) = PX(nx, ny); \
+		PY(x, y) = PY(nx, ny); \
+		D(x, y) = LENGTH(x - PX(x, y), y - PY(x, y)); \
+	}
+	
+	for(unsigned int y = 1; y < padded_height-1; y++) {
+		for(unsigned int x = 1; x < padded_width-1; x++) {
+			TAKE(x-1, y-1);
+			TAKE(x, y-1);
+			TAKE(x+1, y-1);
+			TAKE(x-1, y);
+		}
+		for(unsigned int x = padded_width-2; x >= 1; x--)
+			TAKE(x+1, y);
+	}
+	
+	for(unsigned int y = padded_height-2; y >= 1; y--) {
+		for(unsigned int x = padded_width-2; x >= 1; x--) {
+			TAKE(x+1, y);
+			TAKE(x-1, y+1);
+			TAKE(x, y+1);
+			TAKE(x+1, y+1);
+		}
+		for(unsigned int x = 1; x < padded_width-1; x++)
+			TAKE(x-1, y);
+	}
+	
+	#pragma pop_macro("D")
+	#pragma pop_macro("PX")
+	#pragma pop_macro("PY")
+	#pragma pop_macro("LENGTH")
+	#pragma pop_macro("CLOSER")
+	#pragma pop_macro("TAKE")
+}
+
 void sdt_dead_reckoning(unsigned int width, unsigned int height, unsigned char threshold,  const unsigned char* image, float* distance_field) {
 	// The internal buffers have a 1px padding around them so we can avoid border checks in the loops below
 	unsigned int padded_width = width + 2;
@@ -96,8 +314,8 @@ void sdt_dead_reckoning(unsigned int width, unsigned int height, unsigned char t
 	
 	// px and py store the corresponding border point for each pixel (just p in the paper, here x and y
 	// are separated into px and py).
-	int* px = (int*)malloc(padded_width * padded_height * sizeof(px[0]));
-	int* py = (int*)malloc(padded_width * padded_height * sizeof(py[0]));
+	float* px = (float*)malloc(padded_width * padded_height * sizeof(px[0]));
+	float* py = (float*)malloc(padded_width * padded_height * sizeof(py[0]));
 	float* padded_distance_field = (float*)malloc(padded_width * padded_height * sizeof(padded_distance_field[0]));
 	
 	// Create macros as local shorthands to access the buffers. Push (and later restore) any previous macro definitions so we
@@ -107,15 +325,12 @@ void sdt_dead_reckoning(unsigned int width, unsigned int height, unsigned char t
 	#pragma push_macro("D")
 	#pragma push_macro("PX")
 	#pragma push_macro("PY")
-	#pragma push_macro("LENGTH")
 	// image is unpadded so x and y are in the range 0..width-1 and 0..height-1
 	#define I(x, y) (image[(x) + (y) * width] > threshold)
 	// The internal buffers are padded x and y are in the range 0..padded_width-1 and 0..padded_height-1
 	#define D(x, y) padded_distance_field[(x) + (y) * (padded_width)]
 	#define PX(x, y) px[(x) + (y) * padded_width]
 	#define PY(x, y) py[(x) + (y) * padded_width]
-	// We use a macro instead of the hypotf() function because it's a major performance boost (~26ms down to ~17ms)
-	#define LENGTH(x, y) sqrtf((x)*(x) + (y)*(y))
 	
 	// Initialize internal buffers
 	for(unsigned int y = 0; y < padded_height; y++) {
@@ -143,80 +358,400 @@ void sdt_dead_reckoning(unsigned int width, unsigned int height, unsigned char t
 		}
 	}
 	
-	// Horizontal (dx), vertical (dy) and diagonal (dxy) distances between pixels
-	const float dx = 1.0, dy = 1.0, dxy = 1.4142135623730950488 /* sqrtf(2) */;
+	sdt__propagate(padded_width, padded_height, 1, px, py, padded_distance_field);
 	
-	// Perform the first pass
-	// We iterate over the padded internal buffers but skip the outermost pixel because we look 1px into each direction
-	for(unsigned int y = 1; y < padded_height-1; y++) {
-		for(unsigned int x = 1; x < padded_width-1; x++) {
-			if ( D(x-1, y-1) + dxy < D(x, y) ) {
-				PX(x, y) = PX(x-1, y-1);
-				PY(x, y) = PY(x-1, y-1);
-				D(x, y) = LENGTH(x - PX(x, y), y - PY(x, y));
-			}
-			if ( D(x, y-1) + dy < D(x, y) ) {
-				PX(x, y) = PX(x, y-1);
-				PY(x, y) = PY(x, y-1);
-				D(x, y) = LENGTH(x - PX(x, y), y - PY(x, y));
-			}
-			if ( D(x+1, y-1) + dxy < D(x, y) ) {
-				PX(x, y) = PX(x+1, y-1);
-				PY(x, y) = PY(x+1, y-1);
-				D(x, y) = LENGTH(x - PX(x, y), y - PY(x, y));
-			}
-			if ( D(x-1, y) + dx < D(x, y) ) {
-				PX(x, y) = PX(x-1, y);
-				PY(x, y) = PY(x-1, y);
-				D(x, y) = LENGTH(x - PX(x, y), y - PY(x, y));
+	// Set the proper sign for inside and outside and write the result into the output distance field
+	for(unsigned int y = 0; y < height; y++) {
+		for(unsigned int x = 0; x < width; x++) {
+			float sign = I(x, y) ? -1 : 1;
+			distance_field[x + y*width] = D(x+1, y+1) * sign;
+		}
+	}
+	
+	// Restore macros and free internal buffers
+	#pragma pop_macro("I")
+	#pragma pop_macro("D")
+	#pragma pop_macro("PX")
+	#pragma pop_macro("PY")
+	
+	free(padded_distance_field);
+	free(px);
+	free(py);
+}
+
+void sdt_dead_reckoning_multi(unsigned int width, unsigned int height, unsigned int threshold_count, const unsigned char* thresholds, const unsigned char* image, float* distance_fields) {
+	unsigned int padded_width = width + 2;
+	unsigned int padded_height = height + 2;
+	unsigned int levels = threshold_count;
+	
+	// The internal buffers contain the state of all levels (one for each threshold) interleaved for each pixel
+	float* px = (float*)malloc(padded_width * padded_height * levels * sizeof(px[0]));
+	float* py = (float*)malloc(padded_width * padded_height * levels * sizeof(py[0]));
+	float* padded_distance_field = (float*)malloc(padded_width * padded_height * levels * sizeof(padded_distance_field[0]));
+	
+	#pragma push_macro("D")
+	#pragma push_macro("PX")
+	#pragma push_macro("PY")
+	// Same as in sdt_dead_reckoning() but for level l
+	#define D(x, y) padded_distance_field[((x) + (y) * padded_width) * levels + l]
+	#define PX(x, y) px[((x) + (y) * padded_width) * levels + l]
+	#define PY(x, y) py[((x) + (y) * padded_width) * levels + l]
+	
+	for(unsigned int y = 0; y < padded_height; y++) {
+		for(unsigned int x = 0; x < padded_width; x++) {
+			for(unsigned int l = 0; l < levels; l++) {
+				D(x, y) = INFINITY;
+				PX(x, y) = -1;
+				PY(x, y) = -1;
 			}
 		}
 	}
 	
-	// Perform the final pass
-	for(unsigned int y = padded_height-2; y >= 1; y--) {
-		for(unsigned int x = padded_width-2; x >= 1; x--) {
-			if ( D(x+1, y) + dx < D(x, y) ) {
-				PX(x, y) = PX(x+1, y);
-				PY(x, y) = PY(x+1, y);
-				D(x, y) = LENGTH(x - PX(x, y), y - PY(x, y));
+	// Load a pixel and its neighbors only once and then check them against all thresholds. A pixel is on the border of
+	// a level if it's inside (> threshold) and at least one neighbor isn't. That is the case when the darkest neighbor
+	// is <= threshold.
+	for(unsigned int y = 1; y < height-2; y++) {
+		for(unsigned int x = 1; x < width-2; x++) {
+			unsigned char center = image[x + y * width];
+			unsigned char darkest_neighbor = image[(x-1) + y * width];
+			if (image[(x+1) + y * width] < darkest_neighbor)
+				darkest_neighbor = image[(x+1) + y * width];
+			if (image[x + (y-1) * width] < darkest_neighbor)
+				darkest_neighbor = image[x + (y-1) * width];
+			if (image[x + (y+1) * width] < darkest_neighbor)
+				darkest_neighbor = image[x + (y+1) * width];
+			
+			for(unsigned int l = 0; l < levels; l++) {
+				if ( center > thresholds[l] && darkest_neighbor <= thresholds[l] ) {
+					D(x+1, y+1) = 0;
+					PX(x+1, y+1) = x+1;
+					PY(x+1, y+1) = y+1;
+				}
 			}
-			if ( D(x-1, y+1) + dxy < D(x, y) ) {
-				PX(x, y) = PX(x-1, y+1);
-				PY(x, y) = PY(x-1, y+1);
-				D(x, y) = LENGTH(x - PX(x, y), y - PY(x, y));
+		}
+	}
+	
+	sdt__propagate(padded_width, padded_height, levels, px, py, padded_distance_field);
+	
+	for(unsigned int y = 0; y < height; y++) {
+		for(unsigned int x = 0; x < width; x++) {
+			unsigned char value = image[x + y * width];
+			for(unsigned int l = 0; l < levels; l++) {
+				float sign = (value > thresholds[l]) ? -1 : 1;
+				distance_fields[l * width * height + x + y*width] = D(x+1, y+1) * sign;
 			}
-			if ( D(x, y+1) + dy < D(x, y) ) {
-				PX(x, y) = PX(x, y+1);
-				PY(x, y) = PY(x, y+1);
-				D(x, y) = LENGTH(x - PX(x, y), y - PY(x, y));
+		}
+	}
+	
+	#pragma pop_macro("D")
+	#pragma pop_macro("PX")
+	#pragma pop_macro("PY")
+	
+	free(padded_distance_field);
+	free(px);
+	free(py);
+}
+
+/**
+ * Estimates the distance from the center of an edge pixel to the edge running through it. `gx` and `gy` are the
+ * normalized gradient of the coverage at that pixel and `a` its coverage (0..1). Returns a positive distance for pixels
+ * outside of the edge (a < 0.5) and a negative one for pixels inside.
+ * 
+ * This is the edgedf() function from "Anti-aliased Euclidean distance transform" by Stefan Gustavson and Robin Strand.
+ */
+static float sdt__edge_distance(float gx, float gy, float a) {
+	if (gx == 0 || gy == 0)
+		return 0.5 - a;
+	
+	// The function is symmetric in x and y and only depends on the absolute gradient. So swap the gradient in the first
+	// octant (0 <= gy <= gx) and look at the three cases: The edge cuts a corner of the pixel, runs through the pixel
+	// or cuts the opposite corner.
+	gx = fabsf(gx);
+	gy = fabsf(gy);
+	if (gx < gy) {
+		float temp = gx;
+		gx = gy;
+		gy = temp;
+	}
+	
+	float a1 = 0.5 * gy / gx;
+	if (a < a1)
+		return 0.5 * (gx + gy) - sqrtf(2.0 * gx * gy * a);
+	else if (a < 1.0 - a1)
+		return (0.5 - a) * gx;
+	else
+		return -0.5 * (gx + gy) + sqrtf(2.0 * gx * gy * (1.0 - a));
+}
+
+void sdt_dead_reckoning_aa(unsigned int width, unsigned int height, const unsigned char* image, float* distance_field) {
+	unsigned int padded_width = width + 2;
+	unsigned int padded_height = height + 2;
+	
+	float* px = (float*)malloc(padded_width * padded_height * sizeof(px[0]));
+	float* py = (float*)malloc(padded_width * padded_height * sizeof(py[0]));
+	float* padded_distance_field = (float*)malloc(padded_width * padded_height * sizeof(padded_distance_field[0]));
+	
+	#pragma push_macro("A")
+	#pragma push_macro("INSIDE")
+	#pragma push_macro("HARD")
+	#pragma push_macro("D")
+	#pragma push_macro("PX")
+	#pragma push_macro("PY")
+	// Coverage of a pixel in the range 0..1. Pixels outside of the image have no coverage so we don't need extra checks
+	// for the outermost pixels. x and y are signed here so x-1 and y-1 work at the left and top edge.
+	#define A(x, y) ( ((x) >= 0 && (x) < (int)width && (y) >= 0 && (y) < (int)height) ? image[(x) + (y) * width] / 255.0f : 0.0f )
+	#define INSIDE(x, y) (A(x, y) > 0.5f)
+	// True if a pixel is fully covered or not covered at all
+	#define HARD(x, y) (A(x, y) == 0.0f || A(x, y) == 1.0f)
+	#define D(x, y) padded_distance_field[(x) + (y) * (padded_width)]
+	#define PX(x, y) px[(x) + (y) * padded_width]
+	#define PY(x, y) py[(x) + (y) * padded_width]
+	
+	for(unsigned int y = 0; y < padded_height; y++) {
+		for(unsigned int x = 0; x < padded_width; x++) {
+			D(x, y) = INFINITY;
+			PX(x, y) = -1;
+			PY(x, y) = -1;
+		}
+	}
+	
+	// Place the border points of all edge pixels at their sub-pixel position. Edge pixels are pixels that are partially
+	// covered. The border point of fully covered or uncovered pixels right next to each other (hard edges in the mask)
+	// is placed half way between them. Those next to a partially covered pixel are left alone. They get their border
+	// point from the partially covered pixel during propagation (otherwise we would pull the border to the half way
+	// point).
+	for(int y = 0; y < (int)height; y++) {
+		for(int x = 0; x < (int)width; x++) {
+			float a = A(x, y);
+			int is_edge_pixel = (a > 0.0f && a < 1.0f);
+			if (!is_edge_pixel) {
+				is_edge_pixel = (
+					(INSIDE(x-1, y) != INSIDE(x, y) && HARD(x-1, y))  ||  (INSIDE(x+1, y) != INSIDE(x, y) && HARD(x+1, y))  ||
+					(INSIDE(x, y-1) != INSIDE(x, y) && HARD(x, y-1))  ||  (INSIDE(x, y+1) != INSIDE(x, y) && HARD(x, y+1))
+				);
 			}
-			if ( D(x+1, y+1) + dx < D(x, y) ) {
-				PX(x, y) = PX(x+1, y+1);
-				PY(x, y) = PY(x+1, y+1);
-				D(x, y) = LENGTH(x - PX(x, y), y - PY(x, y));
+			if (!is_edge_pixel)
+				continue;
+			
+			// Sobel gradient of the coverage. It points towards the inside (higher coverage).
+			const float sqrt2 = 1.4142135623730950488;
+			float gx = -A(x-1, y-1) - sqrt2 * A(x-1, y) - A(x-1, y+1) + A(x+1, y-1) + sqrt2 * A(x+1, y) + A(x+1, y+1);
+			float gy = -A(x-1, y-1) - sqrt2 * A(x, y-1) - A(x+1, y-1) + A(x-1, y+1) + sqrt2 * A(x, y+1) + A(x+1, y+1);
+			float glength = sqrtf(gx*gx + gy*gy);
+			if (glength > 0) {
+				gx /= glength;
+				gy /= glength;
 			}
+			
+			// Move from the pixel center along the gradient onto the edge. Without a gradient we can't tell where the
+			// edge is and use the pixel center with the estimated distance.
+			float edge_distance = sdt__edge_distance(gx, gy, a);
+			D(x+1, y+1) = fabsf(edge_distance);
+			PX(x+1, y+1) = x+1 + edge_distance * gx;
+			PY(x+1, y+1) = y+1 + edge_distance * gy;
 		}
 	}
 	
-	// Set the proper sign for inside and outside and write the result into the output distance field
-	for(unsigned int y = 0; y < height; y++) {
-		for(unsigned int x = 0; x < width; x++) {
-			float sign = I(x, y) ? -1 : 1;
+	sdt__propagate_exact(padded_width, padded_height, px, py, padded_distance_field);
+	
+	for(int y = 0; y < (int)height; y++) {
+		for(int x = 0; x < (int)width; x++) {
+			float sign = INSIDE(x, y) ? -1 : 1;
 			distance_field[x + y*width] = D(x+1, y+1) * sign;
 		}
 	}
 	
-	// Restore macros and free internal buffers
-	#pragma pop_macro("I")
+	#pragma pop_macro("A")
+	#pragma pop_macro("INSIDE")
+	#pragma pop_macro("HARD")
 	#pragma pop_macro("D")
 	#pragma pop_macro("PX")
 	#pragma pop_macro("PY")
-	#pragma pop_macro("LENGTH")
 	
 	free(padded_distance_field);
 	free(px);
 	free(py);
 }
 
+/**
+ * Internal function used by sdt_dead_reckoning_f32() and sdt_dead_reckoning_u16(). Places the border point of the
+ * pixel x, y (unpadded coordinates) if the iso-contour runs between it and one of its horizontal or vertical neighbors.
+ * `value` is the value of the pixel and `left`, `right`, `up` and `down` the values of its neighbors. Neighbors outside
+ * of the image have to be set to `value` so the contour never runs through there.
+ * 
+ * If one of the neighbors is on the other side of the threshold the iso-contour runs between them. Interpolate linearly
+ * between both values to find out where exactly. The crossing is usually not the closest point of the contour (e.g.
+ * when it runs diagonally). So we assume the contour runs straight through the crossing, perpendicular to the gradient
+ * of the image, and use the point on that line closest to the pixel center.
+ */
+static void sdt__iso_border_point(unsigned int padded_width, float* px, float* py, float* padded_distance_field, int x, int y, float threshold, float value, float left, float right, float up, float down) {
+	int inside = (value > threshold);
+	
+	// Signed offset to the closest crossing in x and y direction, INFINITY if there is none
+	float cx = INFINITY, cy = INFINITY;
+	if ((left > threshold) != inside)
+		cx = -(threshold - value) / (left - value);
+	if ((right > threshold) != inside) {
+		float t = (threshold - value) / (right - value);
+		if (t < fabsf(cx))
+			cx = t;
+	}
+	if ((up > threshold) != inside)
+		cy = -(threshold - value) / (up - value);
+	if ((down > threshold) != inside) {
+		float t = (threshold - value) / (down - value);
+		if (t < fabsf(cy))
+			cy = t;
+	}
+	
+	if (cx == INFINITY && cy == INFINITY)
+		return;
+	
+	// Gradient with central differences (one sided at the image border since neighbors outside are set to `value`)
+	float gx = right - left;
+	float gy = down - up;
+	float glength = sqrtf(gx*gx + gy*gy);
+	
+	// Use the crossing in the direction the gradient points to most. It's the more reliable one.
+	float ox = 0, oy = 0;
+	if ( cy == INFINITY || (cx != INFINITY && fabsf(gx) >= fabsf(gy)) )
+		ox = cx;
+	else
+		oy = cy;
+	
+	if (glength > 0) {
+		gx /= glength;
+		gy /= glength;
+		float projected = ox * gx + oy * gy;
+		ox = projected * gx;
+		oy = projected * gy;
+	}
+	
+	unsigned int index = (x+1) + (y+1) * padded_width;
+	padded_distance_field[index] = sqrtf(ox*ox + oy*oy);
+	px[index] = x+1 + ox;
+	py[index] = y+1 + oy;
+}
+
+/**
+ * Internal macro that generates sdt_dead_reckoning_f32() and sdt_dead_reckoning_u16(). `name` is the name of the
+ * function and `type` the type of the image pixels and threshold. Each function loads the pixels with their own type so
+ * there is no type dispatch in the loops.
+ */
+#define SDT__DEAD_RECKONING_ISO(name, type)                                                                                 \
+void name(unsigned int width, unsigned int height, type threshold, const type* image, float* distance_field) {             \
+	unsigned int padded_width = width + 2;                                                                                  \
+	unsigned int padded_height = height + 2;                                                                                \
+	                                                                                                                        \
+	float* px = (float*)malloc(padded_width * padded_height * sizeof(px[0]));                                              \
+	float* py = (float*)malloc(padded_width * padded_height * sizeof(py[0]));                                              \
+	float* padded_distance_field = (float*)malloc(padded_width * padded_height * sizeof(padded_distance_field[0]));        \
+	                                                                                                                        \
+	for(unsigned int n = 0; n < padded_width * padded_height; n++) {                                                        \
+		padded_distance_field[n] = INFINITY;                                                                                \
+		px[n] = -1;                                                                                                         \
+		py[n] = -1;                                                                                                         \
+	}                                                                                                                       \
+	                                                                                                                        \
+	/* Neighbors outside of the image are replaced by the pixel itself (see sdt__iso_border_point()) */                     \
+	for(int y = 0; y < (int)height; y++) {                                                                                  \
+		for(int x = 0; x < (int)width; x++) {                                                                               \
+			const type* pixel = image + x + y * width;                                                                      \
+			float value = pixel[0];                                                                                         \
+			float left  = (x > 0)             ? pixel[-1]           : value;                                                \
+			float right = (x < (int)width-1)  ? pixel[1]            : value;                                                \
+			float up    = (y > 0)             ? pixel[-(int)width]  : value;                                                \
+			float down  = (y < (int)height-1) ? pixel[width]        : value;                                                \
+			sdt__iso_border_point(padded_width, px, py, padded_distance_field, x, y, threshold, value, left, right, up, down); \
+		}                                                                                                                   \
+	}                                                                                                                       \
+	                                                                                                                        \
+	sdt__propagate_exact(padded_width, padded_height, px, py, padded_distance_field);                                       \
+	                                                                                                                        \
+	for(unsigned int y = 0; y < height; y++) {                                                                              \
+		for(unsigned int x = 0; x < width; x++) {                                                                           \
+			float sign = (image[x + y * width] > threshold) ? -1 : 1;                                                       \
+			distance_field[x + y*width] = padded_distance_field[(x+1) + (y+1) * padded_width] * sign;                       \
+		}                                                                                                                   \
+	}                                                                                                                       \
+	                                                                                                                        \
+	free(padded_distance_field);                                                                                            \
+	free(px);                                                                                                               \
+	free(py);                                                                                                               \
+}
+
+SDT__DEAD_RECKONING_ISO(sdt_dead_reckoning_f32, float)
+SDT__DEAD_RECKONING_ISO(sdt_dead_reckoning_u16, uint16_t)
+#undef SDT__DEAD_RECKONING_ISO
+
+/**
+ * Internal function for sdt_text_effects(). Returns the coverage of a layer that covers everything with a distance
+ * smaller than `grow`. With a `sigma` > 0 the layer is gauss blurred, otherwise it gets an anti-aliased 1px edge.
+ */
+static float sdt__layer_coverage(float distance, float grow, float sigma) {
+	distance -= grow;
+	if (sigma > 0) {
+		// Only the band within 4 sigma of the edge is blurred, beyond that the error function is 0 or 1 anyway
+		if (distance > 4 * sigma)
+			return 0;
+		else if (distance < -4 * sigma)
+			return 1;
+		return 0.5f * erfcf(distance / (sigma * 1.4142135623730950488f));
+	}
+	return fmaxf(0, fminf(1, 0.5f - distance));
+}
+
+/**
+ * Internal function for sdt_text_effects(). Composites a layer with the color `color` and the coverage `coverage` over
+ * the straight alpha color in `dest`.
+ */
+static void sdt__over(float dest[4], const unsigned char color[4], float coverage) {
+	float alpha = color[3] / 255.0f * coverage;
+	if (alpha <= 0)
+		return;
+	
+	float dest_alpha = dest[3] * (1 - alpha);
+	float out_alpha = alpha + dest_alpha;
+	for(int n = 0; n < 3; n++)
+		dest[n] = (color[n] / 255.0f * alpha + dest[n] * dest_alpha) / out_alpha;
+	dest[3] = out_alpha;
+}
+
+void sdt_text_effects(unsigned int width, unsigned int height, const unsigned char* mask, const struct sdt_text_effect* effect, unsigned char* rgba) {
+	float* distance_field = (float*)malloc(width * height * sizeof(distance_field[0]));
+	sdt_dead_reckoning_aa(width, height, mask, distance_field);
+	
+	for(unsigned int y = 0; y < height; y++) {
+		for(unsigned int x = 0; x < width; x++) {
+			float distance = distance_field[x + y * width];
+			float color[4] = { 0, 0, 0, 0 };
+			
+			if (effect->shadow_color[3] > 0) {
+				// Sample the distance field at the offset position with bilinear filtering, clamped to the image
+				float sx = fmaxf(0, fminf(width - 1, x - effect->shadow_offset_x));
+				float sy = fmaxf(0, fminf(height - 1, y - effect->shadow_offset_y));
+				unsigned int x0 = sx, y0 = sy;
+				unsigned int x1 = (x0 + 1 < width) ? x0 + 1 : x0, y1 = (y0 + 1 < height) ? y0 + 1 : y0;
+				float fx = sx - x0, fy = sy - y0;
+				float top    = distance_field[x0 + y0 * width] * (1 - fx) + distance_field[x1 + y0 * width] * fx;
+				float bottom = distance_field[x0 + y1 * width] * (1 - fx) + distance_field[x1 + y1 * width] * fx;
+				float shadow_distance = top * (1 - fy) + bottom * fy;
+				sdt__over(color, effect->shadow_color, sdt__layer_coverage(shadow_distance, effect->outline_width, effect->shadow_sigma));
+			}
+			
+			if (effect->glow_color[3] > 0 && effect->glow_sigma > 0)
+				sdt__over(color, effect->glow_color, sdt__layer_coverage(distance, effect->outline_width, effect->glow_sigma));
+			if (effect->outline_color[3] > 0 && effect->outline_width > 0)
+				sdt__over(color, effect->outline_color, sdt__layer_coverage(distance, effect->outline_width, 0));
+			if (effect->fill_color[3] > 0)
+				sdt__over(color, effect->fill_color, sdt__layer_coverage(distance, 0, 0));
+			
+			for(int n = 0; n < 4; n++)
+				rgba[(x + y * width) * 4 + n] = color[n] * 255 + 0.5f;
+		}
+	}
+	
+	free(distance_field);
+}
+
 #endif  // SDT_DEAD_RECKONING_IMPLEMENTATION
\ No newline at end of file
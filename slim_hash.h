@@ -1,6 +1,6 @@
 /**
 
-Slim Hash v1.1
+Slim Hash v1.2
 By Stephan Soller <stephan.soller@helionweb.de>
 Licensed under the MIT license
 
@@ -10,7 +10,8 @@ new type of hashmap you want.
 
 It uses closed hashing, meaning that all data is stored in one contiguous memory block. In case of
 collisions linear probing is used as it's more cache friendly and there is no need to calculate
-prime numbers for the hashmap size.
+prime numbers for the hashmap size. Optionally Robin Hood hashing or SwissTable like groups of
+control bytes can be used instead (see USAGE).
 
 
 EXAMPLE
@@ -95,16 +96,46 @@ dict_it_p (it for iterator and _p because it's a pointer type). If you don't wan
 concerned about possible conflicts with POSIX types you can define SLIM_HASH_NO_TYPEDEFS before
 including the library. In that case no typedefs will be generated.
 
+To collect statistics about resizing you can define SH_RESIZE_STATS(name, old_capacity,
+new_capacity, length, seconds) before including the library. It is called after each resize of a
+hashmap with the name of the hashmap (as string), the capacities before and after, the number of
+items and the time the resize took in seconds (measured with clock()):
+
+    #define SH_RESIZE_STATS(name, old_capacity, new_capacity, length, seconds)  \
+        fprintf(stderr, "%s: %llu -> %llu in %f s\n", name, (unsigned long long)old_capacity,  \
+            (unsigned long long)new_capacity, seconds)
+
+By default a hashmap grows to twice its capacity when it gets more than half full and shrinks when
+less than a quarter of it is used. Use ..._set_load_factors() to change that for one hashmap, e.g.
+a max load of 0.9 for hashmaps that should use little memory or a min load of 0 to never shrink.
+Define SH_MAX_LOAD, SH_MIN_LOAD and SH_GROWTH_FACTOR before including the library to change the
+defaults for all hashmaps.
+
+Capacities, lengths and the hashes stored in the slots are 32 bit by default (sh_size_t and
+sh_hash_t). That limits a hashmap to a capacity of 2^31 slots. For larger hashmaps (e.g. billions of
+keys) define SLIM_HASH_64BIT before including the library, in every file that uses the hashmaps.
+Both types are then 64 bit and the hash of each slot takes 4 bytes more (often just filling
+padding). The hashes have to be 64 bit as well, so sh_int_hash() returns all 64 bits and the
+hashmaps hash byte strings with sh_wyhash() instead of sh_murmur3() (see sh_bytes_hash()). Use a 64
+bit hash like sh_bytes_hash() for your own key_hash_expr.
+
 For most cases you can use the SH_GEN_HASH_IMPL() or SH_GEN_DICT_IMPL() macros to generate the
 implementation. They take the same 3 paramters as SH_GEN_DECL() but generate the actual functions
 instead of just the prototypes.
 
 SH_GEN_DICT_IMPL() generates code for a hashmap that uses string keys. It'll use strlen() and
-sh_murmur3() to hash the keys. strcmp() is used to compare keys and strdup() to duplicate the keys
-when you insert a new key.
+sh_bytes_hash() (sh_murmur3()) to hash the keys. strcmp() is used to compare keys and strdup() to
+duplicate the keys when you insert a new key.
 
-SH_GEN_HASH_IMPL() on the other hand generates code that simply hashes any value type with murmur3.
-it uses the == operator to compare keys. This works for key types like int, float, etc.
+SH_GEN_HASH_IMPL() on the other hand generates code that simply hashes any value type with
+sh_value_hash(). It uses the == operator to compare keys. This works for key types like int, float,
+etc. Keys with 1, 2, 4 or 8 bytes are hashed with a few multiplications and shifts (sh_int_hash()),
+larger ones with sh_bytes_hash(). For integer keys the hash then takes just a few cycles per lookup.
+
+sh_wyhash() and sh_xxhash() are faster 64 bit hash functions you can use as key_hash_expr of
+SH_GEN_IMPL() (the hashmaps use the lower 32 bits unless SLIM_HASH_64BIT is defined). sh_wyhash()
+is the best choice for most keys, sh_xxhash() for keys with a few KiB. Run "make bench" to compare
+the throughput and distribution of all hash functions for different key sizes on your machine.
 
 SH_GEN_IMPL() is a all purpose most flexible way to generate a hash implementation. But it requires
 some code snippets (expressions) to do so. These snippets specify how to calculate the hash, what to
@@ -133,6 +164,79 @@ See the SH_GEN_IMPL() documentation below for more details on the different expr
 SH_GEN_HASH_IMPL() and SH_GEN_DICT_IMPL() are simple shorthands for that macro with code snippes for
 the two most common kinds of hashmaps.
 
+SH_GEN_RH_HASH_IMPL(), SH_GEN_RH_DICT_IMPL() and SH_GEN_RH_IMPL() take the same arguments but
+generate a hashmap that uses Robin Hood hashing with backward shift deletion. Lookups of missing
+keys stop early and deleting keys doesn't leave deleted slots behind. Use them for hashmaps that
+are filled up quite a bit or where many keys are inserted and deleted. The declaration and public
+API stay the same (use SH_GEN_DECL()). See the SH_GEN_RH_IMPL() documentation for details.
+
+SH_GEN_SWISS_HASH_IMPL(), SH_GEN_SWISS_DICT_IMPL() and SH_GEN_SWISS_IMPL() generate a hashmap that
+keeps a separate control byte with 7 bits of the hash for each slot. Lookups compare 16 control
+bytes at once (with SSE2 or NEON if available) and only touch the slots that match. This reduces
+the memory accessed by each lookup and works best for large hashmaps that don't fit into the
+cache. See the SH_GEN_SWISS_IMPL() documentation for details.
+
+Hashmaps declared with SH_GEN_SOA_DECL() instead of SH_GEN_DECL() store the hashes, keys and values
+in three separate arrays. Probing then only scans the hashes and keys and just the matching value
+is touched. Useful for large values. Generate the implementation with SH_GEN_SOA_HASH_IMPL(),
+SH_GEN_SOA_DICT_IMPL() or SH_GEN_SOA_IMPL() (same arguments as the other macros). The API is the
+same except for iteration, see the SH_GEN_SOA_DECL() documentation.
+
+For sets of keys without any values use SH_GEN_SET_DECL() together with SH_GEN_SET_HASH_IMPL(),
+SH_GEN_SET_DICT_IMPL() or SH_GEN_SET_IMPL(). Their slots don't waste any memory on a dummy value.
+Instead of ..._get() and ..._put() they have ..._insert() and ..._contains(), as well as
+..._union() and ..._intersect() to combine two sets. See the SH_GEN_SET_DECL() documentation.
+
+SH_GEN_INCREMENTAL_HASH_IMPL(), SH_GEN_INCREMENTAL_DICT_IMPL() and SH_GEN_INCREMENTAL_IMPL()
+generate a hashmap that doesn't move all items at once when it's resized. Instead each ..._put()
+and ..._del() moves a few of them. This avoids the long pauses when a large hashmap grows. Declare
+them with SH_GEN_INCREMENTAL_DECL(), see the SH_GEN_INCREMENTAL_IMPL() documentation for details.
+
+SH_GEN_STR_DICT_DECL() and SH_GEN_STR_DICT_IMPL() generate a dictionary with struct sh_str keys (a
+pointer and a length). The keys don't need to be zero terminated and additional ..._n() functions
+take a pointer and a length, e.g. words_get_n(&words, token, token_length, 0). This way tokens can
+be looked up right in the buffer they were parsed from.
+
+SH_GEN_ARENA_DICT_DECL() and SH_GEN_ARENA_DICT_IMPL() generate a dictionary that copies its keys
+into large memory chunks owned by the dictionary instead of using one malloc() per key. Destroying
+it just frees the chunks. See the SH_GEN_ARENA_DICT_IMPL() documentation for details.
+
+SH_GEN_SSO_DICT_DECL() and SH_GEN_SSO_DICT_IMPL() generate a dictionary with small-string keys
+(struct sh_sso). Keys with up to 15 chars are stored right in the slots, so comparing them doesn't
+need to follow a pointer. Longer keys are stored on the heap. Create the keys with sh_sso_from(),
+e.g. tags_get(&tags, sh_sso_from("de"), 0).
+
+SH_GEN_CONCURRENT_DECL() and SH_GEN_CONCURRENT_IMPL() generate a hashmap that can be shared by many
+threads. It's split into shards, each a normal hashmap with its own reader/writer lock. So lookups
+run in parallel and writes only block threads that use the same shard. Define SLIM_HASH_CONCURRENT
+before including the library to use it (needs pthreads). See the SH_GEN_CONCURRENT_DECL()
+documentation for details.
+
+For tables that are filled by many threads at once and only read afterwards there are
+SH_GEN_ATOMIC_DECL() and SH_GEN_ATOMIC_IMPL(). They generate an insert-only table with a fixed
+capacity that doesn't use any locks. Inserts claim slots with atomic compare-and-swap and readers
+never wait. ..._build_from_arrays() builds such a table from arrays of keys and values with as many
+threads as you like. Also needs SLIM_HASH_CONCURRENT.
+
+To aggregate data with many threads (e.g. word counts) each thread can fill its own hashmap. Then
+..._merge() merges them into one hashmap and calls a function you provide for keys that are in
+both (e.g. to add up the counts). ..._reduce() of a SH_GEN_CONCURRENT_DECL() hashmap merges many
+hashmaps at once with several threads, each one responsible for a different hash range (a range
+of shards).
+
+Hashmaps with keys and values without pointers (integers, floats, structs of them, ...) can be
+saved into a file with ..._save() and opened again with ..._open_mmap(). The file is mapped into
+memory read-only instead of inserting every item again, so opening even a large hashmap takes no
+time and processes that open the same file share its memory. Close it with ..._close_mmap(). Define
+SLIM_HASH_MMAP before including the library to use it (needs POSIX mmap()). The dictionaries
+(SH_GEN_DICT_IMPL() and its variants) don't get these functions since their keys are pointers.
+
+For data that is built once and then only looked up (e.g. a dictionary loaded at startup) there are
+frozen tables. SH_GEN_FROZEN_DECL() and SH_GEN_FROZEN_IMPL() generate a read-only table that is
+built from a filled hashmap. It uses a minimal perfect hash function, so it needs only as many
+items as there are keys plus about one byte per key and every lookup compares just one key. See
+the SH_GEN_FROZEN_DECL() documentation for details.
+
 
 THE PUBLIC API
 
@@ -140,7 +244,7 @@ This is the API declared by SH_GEN_DECL(dict, char*, int). Hashmaps with a diffe
 course have different type names and function prefixes.
 
     struct dict {
-        uint32_t length, capacity;
+        sh_size_t length, capacity;
         // Some internal fields
     };
     struct dict_slot {
@@ -154,7 +258,12 @@ course have different type names and function prefixes.
     typedef struct dict_slot *dict_it_p;
     
     void  dict_new(struct dict* hashmap);
+    bool  dict_new_with_capacity(struct dict* hashmap, size_t length);
+    bool  dict_build_from_arrays(struct dict* hashmap, char** keys, int* values, size_t count);
     void  dict_destroy(struct dict* hashmap);
+    bool  dict_reserve(struct dict* hashmap, size_t length);
+    bool  dict_set_load_factors(struct dict* hashmap, float max_load, float min_load,
+              uint32_t growth_factor);
     
     int   dict_get(struct dict* hashmap, char* key, int default_value);
     void  dict_put(struct dict* hashmap, char* key, int value);
@@ -163,6 +272,19 @@ course have different type names and function prefixes.
     
     int*  dict_get_ptr(struct dict* hashmap, char* key);
     int*  dict_put_ptr(struct dict* hashmap, char* key);
+    int*  dict_upsert(struct dict* hashmap, char* key, bool* inserted);
+    
+    size_t  dict_get_many(struct dict* hashmap, char** keys, size_t count, int** values);
+    bool    dict_put_many(struct dict* hashmap, char** keys, int* values, size_t count);
+    
+    bool  dict_merge(struct dict* dst, struct dict* src,
+              void (*combine)(int* dst_value, int src_value, void* data), void* data);
+    
+    // Only with SLIM_HASH_MMAP and for keys and values without pointers (not generated by
+    // SH_GEN_DICT_IMPL() and the other dictionaries)
+    bool  dict_save(struct dict* hashmap, const char* path);
+    bool  dict_open_mmap(struct dict* hashmap, const char* path);
+    void  dict_close_mmap(struct dict* hashmap);
     
     struct dict_slot*  dict_start(struct dict* hashmap);
     struct dict_slot*  dict_next(struct dict* hashmap, struct dict_slot* it);
@@ -194,6 +316,65 @@ v1.1  2017-07-12  ADD: Added the fnv1a 32 bit hash function (see sh_fnv1a() docu
                        and definition. IMPL (implementation) makes more clear what the macros
                        generate.
                   FIX: Added missing prototypes for functions shared by all implementations.
+v1.2  2026-10-17  ADD: Robin Hood hashing with backward shift deletion via SH_GEN_RH_IMPL(),
+                       SH_GEN_RH_HASH_IMPL() and SH_GEN_RH_DICT_IMPL().
+                  ADD: SwissTable like probing of control byte groups via SH_GEN_SWISS_IMPL(),
+                       SH_GEN_SWISS_HASH_IMPL() and SH_GEN_SWISS_DICT_IMPL().
+                  ADD: Hashmaps with separate hash, key and value arrays via SH_GEN_SOA_DECL(),
+                       SH_GEN_SOA_IMPL(), SH_GEN_SOA_HASH_IMPL() and SH_GEN_SOA_DICT_IMPL().
+                  ADD: ..._get_many() and ..._put_many() to look up or insert many keys at once.
+                       They prefetch the slots of a few keys ahead so the cache misses overlap.
+                  ADD: SH_RESIZE_STATS() hook to collect statistics about resizing.
+                  ADD: Incremental resizing via SH_GEN_INCREMENTAL_DECL(),
+                       SH_GEN_INCREMENTAL_IMPL(), SH_GEN_INCREMENTAL_HASH_IMPL() and
+                       SH_GEN_INCREMENTAL_DICT_IMPL().
+                  ADD: ..._new_with_capacity(), ..._reserve() and ..._build_from_arrays() to
+                       allocate the final capacity up front instead of growing step by step.
+                  ADD: Dictionaries with length-aware keys that don't need to be zero terminated
+                       via SH_GEN_STR_DICT_DECL() and SH_GEN_STR_DICT_IMPL().
+                  ADD: Dictionaries that store their keys in an arena via SH_GEN_ARENA_DICT_DECL()
+                       and SH_GEN_ARENA_DICT_IMPL(). Also added sh_arena_alloc(),
+                       sh_arena_strdup() and sh_arena_free().
+                  ADD: Dictionaries with small-string keys that are stored inline in the slots
+                       via SH_GEN_SSO_DICT_DECL() and SH_GEN_SSO_DICT_IMPL().
+                  ADD: sh_wyhash() and sh_xxhash() 64 bit hash functions and a benchmark of all
+                       hash functions (tests/slim_hash_bench.c, run it with "make bench").
+                  ADD: Sharded hashmaps for many threads via SH_GEN_CONCURRENT_DECL(),
+                       SH_GEN_CONCURRENT_IMPL(), SH_GEN_CONCURRENT_HASH_IMPL() and
+                       SH_GEN_CONCURRENT_DICT_IMPL() (when SLIM_HASH_CONCURRENT is defined).
+                  ADD: ..._merge() to merge two hashmaps and ..._reduce() to merge many hashmaps
+                       into a SH_GEN_CONCURRENT_DECL() hashmap with several threads.
+                  ADD: Lock-free insert-only tables that many threads can fill in parallel via
+                       SH_GEN_ATOMIC_DECL() and SH_GEN_ATOMIC_IMPL() (when SLIM_HASH_CONCURRENT
+                       is defined).
+                  ADD: ..._save(), ..._open_mmap() and ..._close_mmap() to save hashmaps into
+                       files and open them read-only with mmap() (when SLIM_HASH_MMAP is defined).
+                       Not generated for dictionaries, their keys are pointers.
+                  ADD: SLIM_HASH_64BIT for hashmaps with more than 2^31 slots. It makes capacities,
+                       lengths and stored hashes 64 bit (sh_size_t, sh_hash_t, sh_bytes_hash()).
+                  ADD: Frozen read-only tables with a minimal perfect hash function via
+                       SH_GEN_FROZEN_DECL() and SH_GEN_FROZEN_IMPL(), built from a hashmap.
+                  ADD: Hash sets without values via SH_GEN_SET_DECL() and SH_GEN_SET_IMPL(),
+                       with ..._union() and ..._intersect().
+                  ADD: ..._upsert() to look up or insert a key with one probe. It tells if the
+                       key was inserted and only executes the key_put_expr in that case.
+                  ADD: ..._set_load_factors() and the SH_MAX_LOAD, SH_MIN_LOAD and
+                       SH_GROWTH_FACTOR defaults to configure when hashmaps grow and shrink.
+                  CHANGE: Hashmaps shrink to a load halfway between the min and max load so they
+                          don't resize back and forth. A hashmap that is mostly filled with
+                          deleted slots is rebuilt with the same capacity instead of growing.
+                  CHANGE: SH_GEN_HASH_IMPL() and its variants hash keys with 1, 2, 4 or 8 bytes
+                          with the branch free sh_int_hash() instead of sh_murmur3().
+                  CHANGE: Resizing reuses the hashes stored in the slots instead of executing
+                          key_hash_expr for every key again. Slots are found by masking the hash
+                          since the capacity is always a power of two.
+                  CHANGE: SH_GEN_IMPL() now generates the probing functions and the public
+                          functions separately (SH_GEN_LINEAR_PROBING() and SH_GEN_MAP_FUNCTIONS()).
+                  FIX: ..._put_ptr() incremented the length and executed key_put_expr again when
+                       the key was already in the hashmap.
+                  FIX: ..._put_ptr() could insert a key a second time when a deleted slot was in
+                       front of it.
+                  FIX: sh_fnv1a() only hashed the first character of the key.
 
 **/
 #ifndef SLIM_HASH_HEADER
@@ -204,15 +385,432 @@ v1.1  2017-07-12  ADD: Added the fnv1a 32 bit hash function (see sh_fnv1a() docu
 #include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#ifdef SLIM_HASH_CONCURRENT
+    #include <pthread.h>
+#endif
+#ifdef SLIM_HASH_MMAP
+    #include <stdio.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+#endif
+
 
+// Type of capacities, lengths and slot indices (sh_size_t) and of the hashes stored in the slots
+// (sh_hash_t). Both are 32 bit unless SLIM_HASH_64BIT is defined before including the header.
+#ifdef SLIM_HASH_64BIT
+    typedef uint64_t sh_size_t;
+    typedef uint64_t sh_hash_t;
+    #define SH_HASH_BITS  64
+#else
+    typedef uint32_t sh_size_t;
+    typedef uint32_t sh_hash_t;
+    #define SH_HASH_BITS  32
+#endif
+#define SH_SIZE_MAX      ((sh_size_t)-1)
+#define SH_MAX_CAPACITY  ((sh_size_t)1 << (SH_HASH_BITS - 1))
 
-// Flags for hashtable slots
+// Flags for hashtable slots. If the top bit (SH_SLOT_FILLED) is set hash_or_flags contains a hash.
+// SH_SLOT_CLAIMED marks a slot of an atomic table claimed by an unfinished insert.
 #define SH_SLOT_FREE     0x00000000  // Choosen so a calloc()ed hash is considered free
 #define SH_SLOT_DELETED  0x00000001
-#define SH_SLOT_FILLED   0x80000000  // If this bit is set hash_or_flags contains a hash
+#define SH_SLOT_FILLED   ((sh_hash_t)1 << (SH_HASH_BITS - 1))
+#define SH_SLOT_CLAIMED  ((sh_hash_t)1 << (SH_HASH_BITS - 2))
 
 uint32_t sh_murmur3(const void* key, int size, uint32_t seed);
 uint32_t sh_fnv1a(const char* key);
+uint64_t sh_wyhash(const void* key, size_t size, uint64_t seed);
+uint64_t sh_xxhash(const void* key, size_t size, uint64_t seed);
+
+/**
+ * Hashes a 64 bit integer with the murmur3 finalizer (fmix64). It's branch free and only takes a
+ * few multiplications and shifts, but every input bit affects every bit of the result.
+ */
+static inline uint64_t sh_int_hash64(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccd;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53;
+    key ^= key >> 33;
+    return key;
+}
+
+/**
+ * sh_int_hash64() for the hashmaps. They use the lower 32 bits (all 64 bits with SLIM_HASH_64BIT).
+ */
+static inline sh_hash_t sh_int_hash(uint64_t key) {
+    return (sh_hash_t)sh_int_hash64(key);
+}
+
+/**
+ * Hashes `size` bytes with sh_murmur3(). With SLIM_HASH_64BIT the hashmaps need 64 bit hashes and
+ * sh_wyhash() is used instead.
+ */
+static inline sh_hash_t sh_bytes_hash(const void* key, size_t size) {
+#ifdef SLIM_HASH_64BIT
+    return sh_wyhash(key, size, 0);
+#else
+    return sh_murmur3(key, (int)size, 0);
+#endif
+}
+
+/**
+ * Hashes a value type key of `size` bytes, used by SH_GEN_HASH_IMPL() and its variants. Keys with
+ * 1, 2, 4 or 8 bytes (integers, floats, pointers, ...) are read as one integer and hashed with
+ * sh_int_hash(). Larger keys are hashed with sh_bytes_hash(). `size` is usually sizeof(key) so the
+ * compiler removes all the branches that don't match.
+ */
+static inline sh_hash_t sh_value_hash(const void* key, size_t size) {
+    if (size == 8) {
+        uint64_t value;
+        memcpy(&value, key, sizeof(value));
+        return sh_int_hash(value);
+    } else if (size == 4) {
+        uint32_t value;
+        memcpy(&value, key, sizeof(value));
+        return sh_int_hash(value);
+    } else if (size == 2) {
+        uint16_t value;
+        memcpy(&value, key, sizeof(value));
+        return sh_int_hash(value);
+    } else if (size == 1) {
+        return sh_int_hash(*(const uint8_t*)key);
+    }
+    return sh_bytes_hash(key, size);
+}
+
+/**
+ * Like sh_value_hash() but always returns a 64 bit hash (sh_int_hash64() or sh_wyhash()). Used by
+ * SH_GEN_FROZEN_HASH_IMPL().
+ */
+static inline uint64_t sh_value_hash64(const void* key, size_t size) {
+    if (size == 1 || size == 2 || size == 4 || size == 8) {
+        uint64_t value = 0;
+        memcpy(&value, key, size);
+        return sh_int_hash64(value);
+    }
+    return sh_wyhash(key, size, 0);
+}
+
+// Key type of the dictionaries generated by SH_GEN_STR_DICT_IMPL(). `ptr` doesn't need to be zero
+// terminated, `length` is the number of bytes of the string.
+struct sh_str {
+    const char* ptr;
+    size_t length;
+};
+
+struct sh_str sh_str_dup(struct sh_str str);
+
+static inline struct sh_str sh_str_n(const char* ptr, size_t length) {
+    struct sh_str str = { ptr, length };
+    return str;
+}
+
+// Size of the memory chunks that hold the keys of SH_GEN_ARENA_DICT_IMPL() dictionaries
+#define SH_ARENA_CHUNK_SIZE  (64 * 1024)
+
+// A chunk of arena memory. Chunks are chained into a list, the newest chunk comes first.
+struct sh_arena_chunk {
+    struct sh_arena_chunk* next;
+    size_t used, size;
+    char data[];
+};
+
+void* sh_arena_alloc(struct sh_arena_chunk** arena, size_t size);
+char* sh_arena_strdup(struct sh_arena_chunk** arena, const char* str);
+void  sh_arena_free(struct sh_arena_chunk** arena);
+
+// Size of the small-string keys used by SH_GEN_SSO_DICT_IMPL() dictionaries
+#define SH_SSO_SIZE  16
+
+// Small-string key. Strings with up to SH_SSO_SIZE - 1 chars are stored right in `bytes` (zero
+// padded). For longer strings `bytes` contains a pointer to the string and the last byte is set to
+// 1. A short string always has a zero as last byte so short and long keys never look the same.
+struct sh_sso {
+    char bytes[SH_SSO_SIZE];
+};
+
+struct sh_sso sh_sso_dup(struct sh_sso key);
+void          sh_sso_free(struct sh_sso key);
+
+/**
+ * Creates a small-string key for a zero terminated string. Short strings are copied into the key,
+ * long ones are just referenced (the pointer is stored in the key). Use it to look up keys, e.g.
+ * tags_get(&tags, sh_sso_from("de"), 0). The dictionary copies long strings when they're inserted.
+ */
+static inline struct sh_sso sh_sso_from(const char* str) {
+    struct sh_sso key = { { 0 } };
+    size_t length = strlen(str);
+    if (length < SH_SSO_SIZE) {
+        memcpy(key.bytes, str, length);
+    } else {
+        memcpy(key.bytes, &str, sizeof(str));
+        key.bytes[SH_SSO_SIZE - 1] = 1;
+    }
+    return key;
+}
+
+/**
+ * Returns true if the string of the key isn't stored in the key itself.
+ */
+static inline bool sh_sso_is_long(const struct sh_sso* key) {
+    return key->bytes[SH_SSO_SIZE - 1] != 0;
+}
+
+/**
+ * Returns the zero terminated string of a key. For short keys that points into the key itself, so
+ * the pointer is only valid as long as the key is.
+ */
+static inline const char* sh_sso_chars(const struct sh_sso* key) {
+    if ( !sh_sso_is_long(key) )
+        return key->bytes;
+    const char* str;
+    memcpy(&str, key->bytes, sizeof(str));
+    return str;
+}
+
+/**
+ * Calculates the hash of a small-string key. Short keys are hashed as two 64 bit words with the
+ * murmur3 finalizer (no strlen() needed), long keys with sh_bytes_hash(). Short and long keys
+ * never match, so it doesn't matter that the same string would get different hashes.
+ */
+static inline sh_hash_t sh_sso_hash(const struct sh_sso* key) {
+    if ( sh_sso_is_long(key) ) {
+        const char* str = sh_sso_chars(key);
+        return sh_bytes_hash(str, strlen(str));
+    }
+    
+    uint64_t words[2];
+    memcpy(words, key->bytes, sizeof(words));
+    uint64_t h = words[0] + words[1] * 0x9e3779b97f4a7c15;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccd;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+ * Compares two small-string keys. Short keys are compared by their bytes (usually two word
+ * compares), only two long keys need a strcmp().
+ */
+static inline bool sh_sso_equal(const struct sh_sso* a, const struct sh_sso* b) {
+    if (memcmp(a->bytes, b->bytes, SH_SSO_SIZE) == 0)
+        return true;
+    return sh_sso_is_long(a) && sh_sso_is_long(b) && strcmp(sh_sso_chars(a), sh_sso_chars(b)) == 0;
+}
+
+// Size of the control byte groups used by SH_GEN_SWISS_IMPL()
+#define SH_GROUP_SIZE    16
+// Number of keys hashed and prefetched at once by the ..._get_many() and ..._put_many() functions
+#define SH_BATCH_SIZE    16
+// Number of old slots moved by each ..._put() and ..._del() of SH_GEN_INCREMENTAL_IMPL() hashmaps
+#define SH_MIGRATE_SLOTS 32
+
+// Default load factors and growth factor of new hashmaps. Define them before including the library
+// to change them for all hashmaps or use ..._set_load_factors() for a single hashmap.
+#ifndef SH_MAX_LOAD
+    #define SH_MAX_LOAD       0.5
+#endif
+#ifndef SH_MIN_LOAD
+    #define SH_MIN_LOAD       0.25
+#endif
+#ifndef SH_GROWTH_FACTOR
+    #define SH_GROWTH_FACTOR  2
+#endif
+
+// Hook that is called after each resize of a hashmap. Define it before including the library to
+// collect statistics (see USAGE). By default it does nothing and no time is measured.
+#ifdef SH_RESIZE_STATS
+    #define SH_RESIZE_CLOCK()  clock()
+#else
+    #define SH_RESIZE_STATS(name, old_capacity, new_capacity, length, seconds)  ((void)(seconds))
+    #define SH_RESIZE_CLOCK()  0
+#endif
+
+#if defined(__GNUC__)
+    #define SH_PREFETCH(address)  __builtin_prefetch(address)
+#else
+    #define SH_PREFETCH(address)
+#endif
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+#elif defined(__SSE2__)
+    #include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    #include <arm_neon.h>
+#endif
+
+/**
+ * Returns the control byte of a slot with the stored hash `hash`, the top 8 bits of the hash. So
+ * filled slots always have the highest bit of their control byte set.
+ */
+static inline uint8_t sh_ctrl_byte(sh_hash_t hash) {
+    return (uint8_t)(hash >> (SH_HASH_BITS - 8));
+}
+
+/**
+ * Compares the SH_GROUP_SIZE control bytes at `ctrl` with `byte` and returns a bitmask with one bit
+ * for each matching control byte (bit 0 for the first byte). Uses SSE2 or NEON if available.
+ * Used by the hashmaps generated with SH_GEN_SWISS_IMPL().
+ */
+static inline uint32_t sh_group_match(const uint8_t* ctrl, uint8_t byte) {
+#if defined(__SSE2__)
+    __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(byte)));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    static const uint8_t bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x16_t matches = vandq_u8(vceqq_u8(vld1q_u8(ctrl), vdupq_n_u8(byte)), vld1q_u8(bits));
+    return vaddv_u8(vget_low_u8(matches)) | (vaddv_u8(vget_high_u8(matches)) << 8);
+#else
+    uint32_t mask = 0;
+    for(uint32_t i = 0; i < SH_GROUP_SIZE; i++)
+        mask |= (uint32_t)(ctrl[i] == byte) << i;
+    return mask;
+#endif
+}
+
+/**
+ * Returns a bitmask with one bit for each control byte at `ctrl` that belongs to a filled slot.
+ * Filled slots have the highest bit of their control byte set.
+ */
+static inline uint32_t sh_group_filled(const uint8_t* ctrl) {
+#if defined(__SSE2__)
+    return _mm_movemask_epi8(_mm_loadu_si128((const __m128i*)ctrl));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    static const uint8_t bits[16] = { 1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128 };
+    uint8x16_t filled = vandq_u8(vcltzq_s8(vreinterpretq_s8_u8(vld1q_u8(ctrl))), vld1q_u8(bits));
+    return vaddv_u8(vget_low_u8(filled)) | (vaddv_u8(vget_high_u8(filled)) << 8);
+#else
+    uint32_t mask = 0;
+    for(uint32_t i = 0; i < SH_GROUP_SIZE; i++)
+        mask |= (uint32_t)(ctrl[i] >> 7) << i;
+    return mask;
+#endif
+}
+
+/**
+ * Returns the index of the lowest set bit in `mask`. `mask` must not be 0.
+ */
+static inline uint32_t sh_lowest_bit(uint32_t mask) {
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    uint32_t index = 0;
+    while ( !(mask & 1) ) {
+        mask >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+/**
+ * Returns which of the 2^partition_bits hash ranges a stored hash (hash_or_flags) belongs to. The
+ * upper bits below SH_SLOT_FILLED select the range, so it doesn't depend on the lower bits the
+ * hashmaps use to select a slot. Used to split hashmaps into partitions or shards.
+ */
+static inline uint32_t sh_partition(sh_hash_t hash, uint32_t partition_bits) {
+    if (partition_bits == 0)
+        return 0;
+    return (uint32_t)((sh_hash_t)(hash << 1) >> (SH_HASH_BITS - partition_bits));
+}
+
+/**
+ * Returns `true` if a hashmap with `used` filled or deleted slots exceeds `max_load` and has to
+ * grow. At least one slot always stays free, otherwise lookups of missing keys would never stop.
+ */
+static inline bool sh_needs_to_grow(size_t used, sh_size_t capacity, float max_load) {
+    return used > capacity * max_load || used >= capacity;
+}
+
+/**
+ * Returns the capacity a hashmap needs to hold `length` items without growing. That's the smallest
+ * power of two (at least 8) that keeps the load at or below `max_load`. Returns 0 if that capacity
+ * would exceed SH_MAX_CAPACITY.
+ */
+static inline sh_size_t sh_capacity_for(size_t length, float max_load) {
+    sh_size_t capacity = 8;
+    while ( sh_needs_to_grow(length, capacity, max_load) ) {
+        if (capacity >= SH_MAX_CAPACITY)
+            return 0;
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+/**
+ * Returns the capacity a hashmap with `length` items and `deleted` slots is resized to when one
+ * more item exceeds its `max_load`. Usually that's the capacity multiplied by `growth_factor` (or 8
+ * for an empty hashmap). But if the deleted slots make up most of the load the hashmap is just
+ * rebuilt with the same capacity (resizing cleans up the deleted slots). Otherwise adding and
+ * deleting items would grow the hashmap again and again. Returns 0 if the capacity would exceed
+ * SH_MAX_CAPACITY.
+ */
+static inline sh_size_t sh_grown_capacity(sh_size_t capacity, sh_size_t length, sh_size_t deleted,
+    float max_load, uint32_t growth_factor) {
+    if (capacity > 0 && length + 1 <= capacity * max_load / 2 && deleted > length)
+        return capacity;
+    
+    if (capacity > SH_MAX_CAPACITY / growth_factor)
+        return 0;
+    sh_size_t new_capacity = (capacity == 0) ? 8 : capacity * growth_factor;
+    sh_size_t needed = sh_capacity_for((size_t)length + 1, max_load);
+    if (needed == 0)
+        return 0;
+    return (needed > new_capacity) ? needed : new_capacity;
+}
+
+/**
+ * Returns the capacity a hashmap with `length` items should shrink to or `capacity` if it shouldn't
+ * shrink. A hashmap shrinks when its load drops below `min_load` and then to a load of at most
+ * halfway between `min_load` and `max_load`. So items can be added and removed afterwards without
+ * resizing back and forth. A `min_load` of 0 disables shrinking.
+ */
+static inline sh_size_t sh_shrunk_capacity(sh_size_t length, sh_size_t capacity, float min_load,
+    float max_load) {
+    if ( !(length < capacity * min_load) )
+        return capacity;
+    
+    float target_load = (min_load + max_load) / 2;
+    sh_size_t new_capacity = capacity;
+    while (new_capacity > 8 && length <= new_capacity / 2 * target_load)
+        new_capacity /= 2;
+    return new_capacity;
+}
+
+// Checks the arguments of the ..._set_load_factors() functions
+static inline bool sh_valid_load_factors(float max_load, float min_load, uint32_t growth_factor) {
+    return max_load > 0 && max_load < 1 && min_load >= 0 && min_load < max_load
+        && growth_factor >= 2 && (growth_factor & (growth_factor - 1)) == 0;
+}
+
+// Average number of keys per bucket of a frozen table (see SH_GEN_FROZEN_DECL())
+#define SH_FROZEN_BUCKET_SIZE  4
+
+bool sh_perfect_hash_build(const uint64_t* hashes, size_t length, size_t bucket_count,
+    uint32_t* pilots, size_t* positions);
+
+/**
+ * Maps a 64 bit hash evenly onto 0 to size - 1. Uses the upper 32 bits and a multiplication instead
+ * of a division unless `size` needs more than 32 bits.
+ */
+static inline size_t sh_range(uint64_t hash, size_t size) {
+    if ((uint64_t)size >> 32 == 0)
+        return (size_t)(((hash >> 32) * (uint64_t)size) >> 32);
+    return (size_t)(hash % size);
+}
+
+/**
+ * Returns the item of a frozen table a key with `hash` ends up in when its bucket uses `pilot`.
+ */
+static inline size_t sh_perfect_hash_position(uint64_t hash, uint32_t pilot, size_t length) {
+    return sh_range(sh_int_hash64(hash ^ (pilot * 0x9e3779b97f4a7c15)), length);
+}
 
 /**
  * This macro declares a hash. It doesn't generate the implementation, just the types and function
@@ -223,14 +821,67 @@ uint32_t sh_fnv1a(const char* key);
  * If SLIM_HASH_NO_TYPEDEFS is defined no typedefs for shorthand types ending with ..._t and ..._p
  * are defined.
  */
+#define SH_GEN_DECL(name, key_t, value_t)                                                          \
+    SH_GEN_TYPES_AND_PROTOTYPES(name, key_t, value_t)                                              \
+    SH_GEN_TYPEDEFS(name)
+
 #ifdef SLIM_HASH_NO_TYPEDEFS
-    #define SH_GEN_DECL(name, key_t, value_t)  SH_GEN_TYPES_AND_PROTOTYPES(name, key_t, value_t)
+    #define SH_GEN_TYPEDEFS(name)
 #else
-    #define SH_GEN_DECL(name, key_t, value_t)  SH_GEN_TYPES_AND_PROTOTYPES(name, key_t, value_t)   \
+    #define SH_GEN_TYPEDEFS(name)                                                                  \
         typedef struct name name##_t, *name##_p;                                                   \
-        typedef struct name##_slot *name##_it_p;                                                   
+        typedef struct name##_slot *name##_it_p;
 #endif
 
+/**
+ * Declares a dictionary with length-aware string keys (struct sh_str). On top of the normal API
+ * (see SH_GEN_DECL()) it declares some ..._n() functions that take the key as a pointer and a
+ * length. Generate the implementation with SH_GEN_STR_DICT_IMPL() using the same arguments.
+ */
+#define SH_GEN_STR_DICT_DECL(name, value_t)                                                        \
+    SH_GEN_DECL(name, struct sh_str, value_t)                                                      \
+    value_t* name##_get_ptr_n(struct name* hashmap, const char* ptr, size_t length);               \
+    value_t* name##_put_ptr_n(struct name* hashmap, const char* ptr, size_t length);               \
+    value_t* name##_upsert_n(struct name* hashmap, const char* ptr, size_t length,                 \
+                 bool* inserted);                                                                  \
+    value_t  name##_get_n(struct name* hashmap, const char* ptr, size_t length,                    \
+                 value_t default_value);                                                           \
+    void     name##_put_n(struct name* hashmap, const char* ptr, size_t length, value_t value);    \
+    bool     name##_del_n(struct name* hashmap, const char* ptr, size_t length);                   \
+    bool     name##_contains_n(struct name* hashmap, const char* ptr, size_t length);
+
+/**
+ * Declares a dictionary whose keys are stored in an arena (see SH_GEN_ARENA_DICT_IMPL()). Same as
+ * SH_GEN_DECL() plus the arena in the struct and a prototype for the ..._compact_keys() function.
+ */
+#define SH_GEN_ARENA_DICT_DECL(name, key_t, value_t)                                               \
+    SH_GEN_TYPES_AND_PROTOTYPES_WITH_FIELDS(name, key_t, value_t,                                  \
+        /* Memory for the keys, see SH_GEN_ARENA_DICT_IMPL()                                    */ \
+        struct sh_arena_chunk* arena;                                                              \
+    )                                                                                              \
+    SH_GEN_TYPEDEFS(name)                                                                          \
+    bool     name##_compact_keys(struct name* hashmap);
+
+/**
+ * Declares a dictionary with small-string keys (struct sh_sso). It's the same as
+ * SH_GEN_DECL(name, struct sh_sso, value_t). Generate the implementation with
+ * SH_GEN_SSO_DICT_IMPL() using the same arguments.
+ */
+#define SH_GEN_SSO_DICT_DECL(name, value_t)  SH_GEN_DECL(name, struct sh_sso, value_t)
+
+/**
+ * Declares a hashmap that is resized incrementally (see SH_GEN_INCREMENTAL_IMPL()). Same as
+ * SH_GEN_DECL() but the struct also keeps the slots that are still moved by a resize.
+ */
+#define SH_GEN_INCREMENTAL_DECL(name, key_t, value_t)                                              \
+    SH_GEN_TYPES_AND_PROTOTYPES_WITH_FIELDS(name, key_t, value_t,                                  \
+        /* Slots not yet moved by a resize and how many of them were already looked at          */ \
+        struct name##_slot* old_slots;                                                             \
+        sh_size_t old_capacity;                                                                    \
+        sh_size_t migrated;                                                                        \
+    )                                                                                              \
+    SH_GEN_TYPEDEFS(name)
+
 /**
  * This macro declares a hash. It doesn't generate the implementation, just the types and function
  * prototypes. You can use this macro at different places or use it once and include that whenever
@@ -238,19 +889,37 @@ uint32_t sh_fnv1a(const char* key);
  * the same first three arguments to generate the implementation once.
  */
 #define SH_GEN_TYPES_AND_PROTOTYPES(name, key_t, value_t)                                          \
+    SH_GEN_TYPES_AND_PROTOTYPES_WITH_FIELDS(name, key_t, value_t, )
+
+/**
+ * Same as SH_GEN_TYPES_AND_PROTOTYPES() but inserts `extra_fields` into the struct of the hashmap.
+ * Used by the declaration macros of hashmaps that need a bit more state (e.g.
+ * SH_GEN_INCREMENTAL_DECL()). Each field has to be declared separately, without commas.
+ */
+#define SH_GEN_TYPES_AND_PROTOTYPES_WITH_FIELDS(name, key_t, value_t, extra_fields)                \
     struct name##_slot {                                                                           \
-        uint32_t hash_or_flags;                                                                    \
+        sh_hash_t hash_or_flags;                                                                   \
         key_t key;                                                                                 \
         value_t value;                                                                             \
     };                                                                                             \
                                                                                                    \
     struct name {                                                                                  \
-        uint32_t length, capacity, deleted;                                                        \
+        sh_size_t length, capacity, deleted;                                                       \
         struct name##_slot* slots;                                                                 \
+        extra_fields                                                                               \
+        /* When to grow and shrink, see name##_set_load_factors()                               */ \
+        float max_load, min_load;                                                                  \
+        uint32_t growth_factor;                                                                    \
     };                                                                                             \
                                                                                                    \
     void     name##_new(struct name* hashmap);                                                     \
+    bool     name##_new_with_capacity(struct name* hashmap, size_t length);                        \
+    bool     name##_build_from_arrays(struct name* hashmap, key_t* keys, value_t* values,          \
+                 size_t count);                                                                    \
     void     name##_destroy(struct name* hashmap);                                                 \
+    bool     name##_reserve(struct name* hashmap, size_t length);                                  \
+    bool     name##_set_load_factors(struct name* hashmap, float max_load, float min_load,         \
+                 uint32_t growth_factor);                                                          \
                                                                                                    \
     value_t  name##_get(struct name* hashmap, key_t key, value_t default_value);                   \
     void     name##_put(struct name* hashmap, key_t key, value_t value);                           \
@@ -259,11 +928,20 @@ uint32_t sh_fnv1a(const char* key);
                                                                                                    \
     value_t* name##_get_ptr(struct name* hashmap, key_t key);                                      \
     value_t* name##_put_ptr(struct name* hashmap, key_t key);                                      \
+    value_t* name##_upsert(struct name* hashmap, key_t key, bool* inserted);                       \
+                                                                                                   \
+    size_t   name##_get_many(struct name* hashmap, key_t* keys, size_t count, value_t** values);   \
+    bool     name##_put_many(struct name* hashmap, key_t* keys, value_t* values, size_t count);    \
+                                                                                                   \
+    bool     name##_merge(struct name* dst, struct name* src,                                      \
+                 void (*combine)(value_t* dst_value, value_t src_value, void* data), void* data);  \
                                                                                                    \
     struct name##_slot*  name##_start(struct name* hashmap);                                       \
     struct name##_slot*  name##_next(struct name* hashmap, struct name##_slot* it);                \
     void                 name##_remove(struct name* hashmap, struct name##_slot* it);              \
     bool                 name##_shrink_if_necessary(struct name* hashmap);                         \
+                                                                                                   \
+    SH_GEN_MMAP_PROTOTYPES(name)                                                                   \
 
 /**
  * Shorthand macro to generate the implementation of an hash that uses value types as keys. That are
@@ -277,7 +955,7 @@ uint32_t sh_fnv1a(const char* key);
  */
 #define SH_GEN_HASH_IMPL(name, key_t, value_t)                                                     \
     SH_GEN_IMPL(name, key_t, value_t,                                                              \
-        sh_murmur3(&key, sizeof(key), 0),  /* key_hash_expr(key_t key)                       */    \
+        sh_value_hash(&key, sizeof(key)),  /* key_hash_expr(key_t key)                       */    \
         (a == b),                          /* key_cmp_expr(key_t a, key_t b)                 */    \
         key,                               /* key_put_expr(key_t key)                        */    \
         0,                                 /* key_del_expr(key_t key)                        */    \
@@ -294,13 +972,163 @@ uint32_t sh_fnv1a(const char* key);
  * the implementation.
  */
 #define SH_GEN_DICT_IMPL(name, key_t, value_t)                                                     \
-    SH_GEN_IMPL(name, key_t, value_t,                                                              \
-        sh_murmur3(key, strlen(key), 0),  /* key_hash_expr(key_t key)                       */     \
-        (strcmp(a, b) == 0),              /* key_cmp_expr(key_t a, key_t b)                 */     \
+    SH_GEN_LINEAR_PROBING(name, key_t, value_t,                                                    \
+        (strcmp(a, b) == 0)               /* key_cmp_expr(key_t a, key_t b)                 */     \
+    )                                                                                              \
+    SH_GEN_MAP_FUNCTIONS(name, key_t, value_t,                                                     \
+        sh_bytes_hash(key, strlen(key)),  /* key_hash_expr(key_t key)                       */     \
         sh_strdup(key),                   /* key_put_expr(key_t key)                        */     \
         (free((void*)key), NULL),         /* key_del_expr(key_t key)                        */     \
         calloc(capacity, slot_size),      /* calloc_expr(size_t capacity, size_t slot_size) */     \
-        free(ptr)                         /* free_expr(void* ptr)                           */     \
+        free(ptr),                        /* free_expr(void* ptr)                           */     \
+        NULL,                             /* destroy_expr                                   */     \
+        true,                             /* per_key_cleanup                                */     \
+        SH_GEN_NO_MMAP_FUNCTIONS          /* mmap_gen                                       */     \
+    )
+
+/**
+ * Shorthand macro to generate the implementation of a dictionary with length-aware string keys.
+ * The keys don't need to be zero terminated, so you can look up strings straight from an input
+ * buffer (e.g. a token in an mmap()ed file) without copying them first. The length of each key is
+ * stored next to its pointer. Hash matches are only compared with memcmp() if the lengths match as
+ * well and no strlen() is ever needed.
+ * 
+ * The keys are copied into the dictionary by sh_str_dup() and freed when an item is deleted or the
+ * dictionary destroyed. The copies are zero terminated, so the ptr of a key can be used as a normal
+ * C string while iterating over the dictionary.
+ * 
+ * You need to generate the declarations first with SH_GEN_STR_DICT_DECL() using the same arguments
+ * as for the implementation.
+ */
+#define SH_GEN_STR_DICT_IMPL(name, value_t)                                                        \
+    SH_GEN_LINEAR_PROBING(name, struct sh_str, value_t,                                            \
+        (a.length == b.length &&                  /* key_cmp_expr(key_t a, key_t b)             */ \
+            memcmp(a.ptr, b.ptr, a.length) == 0)                                                   \
+    )                                                                                              \
+    SH_GEN_MAP_FUNCTIONS(name, struct sh_str, value_t,                                             \
+        sh_bytes_hash(key.ptr, key.length),       /* key_hash_expr(key_t key)                   */ \
+        sh_str_dup(key),                          /* key_put_expr(key_t key)                    */ \
+        (free((void*)key.ptr), sh_str_n(0, 0)),   /* key_del_expr(key_t key)                    */ \
+        calloc(capacity, slot_size),              /* calloc_expr(capacity, slot_size)           */ \
+        free(ptr),                                /* free_expr(void* ptr)                       */ \
+        NULL,                                     /* destroy_expr                               */ \
+        true,                                     /* per_key_cleanup                            */ \
+        SH_GEN_NO_MMAP_FUNCTIONS                  /* mmap_gen                                   */ \
+    )                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Same as name##_get_ptr(), name##_put_ptr(), etc. but the key is passed as a pointer to   */ \
+    /* its first byte and its length. Nothing is copied unless a new key is inserted.           */ \
+    value_t* name##_get_ptr_n(struct name* hashmap, const char* ptr, size_t length) {              \
+        return name##_get_ptr(hashmap, sh_str_n(ptr, length));                                     \
+    }                                                                                              \
+                                                                                                   \
+    value_t* name##_put_ptr_n(struct name* hashmap, const char* ptr, size_t length) {              \
+        return name##_put_ptr(hashmap, sh_str_n(ptr, length));                                     \
+    }                                                                                              \
+                                                                                                   \
+    value_t* name##_upsert_n(struct name* hashmap, const char* ptr, size_t length,                 \
+        bool* inserted) {                                                                          \
+        return name##_upsert(hashmap, sh_str_n(ptr, length), inserted);                            \
+    }                                                                                              \
+                                                                                                   \
+    value_t name##_get_n(struct name* hashmap, const char* ptr, size_t length,                     \
+        value_t default_value) {                                                                   \
+        return name##_get(hashmap, sh_str_n(ptr, length), default_value);                          \
+    }                                                                                              \
+                                                                                                   \
+    void name##_put_n(struct name* hashmap, const char* ptr, size_t length, value_t value) {       \
+        name##_put(hashmap, sh_str_n(ptr, length), value);                                         \
+    }                                                                                              \
+                                                                                                   \
+    bool name##_del_n(struct name* hashmap, const char* ptr, size_t length) {                      \
+        return name##_del(hashmap, sh_str_n(ptr, length));                                         \
+    }                                                                                              \
+                                                                                                   \
+    bool name##_contains_n(struct name* hashmap, const char* ptr, size_t length) {                 \
+        return name##_contains(hashmap, sh_str_n(ptr, length));                                    \
+    }                                                                                              \
+
+/**
+ * Shorthand macro to generate the implementation of a dictionary with zero terminated string keys
+ * that are copied into an arena owned by the dictionary. Instead of one malloc() per key the keys
+ * are packed into large chunks (SH_ARENA_CHUNK_SIZE bytes). Deleting a key doesn't free anything
+ * and destroying the dictionary just frees the chunks. This makes building large dictionaries
+ * (e.g. a vocabulary with millions of words) a lot faster and doesn't fragment the heap.
+ * 
+ * The memory of deleted keys is only reclaimed by ..._compact_keys(). It copies all remaining keys
+ * into a new arena and frees the old one. Call it after many keys have been deleted. Returns
+ * `false` if the memory allocation failed, the dictionary remains unchanged in that case.
+ * 
+ * You need to generate the declarations first with SH_GEN_ARENA_DICT_DECL() using the same
+ * arguments as for the implementation.
+ */
+#define SH_GEN_ARENA_DICT_IMPL(name, key_t, value_t)                                               \
+    SH_GEN_LINEAR_PROBING(name, key_t, value_t,                                                    \
+        (strcmp(a, b) == 0)                       /* key_cmp_expr(key_t a, key_t b)             */ \
+    )                                                                                              \
+    SH_GEN_MAP_FUNCTIONS(name, key_t, value_t,                                                     \
+        sh_bytes_hash(key, strlen(key)),          /* key_hash_expr(key_t key)                   */ \
+        sh_arena_strdup(&hashmap->arena, key),    /* key_put_expr(key_t key)                    */ \
+        NULL,                                     /* key_del_expr(key_t key)                    */ \
+        calloc(capacity, slot_size),              /* calloc_expr(capacity, slot_size)           */ \
+        free(ptr),                                /* free_expr(void* ptr)                       */ \
+        sh_arena_free(&hashmap->arena),           /* destroy_expr                               */ \
+        false,                                    /* per_key_cleanup                            */ \
+        SH_GEN_NO_MMAP_FUNCTIONS                  /* mmap_gen                                   */ \
+    )                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Copies all keys into one new chunk and frees the old arena. See                          */ \
+    /* SH_GEN_ARENA_DICT_IMPL().                                                                */ \
+    bool name##_compact_keys(struct name* hashmap) {                                               \
+        size_t size = 0;                                                                           \
+        for(struct name##_slot* it = name##_start(hashmap); it; it = name##_next(hashmap, it))     \
+            size += strlen(it->key) + 1;                                                           \
+                                                                                                   \
+        struct sh_arena_chunk* arena = NULL;                                                       \
+        char* dest = (size > 0) ? sh_arena_alloc(&arena, size) : NULL;                             \
+        if (size > 0 && dest == NULL)                                                              \
+            return false;                                                                          \
+                                                                                                   \
+        for(struct name##_slot* it = name##_start(hashmap); it; it = name##_next(hashmap, it)) {   \
+            size_t key_size = strlen(it->key) + 1;                                                 \
+            memcpy(dest, it->key, key_size);                                                       \
+            it->key = dest;                                                                        \
+            dest += key_size;                                                                      \
+        }                                                                                          \
+                                                                                                   \
+        sh_arena_free(&hashmap->arena);                                                            \
+        hashmap->arena = arena;                                                                    \
+        return true;                                                                               \
+    }                                                                                              \
+
+/**
+ * Shorthand macro to generate the implementation of a dictionary with small-string keys (struct
+ * sh_sso). Short keys (up to SH_SSO_SIZE - 1 chars) are stored inline in the slots. Comparing them
+ * doesn't follow a pointer to some other memory, the key is in the same cache line as the hash of
+ * the slot. Long keys are duplicated on the heap by sh_sso_dup() and freed by sh_sso_free() when
+ * an item is deleted or the dictionary destroyed.
+ * 
+ * Pass keys to the functions with sh_sso_from(), e.g. tags_put(&tags, sh_sso_from("de"), 1). Use
+ * sh_sso_chars(&it->key) to get the string of a key while iterating.
+ * 
+ * You need to generate the declarations first with SH_GEN_SSO_DICT_DECL() using the same arguments
+ * as for the implementation.
+ */
+#define SH_GEN_SSO_DICT_IMPL(name, value_t)                                                        \
+    SH_GEN_LINEAR_PROBING(name, struct sh_sso, value_t,                                            \
+        sh_sso_equal(&a, &b)                      /* key_cmp_expr(key_t a, key_t b)             */ \
+    )                                                                                              \
+    SH_GEN_MAP_FUNCTIONS(name, struct sh_sso, value_t,                                             \
+        sh_sso_hash(&key),                        /* key_hash_expr(key_t key)                   */ \
+        sh_sso_dup(key),                          /* key_put_expr(key_t key)                    */ \
+        (sh_sso_free(key), sh_sso_from("")),      /* key_del_expr(key_t key)                    */ \
+        calloc(capacity, slot_size),              /* calloc_expr(capacity, slot_size)           */ \
+        free(ptr),                                /* free_expr(void* ptr)                       */ \
+        NULL,                                     /* destroy_expr                               */ \
+        true,                                     /* per_key_cleanup                            */ \
+        SH_GEN_NO_MMAP_FUNCTIONS                  /* mmap_gen                                   */ \
     )
 
 /**
@@ -318,9 +1146,10 @@ uint32_t sh_fnv1a(const char* key);
  * expression can use some variables from the generated code (here written like function
  * prototypes):
  * 
- * uint32_t key_hash_expr(key_t key)
- *     Executed whenever the hash of a key is needed.
- *     Examples: sh_murmur3(&key, sizeof(key), 0) or sh_murmur3(key, strlen(key), 0)
+ * sh_hash_t key_hash_expr(key_t key)
+ *     Executed whenever the hash of a key is needed. With SLIM_HASH_64BIT it has to return a 64 bit
+ *     hash, otherwise the upper 32 bits (and the Swiss control bytes) are always 0.
+ *     Examples: sh_value_hash(&key, sizeof(key)) or sh_bytes_hash(key, strlen(key))
  * 
  * bool key_cmp_expr(key_t a, key_t b)
  *     Expression used as if condition to compare two keys.
@@ -350,139 +1179,270 @@ uint32_t sh_fnv1a(const char* key);
  *     Examples: free(ptr) 
  */
 #define SH_GEN_IMPL(name, key_t, value_t, key_hash_expr, key_cmp_expr, key_put_expr, key_del_expr, calloc_expr, free_expr)  \
-                                                                                                   \
-    /* Some forward declarations for internal functions.                                        */ \
-    value_t* name##_put_ptr_internal(struct name* hashmap, key_t key);                             \
-    bool     name##_resize(struct name* hashmap, uint32_t new_capacity);                           \
-                                                                                                   \
-    /**                                                                                         */ \
-    /* Initializes a new empty hashmap. A small capacity is allocated so the hashmap doesn't    */ \
-    /* need to be resized as soon as the first item is inserted.                                */ \
-    void name##_new(struct name* hashmap) {                                                        \
-        hashmap->length = 0;                                                                       \
-        hashmap->capacity = 0;                                                                     \
-        hashmap->deleted = 0;                                                                      \
-        hashmap->slots = NULL;                                                                     \
-        name##_resize(hashmap, 8);                                                                 \
-    }                                                                                              \
-                                                                                                   \
-    /**                                                                                         */ \
-    /* Destroys the hashmap. Cleans up all the keys be executing the key_del_expr for each one  */ \
-    /* and frees all associated memory.                                                         */ \
-    void name##_destroy(struct name* hashmap) {                                                    \
-        /* Execute key_del_expr for all keys still in the hashmap.                              */ \
-        for(struct name##_slot* it = name##_start(hashmap); it; it = name##_next(hashmap, it)) {   \
-            key_t key = it->key;                                                                   \
-            key = key;  /* avoid unused variable warning                                        */ \
-            it->key = (key_del_expr);                                                              \
-            it->hash_or_flags = SH_SLOT_DELETED;                                                   \
-        }                                                                                          \
-                                                                                                   \
-        hashmap->length = 0;                                                                       \
-        hashmap->capacity = 0;                                                                     \
-        hashmap->deleted = 0;                                                                      \
-                                                                                                   \
-        /* ptr is used as an argument to the  free_expr which should free the  memory of ptr    */ \
-        /* like free() does.                                                                    */ \
-        void* ptr = hashmap->slots;                                                                \
-        ptr = ptr;  /* avoid unused variable warning if free_expr doesn't use ptr               */ \
-        free_expr;                                                                                 \
-                                                                                                   \
-        hashmap->slots = NULL;                                                                     \
+    SH_GEN_LINEAR_PROBING(name, key_t, value_t, key_cmp_expr)                                      \
+    SH_GEN_MAP_FUNCTIONS(name, key_t, value_t, key_hash_expr, key_put_expr, key_del_expr,          \
+        calloc_expr, free_expr, NULL, true, SH_GEN_MMAP_FUNCTIONS)
+
+/**
+ * Same as SH_GEN_HASH_IMPL() but generates a hashmap that uses Robin Hood hashing (see
+ * SH_GEN_RH_IMPL()).
+ */
+#define SH_GEN_RH_HASH_IMPL(name, key_t, value_t)                                                  \
+    SH_GEN_RH_IMPL(name, key_t, value_t,                                                           \
+        sh_value_hash(&key, sizeof(key)),  /* key_hash_expr(key_t key)                       */    \
+        (a == b),                          /* key_cmp_expr(key_t a, key_t b)                 */    \
+        key,                               /* key_put_expr(key_t key)                        */    \
+        0,                                 /* key_del_expr(key_t key)                        */    \
+        calloc(capacity, slot_size),       /* calloc_expr(size_t capacity, size_t slot_size) */    \
+        free(ptr)                          /* free_expr(void* ptr)                           */    \
+    )
+
+/**
+ * Same as SH_GEN_DICT_IMPL() but generates a dictionary that uses Robin Hood hashing (see
+ * SH_GEN_RH_IMPL()).
+ */
+#define SH_GEN_RH_DICT_IMPL(name, key_t, value_t)                                                  \
+    SH_GEN_ROBIN_HOOD_PROBING(name, key_t, value_t,                                                \
+        (strcmp(a, b) == 0)               /* key_cmp_expr(key_t a, key_t b)                 */     \
+    )                                                                                              \
+    SH_GEN_MAP_FUNCTIONS(name, key_t, value_t,                                                     \
+        sh_bytes_hash(key, strlen(key)),  /* key_hash_expr(key_t key)                       */     \
+        sh_strdup(key),                   /* key_put_expr(key_t key)                        */     \
+        (free((void*)key), NULL),         /* key_del_expr(key_t key)                        */     \
+        calloc(capacity, slot_size),      /* calloc_expr(size_t capacity, size_t slot_size) */     \
+        free(ptr),                        /* free_expr(void* ptr)                           */     \
+        NULL,                             /* destroy_expr                                   */     \
+        true,                             /* per_key_cleanup                                */     \
+        SH_GEN_NO_MMAP_FUNCTIONS          /* mmap_gen                                       */     \
+    )
+
+/**
+ * Same as SH_GEN_IMPL() but the generated hashmap uses Robin Hood hashing instead of plain linear
+ * probing. The declaration is the same, use SH_GEN_DECL().
+ * 
+ * With Robin Hood hashing a new key takes the slot of any key that is closer to its home slot (the
+ * slot its hash points to) than the new key. The displaced key then continues looking for a slot.
+ * This keeps the probe distances of all keys short and similar. A lookup can stop as soon as it
+ * finds a key that is closer to its home slot than the searched key would be. Deleting a key moves
+ * the following keys of the probe chain one slot back (backward shift deletion) instead of leaving
+ * a deleted slot behind. So the hashmap doesn't fill up with deleted slots when many keys are
+ * inserted and deleted and lookups for keys that are not in the hashmap stay fast.
+ * 
+ * The probe distance of a key is calculated from the hash stored in its slot. So the slots are
+ * just as large as with SH_GEN_IMPL().
+ * 
+ * name##_remove() can't move keys around while you iterate over the hashmap. So it still leaves a
+ * deleted slot behind. Those are cleaned up the next time the hashmap is resized.
+ */
+#define SH_GEN_RH_IMPL(name, key_t, value_t, key_hash_expr, key_cmp_expr, key_put_expr, key_del_expr, calloc_expr, free_expr)  \
+    SH_GEN_ROBIN_HOOD_PROBING(name, key_t, value_t, key_cmp_expr)                                  \
+    SH_GEN_MAP_FUNCTIONS(name, key_t, value_t, key_hash_expr, key_put_expr, key_del_expr,          \
+        calloc_expr, free_expr, NULL, true, SH_GEN_MMAP_FUNCTIONS)
+
+/**
+ * Same as SH_GEN_HASH_IMPL() but generates a hashmap that probes groups of control bytes (see
+ * SH_GEN_SWISS_IMPL()).
+ */
+#define SH_GEN_SWISS_HASH_IMPL(name, key_t, value_t)                                               \
+    SH_GEN_SWISS_IMPL(name, key_t, value_t,                                                        \
+        sh_value_hash(&key, sizeof(key)),  /* key_hash_expr(key_t key)                       */    \
+        (a == b),                          /* key_cmp_expr(key_t a, key_t b)                 */    \
+        key,                               /* key_put_expr(key_t key)                        */    \
+        0,                                 /* key_del_expr(key_t key)                        */    \
+        calloc(capacity, slot_size),       /* calloc_expr(size_t capacity, size_t slot_size) */    \
+        free(ptr)                          /* free_expr(void* ptr)                           */    \
+    )
+
+/**
+ * Same as SH_GEN_DICT_IMPL() but generates a dictionary that probes groups of control bytes (see
+ * SH_GEN_SWISS_IMPL()).
+ */
+#define SH_GEN_SWISS_DICT_IMPL(name, key_t, value_t)                                               \
+    SH_GEN_SWISS_PROBING(name, key_t, value_t,                                                     \
+        (strcmp(a, b) == 0)               /* key_cmp_expr(key_t a, key_t b)                 */     \
+    )                                                                                              \
+    SH_GEN_MAP_FUNCTIONS(name, key_t, value_t,                                                     \
+        sh_bytes_hash(key, strlen(key)),  /* key_hash_expr(key_t key)                       */     \
+        sh_strdup(key),                   /* key_put_expr(key_t key)                        */     \
+        (free((void*)key), NULL),         /* key_del_expr(key_t key)                        */     \
+        calloc(capacity, slot_size),      /* calloc_expr(size_t capacity, size_t slot_size) */     \
+        free(ptr),                        /* free_expr(void* ptr)                           */     \
+        NULL,                             /* destroy_expr                                   */     \
+        true,                             /* per_key_cleanup                                */     \
+        SH_GEN_NO_MMAP_FUNCTIONS          /* mmap_gen                                       */     \
+    )
+
+/**
+ * Same as SH_GEN_IMPL() but the generated hashmap keeps one control byte per slot in a separate
+ * array and probes SH_GROUP_SIZE (16) control bytes at once, like Google's SwissTable. The
+ * declaration is the same, use SH_GEN_DECL().
+ * 
+ * A control byte is 0 for a free slot, 1 for a deleted slot or the top 8 bits of the hash for a
+ * filled slot (the highest bit is always set, so 7 bits of the hash remain). A lookup compares all
+ * 16 control bytes of a group with the control byte of the key in one go (SSE2 or NEON if
+ * available, a plain loop otherwise). Only slots with a matching control byte are touched, all
+ * other slots aren't loaded at all. The lookup stops at the first group that contains a free slot.
+ * This helps a lot with large hashmaps where lookups are limited by memory accesses.
+ * 
+ * The control bytes are stored right after the slots in the same memory block. So calloc_expr is
+ * asked for a few slots more than the capacity of the hashmap.
+ */
+#define SH_GEN_SWISS_IMPL(name, key_t, value_t, key_hash_expr, key_cmp_expr, key_put_expr, key_del_expr, calloc_expr, free_expr)  \
+    SH_GEN_SWISS_PROBING(name, key_t, value_t, key_cmp_expr)                                       \
+    SH_GEN_MAP_FUNCTIONS(name, key_t, value_t, key_hash_expr, key_put_expr, key_del_expr,          \
+        calloc_expr, free_expr, NULL, true, SH_GEN_MMAP_FUNCTIONS)
+
+/**
+ * Same as SH_GEN_HASH_IMPL() but generates a hashmap that resizes incrementally (see
+ * SH_GEN_INCREMENTAL_IMPL()).
+ */
+#define SH_GEN_INCREMENTAL_HASH_IMPL(name, key_t, value_t)                                         \
+    SH_GEN_INCREMENTAL_IMPL(name, key_t, value_t,                                                  \
+        sh_value_hash(&key, sizeof(key)),  /* key_hash_expr(key_t key)                       */    \
+        (a == b),                          /* key_cmp_expr(key_t a, key_t b)                 */    \
+        key,                               /* key_put_expr(key_t key)                        */    \
+        0,                                 /* key_del_expr(key_t key)                        */    \
+        calloc(capacity, slot_size),       /* calloc_expr(size_t capacity, size_t slot_size) */    \
+        free(ptr)                          /* free_expr(void* ptr)                           */    \
+    )
+
+/**
+ * Same as SH_GEN_DICT_IMPL() but generates a dictionary that resizes incrementally (see
+ * SH_GEN_INCREMENTAL_IMPL()).
+ */
+#define SH_GEN_INCREMENTAL_DICT_IMPL(name, key_t, value_t)                                         \
+    SH_GEN_LINEAR_PROBING(name, key_t, value_t,                                                    \
+        (strcmp(a, b) == 0)               /* key_cmp_expr(key_t a, key_t b)                 */     \
+    )                                                                                              \
+    SH_GEN_INCREMENTAL_MAP_FUNCTIONS(name, key_t, value_t,                                         \
+        sh_bytes_hash(key, strlen(key)),  /* key_hash_expr(key_t key)                       */     \
+        sh_strdup(key),                   /* key_put_expr(key_t key)                        */     \
+        (free((void*)key), NULL),         /* key_del_expr(key_t key)                        */     \
+        calloc(capacity, slot_size),      /* calloc_expr(size_t capacity, size_t slot_size) */     \
+        free(ptr),                        /* free_expr(void* ptr)                           */     \
+        SH_GEN_NO_MMAP_FUNCTIONS          /* mmap_gen                                       */     \
+    )
+
+/**
+ * Same as SH_GEN_IMPL() but the generated hashmap resizes incrementally, like the dict of Redis.
+ * Declare it with SH_GEN_INCREMENTAL_DECL() instead of SH_GEN_DECL().
+ * 
+ * A normal resize moves all items into the new slots at once. For large hashmaps that takes a
+ * while and the ..._put() that triggered it takes much longer than usual. Here a resize only
+ * allocates the new slots and keeps the old ones around. Each following ..._put() and ..._del()
+ * then moves SH_MIGRATE_SLOTS of the old slots over until all are moved and the old slots are
+ * freed. This bounds the time an operation can take, no matter how large the hashmap is.
+ * 
+ * While items are moved lookups check the new slots first and then the old ones. Iteration goes
+ * over both. Lookups never move items, so pointers returned by ..._get_ptr() stay valid until the
+ * hashmap is changed, just like with the other hashmaps.
+ * 
+ * The hashmap grows long before the new slots are filled up, so the old slots are always gone by
+ * then. Should a resize be necessary while items are still moved (e.g. after deleting many items),
+ * the remaining items are moved at once. The hashmap isn't shrunk while items are moved.
+ */
+#define SH_GEN_INCREMENTAL_IMPL(name, key_t, value_t, key_hash_expr, key_cmp_expr, key_put_expr, key_del_expr, calloc_expr, free_expr)  \
+    SH_GEN_LINEAR_PROBING(name, key_t, value_t, key_cmp_expr)                                      \
+    SH_GEN_INCREMENTAL_MAP_FUNCTIONS(name, key_t, value_t, key_hash_expr, key_put_expr,            \
+        key_del_expr, calloc_expr, free_expr, SH_GEN_MMAP_FUNCTIONS)
+
+/**
+ * Internal macro that generates the probing functions of a hashmap with linear probing. These
+ * functions find, insert and delete slots and tell how much memory has to be allocated for the
+ * slots. All other functions of the hashmap are generated by
+ * SH_GEN_MAP_FUNCTIONS() and build on top of them. Each function gets the hash of the key as it is
+ * stored in the slot (with the SH_SLOT_FILLED bit set).
+ * 
+ * None of the generated functions are part of the public API! Don't use them in your code unless
+ * you know _exactly_ what you're doing!
+ */
+#define SH_GEN_LINEAR_PROBING(name, key_t, value_t, key_cmp_expr)                                  \
+    /**                                                                                         */ \
+    /* Returns the number of slots that have to be allocated for the specified capacity.        */ \
+    size_t name##_allocation_size(sh_size_t capacity) {                                            \
+        return capacity;                                                                           \
     }                                                                                              \
                                                                                                    \
     /**                                                                                         */ \
-    /* Resizes the hashmap to the specified new capacity. All existing itmes are rehashed into  */ \
-    /* the new hashmap. For zero terminated string keys this is slightly faster than using the  */ \
-    /* existing hashes, for integer keys this is slightly slower.                               */ \
-    /*                                                                                          */ \
-    /* Returns `true` if the resizing was successfull, `false` if the memory allocation for the */ \
-    /* new capacity failed. In that case the hashmap remains unchanged and can still be used.   */ \
-    /*                                                                                          */ \
-    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
-    /* _exactly_ what you're doing!                                                             */ \
-    bool name##_resize(struct name* hashmap, uint32_t new_capacity) {                              \
-        /* Can't make hashmap smaller than it needs to be.                                      */ \
-        if (new_capacity < hashmap->length)                                                        \
-            return false;                                                                          \
-                                                                                                   \
-        struct name new_hashmap;                                                                   \
-        new_hashmap.length = 0;                                                                    \
-        new_hashmap.capacity = new_capacity;                                                       \
-        new_hashmap.deleted = 0;                                                                   \
-                                                                                                   \
-        /* capacity and slot_size variables are used to pass arguments to calloc_expr which in  */ \
-        /* turn should allocate memory like calloc() does.                                      */ \
-        size_t capacity = new_capacity;                                                            \
-        size_t slot_size = sizeof(new_hashmap.slots[0]);                                           \
-        new_hashmap.slots = calloc_expr;                                                           \
+    /* Prefetches the home slot of `hash` so a following lookup doesn't have to wait for        */ \
+    /* memory.                                                                                  */ \
+    void name##_prefetch(struct name* hashmap, sh_hash_t hash) {                                   \
+        SH_PREFETCH(&hashmap->slots[hash & (hashmap->capacity - 1)]);                              \
+    }                                                                                              \
                                                                                                    \
-        /* Failed to allocate memory for new hashmap, leave the original untouched.             */ \
-        if (new_hashmap.slots == NULL)                                                             \
-            return false;                                                                          \
+    /**                                                                                         */ \
+    /* Returns the slot that contains the specified key or `NULL` if the key is not in the      */ \
+    /* hashmap.                                                                                 */ \
+    struct name##_slot* name##_find_slot(struct name* hashmap, key_t key, sh_hash_t hash) {        \
+        /* No slots at all, e.g. after a failed allocation in name##_new_with_capacity()        */ \
+        if (hashmap->capacity == 0)                                                                \
+            return NULL;                                                                           \
+        size_t index = hash & (hashmap->capacity - 1);                                             \
+        while ( !(hashmap->slots[index].hash_or_flags == SH_SLOT_FREE) ) {                         \
+            if (hashmap->slots[index].hash_or_flags == hash) {                                     \
+                key_t a = hashmap->slots[index].key;                                               \
+                key_t b = key;                                                                     \
+                if (key_cmp_expr)                                                                  \
+                    return &hashmap->slots[index];                                                 \
+            }                                                                                      \
                                                                                                    \
-        for(struct name##_slot* it = name##_start(hashmap); it; it = name##_next(hashmap, it)) {   \
-            *name##_put_ptr_internal(&new_hashmap, it->key) = it->value;                           \
+            index = (index + 1) & (hashmap->capacity - 1);                                         \
         }                                                                                          \
                                                                                                    \
-        /* ptr is used as an argument to the free_expr which should free the memory of ptr like */ \
-        /* free() does.                                                                         */ \
-        void* ptr = hashmap->slots;                                                                \
-        ptr = ptr;  /* avoid unused variable warning if free_expr doesn't use ptr               */ \
-        free_expr;                                                                                 \
-        *hashmap = new_hashmap;                                                                    \
-        return true;                                                                               \
+        return NULL;                                                                               \
     }                                                                                              \
                                                                                                    \
     /**                                                                                         */ \
-    /* Inserts a new key-value pair into the hashmap, growing the hashmap if necessary. Returns */ \
-    /* a pointer to the storage for the value. That pointer can then be used to store the value */ \
-    /* itself in the hashmap.                                                                   */ \
-    /*                                                                                          */ \
-    /* The returned pointer stays valid as long as the hashmap isn't chaned (not adding or      */ \
-    /* deleting items or resizing the hashmap). These operations potentiall force a resizing of */ \
-    /* the hashmap and thus probably invalidate the memory address. So make sure you don't      */ \
-    /* store the pointer somewhere or use it after a function that changes the hashmap.         */ \
-    /*                                                                                          */ \
-    /* Don't use this function while iterating over the hashmap. This function might resize the */ \
-    /* hashmap and thus invalidates the pointer used as iterator, possibly leading to segfaults */ \
+    /* Returns the slot of the specified key. If the key isn't in the hashmap a new slot is     */ \
+    /* reserved for it and `*inserted` is set to `true`. The key is stored as it is, the caller */ \
+    /* can replace it (e.g. with a duplicated string). It DOESN'T check if the hashmap has a    */ \
+    /* free slot.                                                                               */ \
     /*                                                                                          */ \
-    /* Returns `NULL` if the hashmap needs to grow but failed to allocate more memory for that. */ \
-    value_t* name##_put_ptr(struct name* hashmap, key_t key) {                                     \
-        if (hashmap->length + hashmap->deleted + 1 > hashmap->capacity * 0.5) {                    \
-            uint32_t new_capacity = (hashmap->capacity == 0) ? 8 : hashmap->capacity * 2;          \
-            if ( name##_resize(hashmap, new_capacity) == false )                                   \
-                return NULL;                                                                       \
+    /* The first deleted slot on the way is reused for a new key. But we have to look until the */ \
+    /* next free slot to make sure the key isn't stored somewhere behind the deleted slot.      */ \
+    struct name##_slot* name##_put_slot(struct name* hashmap, key_t key, sh_hash_t hash,           \
+        bool* inserted) {                                                                          \
+        size_t index = hash & (hashmap->capacity - 1);                                             \
+        struct name##_slot* deleted_slot = NULL;                                                   \
+        while ( !(hashmap->slots[index].hash_or_flags == SH_SLOT_FREE) ) {                         \
+            if (hashmap->slots[index].hash_or_flags == hash) {                                     \
+                key_t a = hashmap->slots[index].key;                                               \
+                key_t b = key;                                                                     \
+                if (key_cmp_expr) {                                                                \
+                    *inserted = false;                                                             \
+                    return &hashmap->slots[index];                                                 \
+                }                                                                                  \
+            } else if (hashmap->slots[index].hash_or_flags == SH_SLOT_DELETED && !deleted_slot) {  \
+                deleted_slot = &hashmap->slots[index];                                             \
+            }                                                                                      \
+                                                                                                   \
+            index = (index + 1) & (hashmap->capacity - 1);                                         \
+        }                                                                                          \
+                                                                                                   \
+        struct name##_slot* slot = &hashmap->slots[index];                                         \
+        if (deleted_slot) {                                                                        \
+            slot = deleted_slot;                                                                   \
+            hashmap->deleted--;                                                                    \
         }                                                                                          \
+        hashmap->length++;                                                                         \
+        slot->hash_or_flags = hash;                                                                \
+        slot->key = key;                                                                           \
                                                                                                    \
-        return name##_put_ptr_internal(hashmap, (key_put_expr));                                   \
+        *inserted = true;                                                                          \
+        return slot;                                                                               \
     }                                                                                              \
                                                                                                    \
     /**                                                                                         */ \
-    /* An internal function that reserves a new slot for the specified key and returns a        */ \
-    /* pointer to the value of that slot. It DOESN'T check if the hashmap as a free slot nore   */ \
-    /* executes the key_put_expr. It's only used by name##_put_ptr() and name##_resize()        */ \
-    /* that already take care of that.                                                          */ \
-    /*                                                                                          */ \
-    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
-    /* _exactly_ what you're doing!                                                             */ \
-    /*                                                                                          */ \
-    /* Implementation detail: This function uses linear probing in case of hash collisions.     */ \
-    value_t* name##_put_ptr_internal(struct name* hashmap, key_t key) {                            \
-        uint32_t hash = (key_hash_expr) | SH_SLOT_FILLED;                                          \
-        size_t index = hash % hashmap->capacity;                                                   \
-                                                                                                   \
+    /* Reserves a new slot for a key that is known to not be in the hashmap (e.g. when          */ \
+    /* resizing) and returns it. Keys are never compared. It DOESN'T check if the hashmap has a */ \
+    /* free slot.                                                                               */ \
+    struct name##_slot* name##_insert_slot(struct name* hashmap, key_t key, sh_hash_t hash) {      \
+        size_t index = hash & (hashmap->capacity - 1);                                             \
         while ( !(                                                                                 \
             hashmap->slots[index].hash_or_flags == SH_SLOT_FREE ||                                 \
             hashmap->slots[index].hash_or_flags == SH_SLOT_DELETED                                 \
         ) ) {                                                                                      \
-            if (hashmap->slots[index].hash_or_flags == hash) {                                     \
-                key_t a = hashmap->slots[index].key;                                               \
-                key_t b = key;                                                                     \
-                if (key_cmp_expr)                                                                  \
-                    break;                                                                         \
-            }                                                                                      \
-            index = (index + 1) % hashmap->capacity;                                               \
+            index = (index + 1) & (hashmap->capacity - 1);                                         \
         }                                                                                          \
                                                                                                    \
         if (hashmap->slots[index].hash_or_flags == SH_SLOT_DELETED)                                \
@@ -491,192 +1451,3707 @@ uint32_t sh_fnv1a(const char* key);
         hashmap->slots[index].hash_or_flags = hash;                                                \
         hashmap->slots[index].key = key;                                                           \
                                                                                                    \
-        return &hashmap->slots[index].value;                                                       \
+        return &hashmap->slots[index];                                                             \
     }                                                                                              \
                                                                                                    \
     /**                                                                                         */ \
-    /* Looks up the specified key in the hashmap and returns a pointer to the value stored for  */ \
-    /* that key. Returns `NULL` if the key could not be found.                                  */ \
-    /*                                                                                          */ \
-    /* The returned pointer stays valid as long as the hashmap isn't chaned (not adding or      */ \
-    /* deleting items or resizing the hashmap). These operations potentiall force a resizing of */ \
-    /* the hashmap and thus probably invalidate the memory address. So make sure you don't      */ \
-    /* store the pointer somewhere or use it after a function that changes the hashmap.         */ \
-    value_t* name##_get_ptr(struct name* hashmap, key_t key) {                                     \
-        uint32_t hash = (key_hash_expr) | SH_SLOT_FILLED;                                          \
-        size_t index = hash % hashmap->capacity;                                                   \
+    /* Marks a slot as deleted without touching any other slot. Used by name##_remove() while   */ \
+    /* iterating over the hashmap. The key has to be cleaned up by the caller.                  */ \
+    void name##_tombstone_slot(struct name* hashmap, struct name##_slot* slot) {                   \
+        slot->hash_or_flags = SH_SLOT_DELETED;                                                     \
+        hashmap->length--;                                                                         \
+        hashmap->deleted++;                                                                        \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Deletes the item in a slot. The key has to be cleaned up by the caller. With linear      */ \
+    /* probing the slot is just marked as deleted.                                              */ \
+    void name##_delete_slot(struct name* hashmap, struct name##_slot* slot) {                      \
+        name##_tombstone_slot(hashmap, slot);                                                      \
+    }                                                                                              \
+
+
+/**
+ * Internal macro that generates the probing functions of a hashmap with Robin Hood hashing. Same
+ * functions as SH_GEN_LINEAR_PROBING(), see there for details.
+ */
+#define SH_GEN_ROBIN_HOOD_PROBING(name, key_t, value_t, key_cmp_expr)                              \
+    /**                                                                                         */ \
+    /* Returns the number of slots that have to be allocated for the specified capacity.        */ \
+    size_t name##_allocation_size(sh_size_t capacity) {                                            \
+        return capacity;                                                                           \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Prefetches the home slot of `hash` so a following lookup doesn't have to wait for        */ \
+    /* memory.                                                                                  */ \
+    void name##_prefetch(struct name* hashmap, sh_hash_t hash) {                                   \
+        SH_PREFETCH(&hashmap->slots[hash & (hashmap->capacity - 1)]);                              \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Returns how far the slot at `index` is away from the home slot of `hash`.                */ \
+    sh_size_t name##_probe_distance(struct name* hashmap, sh_hash_t hash, size_t index) {          \
+        return (index - hash) & (hashmap->capacity - 1);                                           \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Returns the slot that contains the specified key or `NULL` if the key is not in the      */ \
+    /* hashmap. The search stops at the first slot that is closer to its home slot than we are  */ \
+    /* to ours. The insertion would have taken that slot if our key was in the hashmap. Deleted */ \
+    /* slots (left behind by name##_remove()) are skipped.                                      */ \
+    struct name##_slot* name##_find_slot(struct name* hashmap, key_t key, sh_hash_t hash) {        \
+        /* No slots at all, e.g. after a failed allocation in name##_new_with_capacity()        */ \
+        if (hashmap->capacity == 0)                                                                \
+            return NULL;                                                                           \
+        size_t index = hash & (hashmap->capacity - 1);                                             \
+        sh_size_t distance = 0;                                                                    \
         while ( !(hashmap->slots[index].hash_or_flags == SH_SLOT_FREE) ) {                         \
-            if (hashmap->slots[index].hash_or_flags == hash) {                                     \
+            sh_hash_t slot_hash = hashmap->slots[index].hash_or_flags;                             \
+            if (slot_hash == hash) {                                                               \
                 key_t a = hashmap->slots[index].key;                                               \
                 key_t b = key;                                                                     \
                 if (key_cmp_expr)                                                                  \
-                    return &hashmap->slots[index].value;                                           \
+                    return &hashmap->slots[index];                                                 \
+            }                                                                                      \
+            if (slot_hash != SH_SLOT_DELETED) {                                                    \
+                if (name##_probe_distance(hashmap, slot_hash, index) < distance)                   \
+                    return NULL;                                                                   \
             }                                                                                      \
                                                                                                    \
-            index = (index + 1) % hashmap->capacity;                                               \
+            index = (index + 1) & (hashmap->capacity - 1);                                         \
+            distance++;                                                                            \
         }                                                                                          \
                                                                                                    \
         return NULL;                                                                               \
     }                                                                                              \
                                                                                                    \
     /**                                                                                         */ \
-    /* Deletes the key-value pair for the specified key from the hashmap. The hashmap is shrunk */ \
-    /* if it is to sparse. Even if no key was deleted. This way you can use this function to    */ \
-    /* with an arbitary (non-existing) key to shrink the hashmap if necessary after deleting    */ \
-    /* some items while iterating over the hashmap.                                             */ \
+    /* Reserves a new slot for a key that is known to not be in the hashmap. The probing starts */ \
+    /* at `index`, which is `distance` slots away from the home slot of `hash`. All slots in    */ \
+    /* front of it have to be filled and at least as far away from their home slot. Keys are    */ \
+    /* never compared. It DOESN'T check if the hashmap has a free slot.                         */ \
     /*                                                                                          */ \
-    /* Returns `true` if the key-value pair was deleted, `false` if the key wasn't found in the */ \
-    /* hashmap.                                                                                 */ \
+    /* The new key takes the first slot that is closer to its home slot than the new key is to  */ \
+    /* its own. The item of that slot is then moved on in the same way until we reach a free or */ \
+    /* deleted slot. The value of the new key is zeroed out.                                    */ \
+    struct name##_slot* name##_insert_slot_at(struct name* hashmap, key_t key, sh_hash_t hash,     \
+        size_t index, sh_size_t distance) {                                                        \
+        struct name##_slot entry = { .hash_or_flags = hash, .key = key };                          \
+        struct name##_slot* inserted_slot = NULL;                                                  \
+                                                                                                   \
+        while ( !(                                                                                 \
+            hashmap->slots[index].hash_or_flags == SH_SLOT_FREE ||                                 \
+            hashmap->slots[index].hash_or_flags == SH_SLOT_DELETED                                 \
+        ) ) {                                                                                      \
+            sh_hash_t slot_hash = hashmap->slots[index].hash_or_flags;                             \
+            sh_size_t slot_distance = name##_probe_distance(hashmap, slot_hash, index);            \
+            if (slot_distance < distance) {                                                        \
+                struct name##_slot displaced = hashmap->slots[index];                              \
+                hashmap->slots[index] = entry;                                                     \
+                entry = displaced;                                                                 \
+                distance = slot_distance;                                                          \
+                if (inserted_slot == NULL)                                                         \
+                    inserted_slot = &hashmap->slots[index];                                        \
+            }                                                                                      \
+                                                                                                   \
+            index = (index + 1) & (hashmap->capacity - 1);                                         \
+            distance++;                                                                            \
+        }                                                                                          \
+                                                                                                   \
+        if (hashmap->slots[index].hash_or_flags == SH_SLOT_DELETED)                                \
+            hashmap->deleted--;                                                                    \
+        hashmap->length++;                                                                         \
+        hashmap->slots[index] = entry;                                                             \
+                                                                                                   \
+        return (inserted_slot) ? inserted_slot : &hashmap->slots[index];                           \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Reserves a new slot for a key that is known to not be in the hashmap and returns it.     */ \
+    /* Keys are never compared. It DOESN'T check if the hashmap has a free slot.                */ \
+    struct name##_slot* name##_insert_slot(struct name* hashmap, key_t key, sh_hash_t hash) {      \
+        return name##_insert_slot_at(hashmap, key, hash, hash & (hashmap->capacity - 1), 0);       \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Returns the slot of the specified key. If the key isn't in the hashmap a new slot is     */ \
+    /* reserved for it and `*inserted` is set to `true`. It DOESN'T check if the hashmap has a  */ \
+    /* free slot.                                                                               */ \
     /*                                                                                          */ \
-    /* Don't use this function while iterating over the hashmap. This function might resize the */ \
-    /* hashmap and thus invalidates the pointer used as iterator, possibly leading to segfaults */ \
-    bool name##_del(struct name* hashmap, key_t key) {                                             \
-        uint32_t hash = (key_hash_expr) | SH_SLOT_FILLED;                                          \
-        size_t index = hash % hashmap->capacity;                                                   \
+    /* Probes like name##_find_slot(). If the key isn't found the insertion continues right     */ \
+    /* where the search stopped: at the first deleted slot on the way, or else at the free or   */ \
+    /* richer slot that ended the search. That's the slot name##_insert_slot() would pick, too. */ \
+    struct name##_slot* name##_put_slot(struct name* hashmap, key_t key, sh_hash_t hash,           \
+        bool* inserted) {                                                                          \
+        size_t index = hash & (hashmap->capacity - 1);                                             \
+        sh_size_t distance = 0;                                                                    \
+        struct name##_slot* deleted_slot = NULL;                                                   \
         while ( !(hashmap->slots[index].hash_or_flags == SH_SLOT_FREE) ) {                         \
-            if (hashmap->slots[index].hash_or_flags == hash) {                                     \
+            sh_hash_t slot_hash = hashmap->slots[index].hash_or_flags;                             \
+            if (slot_hash == hash) {                                                               \
                 key_t a = hashmap->slots[index].key;                                               \
                 key_t b = key;                                                                     \
                 if (key_cmp_expr) {                                                                \
-                    /* Define a local variable named "key" that is used to pass the key of the  */ \
-                    /* deleted item to key_del_expr. We can't use the function argument named   */ \
-                    /* "key" because the key_put_expr might have duplicated a string key. In    */ \
-                    /* that case the key_del_expr expects to get exactly the value returned by  */ \
-                    /* key_put_expr... and that is the key stored in the deleted slot.          */ \
-                    key_t key = hashmap->slots[index].key;                                         \
-                    key = key; /* avoid unused variable warning                                 */ \
-                    hashmap->slots[index].key = (key_del_expr);                                    \
-                    hashmap->slots[index].hash_or_flags = SH_SLOT_DELETED;                         \
-                    hashmap->length--;                                                             \
-                    hashmap->deleted++;                                                            \
-                                                                                                   \
-                    name##_shrink_if_necessary(hashmap);                                           \
-                    return true;                                                                   \
+                    *inserted = false;                                                             \
+                    return &hashmap->slots[index];                                                 \
                 }                                                                                  \
+            }                                                                                      \
+            if (slot_hash == SH_SLOT_DELETED) {                                                    \
+                if (deleted_slot == NULL)                                                          \
+                    deleted_slot = &hashmap->slots[index];                                         \
+            } else if (name##_probe_distance(hashmap, slot_hash, index) < distance) {              \
+                break;                                                                             \
             }                                                                                      \
                                                                                                    \
-            index = (index + 1) % hashmap->capacity;                                               \
+            index = (index + 1) & (hashmap->capacity - 1);                                         \
+            distance++;                                                                            \
         }                                                                                          \
                                                                                                    \
-        return false;                                                                              \
+        *inserted = true;                                                                          \
+        if (deleted_slot) {                                                                        \
+            hashmap->deleted--;                                                                    \
+            hashmap->length++;                                                                     \
+            deleted_slot->hash_or_flags = hash;                                                    \
+            deleted_slot->key = key;                                                               \
+            return deleted_slot;                                                                   \
+        }                                                                                          \
+        return name##_insert_slot_at(hashmap, key, hash, index, distance);                         \
     }                                                                                              \
                                                                                                    \
     /**                                                                                         */ \
-    /* Inserts a value at the specified key into the hashmap. An existing value for the same    */ \
-    /* key is overwritten. The hashmap is grown if necessary.                                   */ \
-    /*                                                                                          */ \
-    /* Causes a segmentation fault in case the hashmap needs to grow but couldn't allocate the  */ \
-    /* necessary memory. Use name##_put_ptr() if you want to handle that case.                  */ \
+    /* Marks a slot as deleted without touching any other slot. Used by name##_remove() while   */ \
+    /* iterating over the hashmap. The key has to be cleaned up by the caller.                  */ \
+    void name##_tombstone_slot(struct name* hashmap, struct name##_slot* slot) {                   \
+        slot->hash_or_flags = SH_SLOT_DELETED;                                                     \
+        hashmap->length--;                                                                         \
+        hashmap->deleted++;                                                                        \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Deletes the item in a slot. The key has to be cleaned up by the caller.                  */ \
     /*                                                                                          */ \
-    /* Don't use this function while iterating over the hashmap. This function might resize the */ \
-    /* hashmap and thus invalidates the pointer used as iterator, possibly leading to segfaults */ \
-    void name##_put(struct name* hashmap, key_t key, value_t value) {                              \
-        *name##_put_ptr(hashmap, key) = value;                                                     \
+    /* All following items of the probe chain are moved back by one slot (backward shift        */ \
+    /* deletion). We stop at a free slot or at an item that is already in its home slot. If we  */ \
+    /* run into a deleted slot we leave the last slot as a deleted slot, too. Otherwise the     */ \
+    /* free slot would cut off the probe chains running through that deleted slot.              */ \
+    void name##_delete_slot(struct name* hashmap, struct name##_slot* slot) {                      \
+        size_t index = slot - hashmap->slots;                                                      \
+        size_t next = (index + 1) & (hashmap->capacity - 1);                                       \
+        while ( !(                                                                                 \
+            hashmap->slots[next].hash_or_flags == SH_SLOT_FREE ||                                  \
+            hashmap->slots[next].hash_or_flags == SH_SLOT_DELETED ||                               \
+            name##_probe_distance(hashmap, hashmap->slots[next].hash_or_flags, next) == 0          \
+        ) ) {                                                                                      \
+            hashmap->slots[index] = hashmap->slots[next];                                          \
+            index = next;                                                                          \
+            next = (index + 1) & (hashmap->capacity - 1);                                          \
+        }                                                                                          \
+                                                                                                   \
+        if (hashmap->slots[next].hash_or_flags == SH_SLOT_DELETED) {                               \
+            name##_tombstone_slot(hashmap, &hashmap->slots[index]);                                \
+        } else {                                                                                   \
+            memset(&hashmap->slots[index], 0, sizeof(hashmap->slots[index]));                      \
+            hashmap->length--;                                                                     \
+        }                                                                                          \
+    }                                                                                              \
+
+
+/**
+ * Internal macro that generates the probing functions of a hashmap with groups of control bytes
+ * (see SH_GEN_SWISS_IMPL()). Same functions as SH_GEN_LINEAR_PROBING(), see there for details.
+ * 
+ * The probing works on aligned groups of SH_GROUP_SIZE slots. We start at the group that contains
+ * the home slot of the hash and move on to the next group until we find a group with a free slot.
+ * Hashmaps with a capacity below SH_GROUP_SIZE (or that is not a multiple of it) have a partial
+ * last group. The control bytes are allocated for a full group and the bytes past the capacity are
+ * masked out.
+ */
+#define SH_GEN_SWISS_PROBING(name, key_t, value_t, key_cmp_expr)                                   \
+    /**                                                                                         */ \
+    /* Returns the number of slots that have to be allocated for the specified capacity. We     */ \
+    /* need additional space for the control bytes (rounded up to full groups).                 */ \
+    size_t name##_allocation_size(sh_size_t capacity) {                                            \
+        size_t ctrl_size = (capacity + SH_GROUP_SIZE - 1) / SH_GROUP_SIZE * SH_GROUP_SIZE;         \
+        size_t slot_size = sizeof(struct name##_slot);                                             \
+        return capacity + (ctrl_size + slot_size - 1) / slot_size;                                 \
     }                                                                                              \
                                                                                                    \
     /**                                                                                         */ \
-    /* Fetches the value for the specified key from the hashmap. In case the key isn't found    */ \
-    /* the `default_value` is returned.                                                         */ \
-    value_t name##_get(struct name* hashmap, key_t key, value_t default_value) {                   \
-        value_t* value_ptr = name##_get_ptr(hashmap, key);                                         \
-        return (value_ptr) ? *value_ptr : default_value;                                           \
+    /* Returns the control bytes of the hashmap. They're stored right after the slots.          */ \
+    uint8_t* name##_ctrl(struct name* hashmap) {                                                   \
+        return (uint8_t*)(hashmap->slots + hashmap->capacity);                                     \
     }                                                                                              \
                                                                                                    \
     /**                                                                                         */ \
-    /* Checks if the specified key exists in the hashmap. Is just as fast as name##_get() or    */ \
-    /* name##_get_ptr() so use those if you want to actually get a value. This function is      */ \
-    /* useful if you only need to know that the key is there.                                   */ \
-    /*                                                                                          */ \
-    /* Returns `true` if the key was found, `false` if not.                                     */ \
-    bool name##_contains(struct name* hashmap, key_t key) {                                        \
-        return (name##_get_ptr(hashmap, key) != NULL);                                             \
+    /* Returns a bitmask of the valid slots of the group starting at slot `base`. Only the last */ \
+    /* group of the hashmap can be a partial one.                                               */ \
+    uint32_t name##_group_mask(struct name* hashmap, sh_size_t base) {                             \
+        sh_size_t size = hashmap->capacity - base;                                                 \
+        return (size >= SH_GROUP_SIZE) ? (1u << SH_GROUP_SIZE) - 1 : (1u << size) - 1;             \
     }                                                                                              \
                                                                                                    \
     /**                                                                                         */ \
-    /* Returns an iterator pointing to the first item of the hashmap. Returns `NULL` if the     */ \
-    /* hashmap is empty. Meant to be used with name##_next() in a for loop to iterate over      */ \
-    /* all items in the hashmap:                                                                */ \
-    /*                                                                                          */ \
-    /*    for(hash_it_p it = hash_start(&hash); it != NULL; it = hash_next(&hash, it)) {        */ \
-    /*        it->key;    // access the key                                                     */ \
-    /*        it->value;  // access the value                                                   */ \
-    /*        hash_remove(&hash, it);  // remove the current item                               */ \
+    /* Prefetches the control bytes of the home group and the home slot of `hash` so a          */ \
+    /* following lookup doesn't have to wait for memory.                                        */ \
+    void name##_prefetch(struct name* hashmap, sh_hash_t hash) {                                   \
+        sh_size_t index = hash & (hashmap->capacity - 1);                                          \
+        SH_PREFETCH(name##_ctrl(hashmap) + index / SH_GROUP_SIZE * SH_GROUP_SIZE);                 \
+        SH_PREFETCH(&hashmap->slots[index]);                                                       \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Returns the slot that contains the specified key or `NULL` if the key is not in the      */ \
+    /* hashmap. Only slots whose control byte matches the top 8 bits of the hash are looked at. */ \
+    struct name##_slot* name##_find_slot(struct name* hashmap, key_t key, sh_hash_t hash) {        \
+        /* No slots at all, e.g. after a failed allocation in name##_new_with_capacity()        */ \
+        if (hashmap->capacity == 0)                                                                \
+            return NULL;                                                                           \
+        uint8_t* ctrl = name##_ctrl(hashmap);                                                      \
+        sh_size_t group_count = (hashmap->capacity + SH_GROUP_SIZE - 1) / SH_GROUP_SIZE;           \
+        sh_size_t group = (hash & (hashmap->capacity - 1)) / SH_GROUP_SIZE;                        \
+        for(sh_size_t i = 0; i < group_count; i++) {                                               \
+            sh_size_t base = group * SH_GROUP_SIZE;                                                \
+            uint32_t valid = name##_group_mask(hashmap, base);                                     \
+            uint32_t matches = sh_group_match(ctrl + base, sh_ctrl_byte(hash)) & valid;            \
+            while (matches) {                                                                      \
+                struct name##_slot* slot = &hashmap->slots[base + sh_lowest_bit(matches)];         \
+                if (slot->hash_or_flags == hash) {                                                 \
+                    key_t a = slot->key;                                                           \
+                    key_t b = key;                                                                 \
+                    if (key_cmp_expr)                                                              \
+                        return slot;                                                               \
+                }                                                                                  \
+                matches &= matches - 1;                                                            \
+            }                                                                                      \
+                                                                                                   \
+            if (sh_group_match(ctrl + base, SH_SLOT_FREE) & valid)                                 \
+                return NULL;                                                                       \
+            group = (group + 1) & (group_count - 1);                                               \
+        }                                                                                          \
+                                                                                                   \
+        return NULL;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Stores a new key in the free or deleted slot at `index` and returns the slot.            */ \
+    struct name##_slot* name##_fill_slot(struct name* hashmap, sh_size_t index, key_t key,         \
+        sh_hash_t hash) {                                                                          \
+        uint8_t* ctrl = name##_ctrl(hashmap);                                                      \
+        if (ctrl[index] == SH_SLOT_DELETED)                                                        \
+            hashmap->deleted--;                                                                    \
+        hashmap->length++;                                                                         \
+        ctrl[index] = sh_ctrl_byte(hash);                                                          \
+        hashmap->slots[index].hash_or_flags = hash;                                                \
+        hashmap->slots[index].key = key;                                                           \
+                                                                                                   \
+        return &hashmap->slots[index];                                                             \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Reserves a new slot for a key that is known to not be in the hashmap and returns it.     */ \
+    /* Keys are never compared. It DOESN'T check if the hashmap has a free slot. The first free */ \
+    /* or deleted slot of the probe sequence is used.                                           */ \
+    struct name##_slot* name##_insert_slot(struct name* hashmap, key_t key, sh_hash_t hash) {      \
+        uint8_t* ctrl = name##_ctrl(hashmap);                                                      \
+        sh_size_t group_count = (hashmap->capacity + SH_GROUP_SIZE - 1) / SH_GROUP_SIZE;           \
+        sh_size_t group = (hash & (hashmap->capacity - 1)) / SH_GROUP_SIZE;                        \
+        sh_size_t base = group * SH_GROUP_SIZE;                                                    \
+        uint32_t available = ~sh_group_filled(ctrl + base) & name##_group_mask(hashmap, base);     \
+        while (available == 0) {                                                                   \
+            group = (group + 1) & (group_count - 1);                                               \
+            base = group * SH_GROUP_SIZE;                                                          \
+            available = ~sh_group_filled(ctrl + base) & name##_group_mask(hashmap, base);          \
+        }                                                                                          \
+                                                                                                   \
+        return name##_fill_slot(hashmap, base + sh_lowest_bit(available), key, hash);              \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Returns the slot of the specified key. If the key isn't in the hashmap a new slot is     */ \
+    /* reserved for it and `*inserted` is set to `true`. It DOESN'T check if the hashmap has a  */ \
+    /* free slot.                                                                               */ \
+    /*                                                                                          */ \
+    /* Probes like name##_find_slot() and remembers the first free or deleted slot of the scan. */ \
+    /* That's the slot name##_insert_slot() would pick for a new key.                           */ \
+    struct name##_slot* name##_put_slot(struct name* hashmap, key_t key, sh_hash_t hash,           \
+        bool* inserted) {                                                                          \
+        uint8_t* ctrl = name##_ctrl(hashmap);                                                      \
+        sh_size_t group_count = (hashmap->capacity + SH_GROUP_SIZE - 1) / SH_GROUP_SIZE;           \
+        sh_size_t group = (hash & (hashmap->capacity - 1)) / SH_GROUP_SIZE;                        \
+        sh_size_t available_index = hashmap->capacity;                                             \
+        for(sh_size_t i = 0; i < group_count; i++) {                                               \
+            sh_size_t base = group * SH_GROUP_SIZE;                                                \
+            uint32_t valid = name##_group_mask(hashmap, base);                                     \
+            uint32_t matches = sh_group_match(ctrl + base, sh_ctrl_byte(hash)) & valid;            \
+            while (matches) {                                                                      \
+                struct name##_slot* slot = &hashmap->slots[base + sh_lowest_bit(matches)];         \
+                if (slot->hash_or_flags == hash) {                                                 \
+                    key_t a = slot->key;                                                           \
+                    key_t b = key;                                                                 \
+                    if (key_cmp_expr) {                                                            \
+                        *inserted = false;                                                         \
+                        return slot;                                                               \
+                    }                                                                              \
+                }                                                                                  \
+                matches &= matches - 1;                                                            \
+            }                                                                                      \
+                                                                                                   \
+            uint32_t available = ~sh_group_filled(ctrl + base) & valid;                            \
+            if (available && available_index == hashmap->capacity)                                 \
+                available_index = base + sh_lowest_bit(available);                                 \
+            if (sh_group_match(ctrl + base, SH_SLOT_FREE) & valid)                                 \
+                break;                                                                             \
+            group = (group + 1) & (group_count - 1);                                               \
+        }                                                                                          \
+                                                                                                   \
+        *inserted = true;                                                                          \
+        return name##_fill_slot(hashmap, available_index, key, hash);                              \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Marks a slot as deleted without touching any other slot. The key has to be cleaned up by */ \
+    /* the caller.                                                                              */ \
+    void name##_tombstone_slot(struct name* hashmap, struct name##_slot* slot) {                   \
+        name##_ctrl(hashmap)[slot - hashmap->slots] = SH_SLOT_DELETED;                             \
+        slot->hash_or_flags = SH_SLOT_DELETED;                                                     \
+        hashmap->length--;                                                                         \
+        hashmap->deleted++;                                                                        \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Deletes the item in a slot. The key has to be cleaned up by the caller.                  */ \
+    /*                                                                                          */ \
+    /* If the group of the slot still contains a free slot no lookup ever went past this group. */ \
+    /* So we can mark the slot as free, too. Otherwise it's marked as deleted.                  */ \
+    void name##_delete_slot(struct name* hashmap, struct name##_slot* slot) {                      \
+        sh_size_t index = slot - hashmap->slots;                                                   \
+        sh_size_t base = index / SH_GROUP_SIZE * SH_GROUP_SIZE;                                    \
+        uint8_t* ctrl = name##_ctrl(hashmap);                                                      \
+        if (sh_group_match(ctrl + base, SH_SLOT_FREE) & name##_group_mask(hashmap, base)) {        \
+            ctrl[index] = SH_SLOT_FREE;                                                            \
+            memset(slot, 0, sizeof(*slot));                                                        \
+            hashmap->length--;                                                                     \
+        } else {                                                                                   \
+            name##_tombstone_slot(hashmap, slot);                                                  \
+        }                                                                                          \
+    }                                                                                              \
+
+/**
+ * Internal macro that generates all public functions of a hashmap. They're build on top of the
+ * functions generated by one of the probing macros (e.g. SH_GEN_LINEAR_PROBING()). The arguments
+ * are the same as for SH_GEN_IMPL(). `destroy_expr` is executed at the end of name##_destroy(),
+ * SH_GEN_ARENA_DICT_IMPL() uses it to free the arena. If `per_key_cleanup` is `false`,
+ * name##_destroy() doesn't look at the keys at all (destroy_expr frees them in one go) and takes
+ * no longer for large hashmaps than for small ones. `mmap_gen` is the macro that generates
+ * name##_save() and friends: SH_GEN_MMAP_FUNCTIONS, or SH_GEN_NO_MMAP_FUNCTIONS for keys with
+ * pointers (see SH_GEN_DICT_IMPL()).
+ */
+#define SH_GEN_MAP_FUNCTIONS(name, key_t, value_t, key_hash_expr, key_put_expr, key_del_expr, calloc_expr, free_expr, destroy_expr, per_key_cleanup, mmap_gen)  \
+    /* Some forward declarations for internal functions.                                        */ \
+    bool     name##_resize(struct name* hashmap, sh_size_t new_capacity);                          \
+    value_t* name##_put_hashed(struct name* hashmap, key_t key, sh_hash_t hash, bool* inserted);   \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Initializes a new empty hashmap. A small capacity is allocated so the hashmap doesn't    */ \
+    /* need to be resized as soon as the first item is inserted.                                */ \
+    void name##_new(struct name* hashmap) {                                                        \
+        name##_new_with_capacity(hashmap, 0);                                                      \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Initializes a new empty hashmap with enough capacity for `length` items. They can be     */ \
+    /* inserted without any resizing. Use this when you know how many items will end up in the  */ \
+    /* hashmap.                                                                                 */ \
+    /*                                                                                          */ \
+    /* Returns `false` if the memory allocation failed. The hashmap is empty but still usable   */ \
+    /* in that case (it allocates memory with the first insert).                                */ \
+    bool name##_new_with_capacity(struct name* hashmap, size_t length) {                           \
+        *hashmap = (struct name){ 0 };                                                             \
+        hashmap->max_load = SH_MAX_LOAD;                                                           \
+        hashmap->min_load = SH_MIN_LOAD;                                                           \
+        hashmap->growth_factor = SH_GROWTH_FACTOR;                                                 \
+        sh_size_t capacity = sh_capacity_for(length, hashmap->max_load);                           \
+        return capacity != 0 && name##_resize(hashmap, capacity);                                  \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Grows the hashmap so it can hold `length` items (in total) without resizing. Does        */ \
+    /* nothing if the capacity is already large enough. Deleted slots also count against the    */ \
+    /* capacity, if the hashmap has to be resized they are cleaned up in the process.           */ \
+    /*                                                                                          */ \
+    /* Returns `false` if the memory allocation for the new capacity failed. In that case the   */ \
+    /* hashmap remains unchanged and can still be used.                                         */ \
+    bool name##_reserve(struct name* hashmap, size_t length) {                                     \
+        if ( !sh_needs_to_grow(length + hashmap->deleted, hashmap->capacity, hashmap->max_load) )  \
+            return true;                                                                           \
+        sh_size_t new_capacity = sh_capacity_for(length, hashmap->max_load);                       \
+        if (new_capacity == 0)                                                                     \
+            return false;                                                                          \
+        if (new_capacity < hashmap->capacity)                                                      \
+            new_capacity = hashmap->capacity;                                                      \
+        return name##_resize(hashmap, new_capacity);                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Changes when the hashmap is resized. It grows when more than `max_load` of its slots are */ \
+    /* used (including deleted slots) and then multiplies its capacity by `growth_factor`. It   */ \
+    /* shrinks when less than `min_load` of its slots are used, a `min_load` of 0 disables      */ \
+    /* shrinking. The defaults are SH_MAX_LOAD, SH_MIN_LOAD and SH_GROWTH_FACTOR (0.5, 0.25 and */ \
+    /* 2). Maps that should use little memory can run at a load of 0.85 or more (works best     */ \
+    /* with SH_GEN_RH_IMPL() or SH_GEN_SWISS_IMPL()). For maps with a lot of churn a `min_load` */ \
+    /* of 0 avoids shrinking altogether.                                                        */ \
+    /*                                                                                          */ \
+    /* The hashmap is grown right away if it's above the new `max_load`. It's shrunk on the     */ \
+    /* next name##_del() or name##_shrink_if_necessary().                                       */ \
+    /*                                                                                          */ \
+    /* Returns `false` if the arguments are invalid or growing failed. `max_load` has to be     */ \
+    /* between 0 and 1, `min_load` smaller than `max_load` and `growth_factor` a power of two   */ \
+    /* (at least 2). The hashmap keeps its previous load factors for invalid arguments.         */ \
+    bool name##_set_load_factors(struct name* hashmap, float max_load, float min_load,             \
+        uint32_t growth_factor) {                                                                  \
+        if ( !sh_valid_load_factors(max_load, min_load, growth_factor) )                           \
+            return false;                                                                          \
+        hashmap->max_load = max_load;                                                              \
+        hashmap->min_load = min_load;                                                              \
+        hashmap->growth_factor = growth_factor;                                                    \
+        return name##_reserve(hashmap, hashmap->length);                                           \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Destroys the hashmap. Cleans up all the keys be executing the key_del_expr for each one  */ \
+    /* and frees all associated memory. Hashmaps that own all their keys at once (e.g. in an    */ \
+    /* arena) skip the keys and just free the memory.                                           */ \
+    void name##_destroy(struct name* hashmap) {                                                    \
+        /* Execute key_del_expr for all keys still in the hashmap.                              */ \
+        if (per_key_cleanup) {                                                                     \
+            for(struct name##_slot* it = name##_start(hashmap); it;                                \
+                it = name##_next(hashmap, it)) {                                                   \
+                key_t key = it->key;                                                               \
+                key = key;  /* avoid unused variable warning                                    */ \
+                it->key = (key_del_expr);                                                          \
+                it->hash_or_flags = SH_SLOT_DELETED;                                               \
+            }                                                                                      \
+        }                                                                                          \
+                                                                                                   \
+        hashmap->length = 0;                                                                       \
+        hashmap->capacity = 0;                                                                     \
+        hashmap->deleted = 0;                                                                      \
+                                                                                                   \
+        /* ptr is used as an argument to the  free_expr which should free the  memory of ptr    */ \
+        /* like free() does.                                                                    */ \
+        void* ptr = hashmap->slots;                                                                \
+        ptr = ptr;  /* avoid unused variable warning if free_expr doesn't use ptr               */ \
+        free_expr;                                                                                 \
+        hashmap->slots = NULL;                                                                     \
+        (void)(destroy_expr);                                                                      \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Resizes the hashmap to the specified new capacity. All existing itmes are moved into the */ \
+    /* new hashmap. The hashes stored in the slots are reused, so key_hash_expr isn't executed  */ \
+    /* again (no strlen() and murmur3 for every key of a dictionary). Keys are not compared     */ \
+    /* either since they're known to be unique. The new capacity has to be a power of two.      */ \
+    /*                                                                                          */ \
+    /* Returns `true` if the resizing was successfull, `false` if the memory allocation for the */ \
+    /* new capacity failed. In that case the hashmap remains unchanged and can still be used.   */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    bool name##_resize(struct name* hashmap, sh_size_t new_capacity) {                             \
+        /* Can't make hashmap smaller than it needs to be.                                      */ \
+        if (new_capacity < hashmap->length)                                                        \
+            return false;                                                                          \
+        clock_t start_time = SH_RESIZE_CLOCK();                                                    \
+        start_time = start_time;  /* avoid unused variable warning if the hook ignores seconds  */ \
+                                                                                                   \
+        /* Starts as a copy so the load factors and any extra fields are kept.                 */ \
+        struct name new_hashmap = *hashmap;                                                        \
+        new_hashmap.length = 0;                                                                    \
+        new_hashmap.capacity = new_capacity;                                                       \
+        new_hashmap.deleted = 0;                                                                   \
+                                                                                                   \
+        /* capacity and slot_size variables are used to pass arguments to calloc_expr which in  */ \
+        /* turn should allocate memory like calloc() does. Some probing schemes need a bit more */ \
+        /* memory than just the slots, so capacity can be larger than new_capacity.             */ \
+        size_t capacity = name##_allocation_size(new_capacity);                                    \
+        size_t slot_size = sizeof(new_hashmap.slots[0]);                                           \
+        new_hashmap.slots = calloc_expr;                                                           \
+                                                                                                   \
+        /* Failed to allocate memory for new hashmap, leave the original untouched.             */ \
+        if (new_hashmap.slots == NULL)                                                             \
+            return false;                                                                          \
+                                                                                                   \
+        for(struct name##_slot* it = name##_start(hashmap); it; it = name##_next(hashmap, it))     \
+            name##_insert_slot(&new_hashmap, it->key, it->hash_or_flags)->value = it->value;       \
+                                                                                                   \
+        /* ptr is used as an argument to the free_expr which should free the memory of ptr like */ \
+        /* free() does.                                                                         */ \
+        void* ptr = hashmap->slots;                                                                \
+        ptr = ptr;  /* avoid unused variable warning if free_expr doesn't use ptr               */ \
+        free_expr;                                                                                 \
+        SH_RESIZE_STATS(#name, hashmap->capacity, new_capacity, new_hashmap.length,                \
+            (double)(SH_RESIZE_CLOCK() - start_time) / CLOCKS_PER_SEC);                            \
+        *hashmap = new_hashmap;                                                                    \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Inserts a new key-value pair into the hashmap, growing the hashmap if necessary. Returns */ \
+    /* a pointer to the storage for the value. That pointer can then be used to store the value */ \
+    /* itself in the hashmap. If the key is already in the hashmap the pointer to its value is  */ \
+    /* returned.                                                                                */ \
+    /*                                                                                          */ \
+    /* The returned pointer stays valid as long as the hashmap isn't chaned (not adding or      */ \
+    /* deleting items or resizing the hashmap). These operations potentiall force a resizing of */ \
+    /* the hashmap and thus probably invalidate the memory address. So make sure you don't      */ \
+    /* store the pointer somewhere or use it after a function that changes the hashmap.         */ \
+    /*                                                                                          */ \
+    /* Don't use this function while iterating over the hashmap. This function might resize the */ \
+    /* hashmap and thus invalidates the pointer used as iterator, possibly leading to segfaults */ \
+    /*                                                                                          */ \
+    /* Returns `NULL` if the hashmap needs to grow but failed to allocate more memory for that. */ \
+    value_t* name##_put_ptr(struct name* hashmap, key_t key) {                                     \
+        bool inserted = false;                                                                     \
+        return name##_put_hashed(hashmap, key, (key_hash_expr) | SH_SLOT_FILLED, &inserted);       \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Looks up the key and inserts it if it isn't in the hashmap yet, both with one probe.     */ \
+    /* Returns a pointer to the value of the key and sets `*inserted` to `true` if the key was  */ \
+    /* inserted. Only in that case the key_put_expr is executed (e.g. a string key is           */ \
+    /* duplicated) and the value is zeroed out. Useful for counting or memoization without a    */ \
+    /* name##_get_ptr() before each name##_put_ptr():                                           */ \
+    /*                                                                                          */ \
+    /*    bool inserted = false;                                                                */ \
+    /*    (*words_upsert(&words, word, &inserted))++;                                           */ \
+    /*                                                                                          */ \
+    /* The same rules as for name##_put_ptr() apply to the returned pointer. Returns `NULL` if  */ \
+    /* the hashmap needs to grow but failed to allocate more memory for that.                   */ \
+    value_t* name##_upsert(struct name* hashmap, key_t key, bool* inserted) {                      \
+        value_t* value_ptr = name##_put_hashed(hashmap, key, (key_hash_expr) | SH_SLOT_FILLED,     \
+            inserted);                                                                             \
+        if (value_ptr && *inserted)                                                                \
+            memset(value_ptr, 0, sizeof(*value_ptr));                                              \
+        return value_ptr;                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Same as name##_put_ptr() but with the hash of the key already calculated (including      */ \
+    /* SH_SLOT_FILLED). Sets `*inserted` to `true` if the key wasn't in the hashmap before. The */ \
+    /* key_put_expr is only executed in that case.                                              */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    value_t* name##_put_hashed(struct name* hashmap, key_t key, sh_hash_t hash, bool* inserted) {  \
+        *inserted = false;                                                                         \
+        sh_size_t used = hashmap->length + hashmap->deleted + 1;                                   \
+        if ( sh_needs_to_grow(used, hashmap->capacity, hashmap->max_load) ) {                      \
+            sh_size_t new_capacity = sh_grown_capacity(hashmap->capacity, hashmap->length,         \
+                hashmap->deleted, hashmap->max_load, hashmap->growth_factor);                      \
+            if ( name##_resize(hashmap, new_capacity) == false )                                   \
+                return NULL;                                                                       \
+        }                                                                                          \
+                                                                                                   \
+        struct name##_slot* slot = name##_put_slot(hashmap, key, hash, inserted);                  \
+        if (*inserted)                                                                             \
+            slot->key = (key_put_expr);                                                            \
+        return &slot->value;                                                                       \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Looks up the specified key in the hashmap and returns a pointer to the value stored for  */ \
+    /* that key. Returns `NULL` if the key could not be found.                                  */ \
+    /*                                                                                          */ \
+    /* The returned pointer stays valid as long as the hashmap isn't chaned (not adding or      */ \
+    /* deleting items or resizing the hashmap). These operations potentiall force a resizing of */ \
+    /* the hashmap and thus probably invalidate the memory address. So make sure you don't      */ \
+    /* store the pointer somewhere or use it after a function that changes the hashmap.         */ \
+    value_t* name##_get_ptr(struct name* hashmap, key_t key) {                                     \
+        sh_hash_t hash = (key_hash_expr) | SH_SLOT_FILLED;                                         \
+        struct name##_slot* slot = name##_find_slot(hashmap, key, hash);                           \
+        return (slot) ? &slot->value : NULL;                                                       \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Looks up `count` keys at once and stores a pointer to the value of each key in `values`  */ \
+    /* (`NULL` for keys that are not in the hashmap). Returns the number of keys that were      */ \
+    /* found. The same rules as for name##_get_ptr() apply to the returned pointers.            */ \
+    /*                                                                                          */ \
+    /* The keys are processed in blocks of SH_BATCH_SIZE. All keys of a block are hashed and    */ \
+    /* their slots are prefetched before the first one is looked up. This way the cache misses  */ \
+    /* of the lookups overlap instead of waiting for each one in turn. This makes a big         */ \
+    /* difference for hashmaps that don't fit into the cache.                                   */ \
+    size_t name##_get_many(struct name* hashmap, key_t* keys, size_t count, value_t** values) {    \
+        /* Without slots there is nothing to prefetch or find.                                  */ \
+        if (hashmap->capacity == 0) {                                                              \
+            for(size_t i = 0; i < count; i++)                                                      \
+                values[i] = NULL;                                                                  \
+            return 0;                                                                              \
+        }                                                                                          \
+                                                                                                   \
+        sh_hash_t hashes[SH_BATCH_SIZE];                                                           \
+        size_t found = 0;                                                                          \
+        for(size_t start = 0; start < count; start += SH_BATCH_SIZE) {                             \
+            size_t block_size = (count - start < SH_BATCH_SIZE) ? count - start : SH_BATCH_SIZE;   \
+            for(size_t i = 0; i < block_size; i++) {                                               \
+                key_t key = keys[start + i];                                                       \
+                key = key;  /* avoid unused variable warning if key_hash_expr doesn't use key   */ \
+                hashes[i] = (key_hash_expr) | SH_SLOT_FILLED;                                      \
+                name##_prefetch(hashmap, hashes[i]);                                               \
+            }                                                                                      \
+                                                                                                   \
+            for(size_t i = 0; i < block_size; i++) {                                               \
+                struct name##_slot* slot = name##_find_slot(hashmap, keys[start + i], hashes[i]);  \
+                values[start + i] = (slot) ? &slot->value : NULL;                                  \
+                if (slot)                                                                          \
+                    found++;                                                                       \
+            }                                                                                      \
+        }                                                                                          \
+                                                                                                   \
+        return found;                                                                              \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Inserts `count` key-value pairs at once. Existing values for the same keys are           */ \
+    /* overwritten. The hashmap is grown only once for the whole batch (see name##_reserve())   */ \
+    /* and the slots are prefetched like with name##_get_many().                                */ \
+    /*                                                                                          */ \
+    /* Returns `false` if the hashmap needs to grow but failed to allocate more memory for      */ \
+    /* that. In that case no key is inserted.                                                   */ \
+    bool name##_put_many(struct name* hashmap, key_t* keys, value_t* values, size_t count) {       \
+        if ( name##_reserve(hashmap, hashmap->length + count) == false )                           \
+            return false;                                                                          \
+                                                                                                   \
+        sh_hash_t hashes[SH_BATCH_SIZE];                                                           \
+        for(size_t start = 0; start < count; start += SH_BATCH_SIZE) {                             \
+            size_t block_size = (count - start < SH_BATCH_SIZE) ? count - start : SH_BATCH_SIZE;   \
+            for(size_t i = 0; i < block_size; i++) {                                               \
+                key_t key = keys[start + i];                                                       \
+                key = key;  /* avoid unused variable warning if key_hash_expr doesn't use key   */ \
+                hashes[i] = (key_hash_expr) | SH_SLOT_FILLED;                                      \
+                name##_prefetch(hashmap, hashes[i]);                                               \
+            }                                                                                      \
+                                                                                                   \
+            for(size_t i = 0; i < block_size; i++) {                                               \
+                key_t key = keys[start + i];                                                       \
+                bool inserted = false;                                                             \
+                struct name##_slot* slot = name##_put_slot(hashmap, key, hashes[i], &inserted);    \
+                if (inserted)                                                                      \
+                    slot->key = (key_put_expr);                                                    \
+                slot->value = values[start + i];                                                   \
+            }                                                                                      \
+        }                                                                                          \
+                                                                                                   \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Inserts an item of another hashmap with its stored hash or combines its value with the   */ \
+    /* one already in `dst`, see name##_merge(). Returns `false` if `dst` failed to grow.       */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    bool name##_merge_item(struct name* dst, key_t key, sh_hash_t hash, value_t value,             \
+        void (*combine)(value_t* dst_value, value_t src_value, void* data), void* data) {          \
+        bool inserted = false;                                                                     \
+        value_t* value_ptr = name##_put_hashed(dst, key, hash, &inserted);                         \
+        if (value_ptr == NULL)                                                                     \
+            return false;                                                                          \
+        if (inserted || combine == NULL)                                                           \
+            *value_ptr = value;                                                                    \
+        else                                                                                       \
+            combine(value_ptr, value, data);                                                       \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Merges all items of `src` into `dst`, e.g. the word counts of several threads into one   */ \
+    /* hashmap. Keys that are not in `dst` yet are inserted with their value (the key_put_expr  */ \
+    /* is executed for them). For keys in both hashmaps `combine` is called with a pointer to   */ \
+    /* the value in `dst`, the value in `src` and `data`:                                       */ \
+    /*                                                                                          */ \
+    /*    void add(int* dst_value, int src_value, void* data) {                                 */ \
+    /*        *dst_value += src_value;                                                          */ \
+    /*    }                                                                                     */ \
+    /*    words_merge(&total_counts, &thread_counts, add, NULL);                                */ \
+    /*                                                                                          */ \
+    /* If `combine` is `NULL` the values of `src` overwrite the ones in `dst`. `src` isn't      */ \
+    /* changed. The hashes stored in `src` are reused, so key_hash_expr isn't executed.         */ \
+    /*                                                                                          */ \
+    /* Returns `false` if `dst` needed to grow but failed to allocate more memory for that. In  */ \
+    /* that case only some items are merged.                                                    */ \
+    bool name##_merge(struct name* dst, struct name* src,                                          \
+        void (*combine)(value_t* dst_value, value_t src_value, void* data), void* data) {          \
+        for(struct name##_slot* it = name##_start(src); it; it = name##_next(src, it)) {           \
+            if ( !name##_merge_item(dst, it->key, it->hash_or_flags, it->value, combine, data) )   \
+                return false;                                                                      \
+        }                                                                                          \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Adds the number of items in each of the 2^partition_bits hash ranges (see                */ \
+    /* sh_partition()) to `counts`.                                                             */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    void name##_count_partitions(struct name* hashmap, uint32_t partition_bits, size_t* counts) {  \
+        for(struct name##_slot* it = name##_start(hashmap); it; it = name##_next(hashmap, it))     \
+            counts[sh_partition(it->hash_or_flags, partition_bits)]++;                             \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Writes the slot index of each item into `positions`, grouped by hash range. The items of */ \
+    /* range `i` go to `positions[cursors[i]]` onwards and `cursors[i]` is moved past them. So  */ \
+    /* `cursors` has to start with the first position of each range (the sum of the counts of   */ \
+    /* name##_count_partitions() of all ranges before it) and ends up with the end of each.     */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    void name##_scatter_partitions(struct name* hashmap, uint32_t partition_bits,                  \
+        size_t* cursors, sh_size_t* positions) {                                                   \
+        for(struct name##_slot* it = name##_start(hashmap); it; it = name##_next(hashmap, it)) {   \
+            uint32_t partition = sh_partition(it->hash_or_flags, partition_bits);                  \
+            positions[cursors[partition]++] = it - hashmap->slots;                                 \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Merges the `count` items of `src` at the slot indices in `positions` (see                */ \
+    /* name##_scatter_partitions()) into `dst` like name##_merge() does. This way each thread   */ \
+    /* of SH_GEN_CONCURRENT_IMPL() only touches the items of its own hash ranges.               */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    bool name##_merge_positions(struct name* dst, struct name* src, sh_size_t* positions,          \
+        size_t count, void (*combine)(value_t* dst_value, value_t src_value, void* data),          \
+        void* data) {                                                                              \
+        for(size_t i = 0; i < count; i++) {                                                        \
+            struct name##_slot* slot = &src->slots[positions[i]];                                  \
+            if ( !name##_merge_item(dst, slot->key, slot->hash_or_flags, slot->value, combine,     \
+                data) )                                                                            \
+                return false;                                                                      \
+        }                                                                                          \
+        return true;                                                                               \
+    }                                                                                              \
+    /**                                                                                         */ \
+    /* Initializes a new hashmap with the `count` key-value pairs from the `keys` and `values`  */ \
+    /* arrays. The hashmap is allocated with the final capacity right away and the pairs are    */ \
+    /* inserted without any resizing. If a key occurs more than once the last value wins.       */ \
+    /*                                                                                          */ \
+    /* Returns `false` if the memory allocation failed. The hashmap is empty but still usable   */ \
+    /* in that case.                                                                            */ \
+    bool name##_build_from_arrays(struct name* hashmap, key_t* keys, value_t* values,              \
+        size_t count) {                                                                            \
+        if ( name##_new_with_capacity(hashmap, count) == false )                                   \
+            return false;                                                                          \
+        return name##_put_many(hashmap, keys, values, count);                                      \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Deletes the key-value pair for the specified key from the hashmap. The hashmap is shrunk */ \
+    /* if it is to sparse. Even if no key was deleted. This way you can use this function to    */ \
+    /* with an arbitary (non-existing) key to shrink the hashmap if necessary after deleting    */ \
+    /* some items while iterating over the hashmap.                                             */ \
+    /*                                                                                          */ \
+    /* Returns `true` if the key-value pair was deleted, `false` if the key wasn't found in the */ \
+    /* hashmap.                                                                                 */ \
+    /*                                                                                          */ \
+    /* Don't use this function while iterating over the hashmap. This function might resize the */ \
+    /* hashmap and thus invalidates the pointer used as iterator, possibly leading to segfaults */ \
+    bool name##_del(struct name* hashmap, key_t key) {                                             \
+        sh_hash_t hash = (key_hash_expr) | SH_SLOT_FILLED;                                         \
+        struct name##_slot* slot = name##_find_slot(hashmap, key, hash);                           \
+        if (slot == NULL)                                                                          \
+            return false;                                                                          \
+                                                                                                   \
+        {                                                                                          \
+            /* Define a local variable named "key" that is used to pass the key of the deleted  */ \
+            /* item to key_del_expr. We can't use the function argument named "key" because the */ \
+            /* key_put_expr might have duplicated a string key. In that case the key_del_expr   */ \
+            /* expects to get exactly the value returned by key_put_expr... and that is the key */ \
+            /* stored in the deleted slot.                                                      */ \
+            key_t key = slot->key;                                                                 \
+            key = key;  /* avoid unused variable warning                                        */ \
+            slot->key = (key_del_expr);                                                            \
+        }                                                                                          \
+        name##_delete_slot(hashmap, slot);                                                         \
+                                                                                                   \
+        name##_shrink_if_necessary(hashmap);                                                       \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Inserts a value at the specified key into the hashmap. An existing value for the same    */ \
+    /* key is overwritten. The hashmap is grown if necessary.                                   */ \
+    /*                                                                                          */ \
+    /* Causes a segmentation fault in case the hashmap needs to grow but couldn't allocate the  */ \
+    /* necessary memory. Use name##_put_ptr() if you want to handle that case.                  */ \
+    /*                                                                                          */ \
+    /* Don't use this function while iterating over the hashmap. This function might resize the */ \
+    /* hashmap and thus invalidates the pointer used as iterator, possibly leading to segfaults */ \
+    void name##_put(struct name* hashmap, key_t key, value_t value) {                              \
+        *name##_put_ptr(hashmap, key) = value;                                                     \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Fetches the value for the specified key from the hashmap. In case the key isn't found    */ \
+    /* the `default_value` is returned.                                                         */ \
+    value_t name##_get(struct name* hashmap, key_t key, value_t default_value) {                   \
+        value_t* value_ptr = name##_get_ptr(hashmap, key);                                         \
+        return (value_ptr) ? *value_ptr : default_value;                                           \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Checks if the specified key exists in the hashmap. Is just as fast as name##_get() or    */ \
+    /* name##_get_ptr() so use those if you want to actually get a value. This function is      */ \
+    /* useful if you only need to know that the key is there.                                   */ \
+    /*                                                                                          */ \
+    /* Returns `true` if the key was found, `false` if not.                                     */ \
+    bool name##_contains(struct name* hashmap, key_t key) {                                        \
+        return (name##_get_ptr(hashmap, key) != NULL);                                             \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Returns an iterator pointing to the first item of the hashmap. Returns `NULL` if the     */ \
+    /* hashmap is empty. Meant to be used with name##_next() in a for loop to iterate over      */ \
+    /* all items in the hashmap:                                                                */ \
+    /*                                                                                          */ \
+    /*    for(hash_it_p it = hash_start(&hash); it != NULL; it = hash_next(&hash, it)) {        */ \
+    /*        it->key;    // access the key                                                     */ \
+    /*        it->value;  // access the value                                                   */ \
+    /*        hash_remove(&hash, it);  // remove the current item                               */ \
+    /*    }                                                                                     */ \
+    /*                                                                                          */ \
+    /*    // If you removed almost all items this will shrink the hashmap after the loop.       */ \
+    /*    // This is only needed in extreme cases.                                              */ \
+    /*    hash_shrink_if_necessary(&hash);                                                      */ \
+    /*                                                                                          */ \
+    /* You can't add new items to the hashmap during iteration (name##_put() or                 */ \
+    /* name##_put_ptr()) since that invalidates the pointer of the iterator (and might lead to  */ \
+    /* seg faults). name##_del() also can't be used during iteration (same problem) but you can */ \
+    /* use name##_remove() to mark the current item as deleted and call                         */ \
+    /* name##_shrink_if_necessary() if chances are that you deleted most items.                 */ \
+    /*                                                                                          */ \
+    struct name##_slot* name##_start(struct name* hashmap) {                                       \
+        /* We need to start at an invalid slot address since sh_next() increments it before it  */ \
+        /* looks at it (so it's safe).                                                          */ \
+        return name##_next(hashmap, hashmap->slots - 1);                                           \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Advances the iterator to the next item in the hashmap or returns `NULL` if there is no   */ \
+    /* next element.                                                                            */ \
+    /*                                                                                          */ \
+    /* See name##_start() for how to use this function.                                         */ \
+    struct name##_slot* name##_next(struct name* hashmap, struct name##_slot* it) {                \
+        if (it == NULL)                                                                            \
+            return NULL;                                                                           \
+                                                                                                   \
+        do {                                                                                       \
+            it++;                                                                                  \
+            /* Check if we're past the last slot.                                               */ \
+            if ((size_t)(it - hashmap->slots) >= hashmap->capacity)                                \
+                return NULL;                                                                       \
+        } while( it->hash_or_flags == SH_SLOT_FREE || it->hash_or_flags == SH_SLOT_DELETED );      \
+                                                                                                   \
+        return it;                                                                                 \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Removes the item the iterator points to from the hashmap. This function is meant to be   */ \
+    /* used while iterating over all items of the hashmap. The hashmap is not resized, even if  */ \
+    /* all items are removed. Instead it is shrunk at the next call to name##_del() or          */ \
+    /* name##_shrink_if_necessary().                                                            */ \
+    /*                                                                                          */ \
+    /* See name##_start() for how to use this function.                                         */ \
+    void name##_remove(struct name* hashmap, struct name##_slot* it) {                             \
+        if (it != NULL && it >= hashmap->slots                                                     \
+            && (size_t)(it - hashmap->slots) < hashmap->capacity) {                                \
+            key_t key = it->key;                                                                   \
+            key = key;  /* avoid unused variable warning                                        */ \
+            it->key = (key_del_expr);                                                              \
+            name##_tombstone_slot(hashmap, it);                                                    \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Shrinks the hashmap down if it became to sparse. Returns `true` if it was shrunk,        */ \
+    /* `false` if not. This function is meant to be called after you removed many items while   */ \
+    /* iterating over the hashmap and want to make sure you don't wast to much memory.          */ \
+    /*                                                                                          */ \
+    /* Implementation detail: Other functions assume that the capacity is always > 0 or they'll */ \
+    /* crash. Therefore this function only shrinks the capacity down to a minimal value but not */ \
+    /* 0.                                                                                       */ \
+    bool name##_shrink_if_necessary(struct name* hashmap) {                                        \
+        sh_size_t new_capacity = sh_shrunk_capacity(hashmap->length, hashmap->capacity,            \
+            hashmap->min_load, hashmap->max_load);                                                 \
+                                                                                                   \
+        if (new_capacity < hashmap->capacity) {                                                    \
+            name##_resize(hashmap, new_capacity);                                                  \
+            return true;                                                                           \
+        }                                                                                          \
+                                                                                                   \
+        return false;                                                                              \
+    }                                                                                              \
+                                                                                                   \
+    mmap_gen(name, key_t, value_t, key_hash_expr, NULL)                                            \
+
+/**
+ * Internal macro that generates all public functions of an incrementally resized hashmap (see
+ * SH_GEN_INCREMENTAL_IMPL()). Like SH_GEN_MAP_FUNCTIONS() they use the functions of a probing
+ * macro, for the old slots as well as the current ones. `mmap_gen` is the same as for
+ * SH_GEN_MAP_FUNCTIONS().
+ */
+#define SH_GEN_INCREMENTAL_MAP_FUNCTIONS(name, key_t, value_t, key_hash_expr, key_put_expr, key_del_expr, calloc_expr, free_expr, mmap_gen)  \
+    /* Some forward declarations for internal functions.                                        */ \
+    bool     name##_resize(struct name* hashmap, sh_size_t new_capacity);                          \
+    value_t* name##_put_hashed(struct name* hashmap, key_t key, sh_hash_t hash, bool* inserted);   \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Returns a hashmap that points to the old slots, so the probing functions can be used to  */ \
+    /* look for keys in them.                                                                   */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    struct name name##_old_hashmap(struct name* hashmap) {                                         \
+        struct name old_hashmap = { 0 };                                                           \
+        old_hashmap.capacity = hashmap->old_capacity;                                              \
+        old_hashmap.slots = hashmap->old_slots;                                                    \
+        return old_hashmap;                                                                        \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Returns the slot of the key in the old slots or `NULL` if it's not there (or there are   */ \
+    /* no old slots).                                                                           */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    struct name##_slot* name##_find_old_slot(struct name* hashmap, key_t key, sh_hash_t hash) {    \
+        if (hashmap->old_slots == NULL)                                                            \
+            return NULL;                                                                           \
+        struct name old_hashmap = name##_old_hashmap(hashmap);                                     \
+        return name##_find_slot(&old_hashmap, key, hash);                                          \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Removes a slot from the old slots. Items in the old slots are still counted in           */ \
+    /* `hashmap->length`.                                                                       */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    void name##_delete_old_slot(struct name* hashmap, struct name##_slot* slot) {                  \
+        slot->hash_or_flags = SH_SLOT_DELETED;                                                     \
+        hashmap->length--;                                                                         \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Moves the items of up to `slot_count` old slots into the current slots. The stored       */ \
+    /* hashes are used, so no key is hashed or compared. The old slots are freed when all of    */ \
+    /* them are moved.                                                                          */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    void name##_migrate(struct name* hashmap, sh_size_t slot_count) {                              \
+        if (hashmap->old_slots == NULL)                                                            \
+            return;                                                                                \
+                                                                                                   \
+        sh_size_t remaining = hashmap->old_capacity - hashmap->migrated;                           \
+        sh_size_t end = hashmap->migrated + ((slot_count < remaining) ? slot_count : remaining);   \
+        for(; hashmap->migrated < end; hashmap->migrated++) {                                      \
+            struct name##_slot* old_slot = &hashmap->old_slots[hashmap->migrated];                 \
+            if (old_slot->hash_or_flags & SH_SLOT_FILLED) {                                        \
+                struct name##_slot* slot = name##_insert_slot(hashmap, old_slot->key,              \
+                    old_slot->hash_or_flags);                                                      \
+                slot->value = old_slot->value;                                                     \
+                name##_delete_old_slot(hashmap, old_slot);                                         \
+            }                                                                                      \
+        }                                                                                          \
+                                                                                                   \
+        if (hashmap->migrated == hashmap->old_capacity) {                                          \
+            /* ptr is used as an argument to the free_expr which should free the memory of ptr  */ \
+            /* like free() does.                                                                */ \
+            void* ptr = hashmap->old_slots;                                                        \
+            ptr = ptr;  /* avoid unused variable warning if free_expr doesn't use ptr           */ \
+            free_expr;                                                                             \
+            hashmap->old_slots = NULL;                                                             \
+            hashmap->old_capacity = 0;                                                             \
+            hashmap->migrated = 0;                                                                 \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Initializes a new empty hashmap. A small capacity is allocated so the hashmap doesn't    */ \
+    /* need to be resized as soon as the first item is inserted.                                */ \
+    void name##_new(struct name* hashmap) {                                                        \
+        name##_new_with_capacity(hashmap, 0);                                                      \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Initializes a new empty hashmap with enough capacity for `length` items. They can be     */ \
+    /* inserted without any resizing. Use this when you know how many items will end up in the  */ \
+    /* hashmap.                                                                                 */ \
+    /*                                                                                          */ \
+    /* Returns `false` if the memory allocation failed. The hashmap is empty but still usable   */ \
+    /* in that case (it allocates memory with the first insert).                                */ \
+    bool name##_new_with_capacity(struct name* hashmap, size_t length) {                           \
+        *hashmap = (struct name){ 0 };                                                             \
+        hashmap->max_load = SH_MAX_LOAD;                                                           \
+        hashmap->min_load = SH_MIN_LOAD;                                                           \
+        hashmap->growth_factor = SH_GROWTH_FACTOR;                                                 \
+        sh_size_t capacity = sh_capacity_for(length, hashmap->max_load);                           \
+        return capacity != 0 && name##_resize(hashmap, capacity);                                  \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Grows the hashmap so it can hold `length` items (in total) without resizing. Does        */ \
+    /* nothing if the capacity is already large enough. Deleted slots also count against the    */ \
+    /* capacity, if the hashmap has to be resized they are cleaned up in the process.           */ \
+    /*                                                                                          */ \
+    /* Returns `false` if the memory allocation for the new capacity failed. In that case the   */ \
+    /* hashmap remains unchanged and can still be used.                                         */ \
+    bool name##_reserve(struct name* hashmap, size_t length) {                                     \
+        if ( !sh_needs_to_grow(length + hashmap->deleted, hashmap->capacity, hashmap->max_load) )  \
+            return true;                                                                           \
+        sh_size_t new_capacity = sh_capacity_for(length, hashmap->max_load);                       \
+        if (new_capacity == 0)                                                                     \
+            return false;                                                                          \
+        if (new_capacity < hashmap->capacity)                                                      \
+            new_capacity = hashmap->capacity;                                                      \
+        return name##_resize(hashmap, new_capacity);                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Changes when the hashmap is resized. See name##_set_load_factors() of                    */ \
+    /* SH_GEN_MAP_FUNCTIONS().                                                                  */ \
+    bool name##_set_load_factors(struct name* hashmap, float max_load, float min_load,             \
+        uint32_t growth_factor) {                                                                  \
+        if ( !sh_valid_load_factors(max_load, min_load, growth_factor) )                           \
+            return false;                                                                          \
+        hashmap->max_load = max_load;                                                              \
+        hashmap->min_load = min_load;                                                              \
+        hashmap->growth_factor = growth_factor;                                                    \
+        return name##_reserve(hashmap, hashmap->length);                                           \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Destroys the hashmap. Cleans up all the keys be executing the key_del_expr for each one  */ \
+    /* and frees all associated memory.                                                         */ \
+    void name##_destroy(struct name* hashmap) {                                                    \
+        /* Execute key_del_expr for all keys still in the hashmap (current and old slots).      */ \
+        for(struct name##_slot* it = name##_start(hashmap); it; it = name##_next(hashmap, it)) {   \
+            key_t key = it->key;                                                                   \
+            key = key;  /* avoid unused variable warning                                        */ \
+            it->key = (key_del_expr);                                                              \
+        }                                                                                          \
+                                                                                                   \
+        /* ptr is used as an argument to the  free_expr which should free the  memory of ptr    */ \
+        /* like free() does.                                                                    */ \
+        void* ptr = hashmap->slots;                                                                \
+        ptr = ptr;  /* avoid unused variable warning if free_expr doesn't use ptr               */ \
+        free_expr;                                                                                 \
+        if (hashmap->old_slots) {                                                                  \
+            ptr = hashmap->old_slots;                                                              \
+            free_expr;                                                                             \
+        }                                                                                          \
+                                                                                                   \
+        hashmap->length = 0;                                                                       \
+        hashmap->capacity = 0;                                                                     \
+        hashmap->deleted = 0;                                                                      \
+        hashmap->slots = NULL;                                                                     \
+        hashmap->old_slots = NULL;                                                                 \
+        hashmap->old_capacity = 0;                                                                 \
+        hashmap->migrated = 0;                                                                     \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Starts to resize the hashmap to the specified new capacity (has to be a power of two).   */ \
+    /* Allocates the new slots and keeps the current ones as old slots. Their items are moved   */ \
+    /* over by the following ..._put() and ..._del() calls. If items of a previous resize still */ \
+    /* need to be moved that is done right away.                                                */ \
+    /*                                                                                          */ \
+    /* Returns `true` if the resizing was successfull, `false` if the memory allocation for the */ \
+    /* new capacity failed. In that case the hashmap remains unchanged and can still be used.   */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    bool name##_resize(struct name* hashmap, sh_size_t new_capacity) {                             \
+        /* Can't make hashmap smaller than it needs to be.                                      */ \
+        if (new_capacity < hashmap->length)                                                        \
+            return false;                                                                          \
+        clock_t start_time = SH_RESIZE_CLOCK();                                                    \
+        start_time = start_time;  /* avoid unused variable warning if the hook ignores seconds  */ \
+                                                                                                   \
+        /* capacity and slot_size variables are used to pass arguments to calloc_expr which in  */ \
+        /* turn should allocate memory like calloc() does.                                      */ \
+        size_t capacity = name##_allocation_size(new_capacity);                                    \
+        size_t slot_size = sizeof(hashmap->slots[0]);                                              \
+        struct name##_slot* new_slots = calloc_expr;                                               \
+                                                                                                   \
+        /* Failed to allocate memory for new hashmap, leave the original untouched.             */ \
+        if (new_slots == NULL)                                                                     \
+            return false;                                                                          \
+                                                                                                   \
+        name##_migrate(hashmap, SH_SIZE_MAX);                                                      \
+        if (hashmap->slots) {                                                                      \
+            hashmap->old_slots = hashmap->slots;                                                   \
+            hashmap->old_capacity = hashmap->capacity;                                             \
+            hashmap->migrated = 0;                                                                 \
+        }                                                                                          \
+        hashmap->slots = new_slots;                                                                \
+        hashmap->capacity = new_capacity;                                                          \
+        hashmap->deleted = 0;                                                                      \
+                                                                                                   \
+        SH_RESIZE_STATS(#name, hashmap->old_capacity, new_capacity, hashmap->length,               \
+            (double)(SH_RESIZE_CLOCK() - start_time) / CLOCKS_PER_SEC);                            \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Inserts a new key-value pair into the hashmap, growing the hashmap if necessary. Returns */ \
+    /* a pointer to the storage for the value. If the key is already in the hashmap the pointer */ \
+    /* to its value is returned. A key that is still in the old slots is moved over. See        */ \
+    /* name##_put_ptr() of SH_GEN_MAP_FUNCTIONS() for details.                                  */ \
+    /*                                                                                          */ \
+    /* Returns `NULL` if the hashmap needs to grow but failed to allocate more memory for that. */ \
+    value_t* name##_put_ptr(struct name* hashmap, key_t key) {                                     \
+        bool inserted = false;                                                                     \
+        return name##_put_hashed(hashmap, key, (key_hash_expr) | SH_SLOT_FILLED, &inserted);       \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Looks up the key and inserts it if it isn't in the hashmap yet, both with one probe. A   */ \
+    /* key that is still in the old slots is moved over. See name##_upsert() of                 */ \
+    /* SH_GEN_MAP_FUNCTIONS() for details.                                                      */ \
+    value_t* name##_upsert(struct name* hashmap, key_t key, bool* inserted) {                      \
+        value_t* value_ptr = name##_put_hashed(hashmap, key, (key_hash_expr) | SH_SLOT_FILLED,     \
+            inserted);                                                                             \
+        if (value_ptr && *inserted)                                                                \
+            memset(value_ptr, 0, sizeof(*value_ptr));                                              \
+        return value_ptr;                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Same as name##_put_ptr() but with the hash of the key already calculated (including      */ \
+    /* SH_SLOT_FILLED). Sets `*inserted` to `true` if the key wasn't in the hashmap before      */ \
+    /* (also not in the old slots). See name##_put_hashed() of SH_GEN_MAP_FUNCTIONS().          */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    value_t* name##_put_hashed(struct name* hashmap, key_t key, sh_hash_t hash, bool* inserted) {  \
+        *inserted = false;                                                                         \
+        name##_migrate(hashmap, SH_MIGRATE_SLOTS);                                                 \
+        sh_size_t used = hashmap->length + hashmap->deleted + 1;                                   \
+        if ( sh_needs_to_grow(used, hashmap->capacity, hashmap->max_load) ) {                      \
+            sh_size_t new_capacity = sh_grown_capacity(hashmap->capacity, hashmap->length,         \
+                hashmap->deleted, hashmap->max_load, hashmap->growth_factor);                      \
+            if ( name##_resize(hashmap, new_capacity) == false )                                   \
+                return NULL;                                                                       \
+        }                                                                                          \
+                                                                                                   \
+        struct name##_slot* slot = name##_put_slot(hashmap, key, hash, inserted);                  \
+        if (*inserted) {                                                                           \
+            struct name##_slot* old_slot = name##_find_old_slot(hashmap, key, hash);               \
+            if (old_slot) {                                                                        \
+                slot->key = old_slot->key;                                                         \
+                slot->value = old_slot->value;                                                     \
+                name##_delete_old_slot(hashmap, old_slot);                                         \
+                *inserted = false;                                                                 \
+            } else {                                                                               \
+                slot->key = (key_put_expr);                                                        \
+            }                                                                                      \
+        }                                                                                          \
+        return &slot->value;                                                                       \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Looks up the specified key in the hashmap and returns a pointer to the value stored for  */ \
+    /* that key. Returns `NULL` if the key could not be found. Doesn't move any items.          */ \
+    value_t* name##_get_ptr(struct name* hashmap, key_t key) {                                     \
+        sh_hash_t hash = (key_hash_expr) | SH_SLOT_FILLED;                                         \
+        struct name##_slot* slot = name##_find_slot(hashmap, key, hash);                           \
+        if (slot == NULL)                                                                          \
+            slot = name##_find_old_slot(hashmap, key, hash);                                       \
+        return (slot) ? &slot->value : NULL;                                                       \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Prefetches the home slot of `hash` in the current slots and, while items are moved, in   */ \
+    /* the old slots.                                                                           */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    void name##_prefetch_slots(struct name* hashmap, sh_hash_t hash) {                             \
+        name##_prefetch(hashmap, hash);                                                            \
+        if (hashmap->old_slots) {                                                                  \
+            struct name old_hashmap = name##_old_hashmap(hashmap);                                 \
+            name##_prefetch(&old_hashmap, hash);                                                   \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Looks up `count` keys at once. See name##_get_many() of SH_GEN_MAP_FUNCTIONS(). The      */ \
+    /* current and the old slots of each block of keys are prefetched.                         */  \
+    size_t name##_get_many(struct name* hashmap, key_t* keys, size_t count, value_t** values) {    \
+        /* Without slots there is nothing to prefetch or find.                                  */ \
+        if (hashmap->capacity == 0) {                                                              \
+            for(size_t i = 0; i < count; i++)                                                      \
+                values[i] = NULL;                                                                  \
+            return 0;                                                                              \
+        }                                                                                          \
+                                                                                                   \
+        sh_hash_t hashes[SH_BATCH_SIZE];                                                           \
+        size_t found = 0;                                                                          \
+        for(size_t start = 0; start < count; start += SH_BATCH_SIZE) {                             \
+            size_t block_size = (count - start < SH_BATCH_SIZE) ? count - start : SH_BATCH_SIZE;   \
+            for(size_t i = 0; i < block_size; i++) {                                               \
+                key_t key = keys[start + i];                                                       \
+                key = key;  /* avoid unused variable warning if key_hash_expr doesn't use key   */ \
+                hashes[i] = (key_hash_expr) | SH_SLOT_FILLED;                                      \
+                name##_prefetch_slots(hashmap, hashes[i]);                                         \
+            }                                                                                      \
+                                                                                                   \
+            for(size_t i = 0; i < block_size; i++) {                                               \
+                key_t key = keys[start + i];                                                       \
+                struct name##_slot* slot = name##_find_slot(hashmap, key, hashes[i]);              \
+                if (slot == NULL)                                                                  \
+                    slot = name##_find_old_slot(hashmap, key, hashes[i]);                          \
+                values[start + i] = (slot) ? &slot->value : NULL;                                  \
+                if (slot)                                                                          \
+                    found++;                                                                       \
+            }                                                                                      \
+        }                                                                                          \
+                                                                                                   \
+        return found;                                                                              \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Inserts `count` key-value pairs at once. See name##_put_many() of                        */ \
+    /* SH_GEN_MAP_FUNCTIONS(). The hashmap is grown only once for the whole batch and each put  */ \
+    /* still moves SH_MIGRATE_SLOTS of the old slots.                                           */ \
+    bool name##_put_many(struct name* hashmap, key_t* keys, value_t* values, size_t count) {       \
+        if ( name##_reserve(hashmap, hashmap->length + count) == false )                           \
+            return false;                                                                          \
+                                                                                                   \
+        sh_hash_t hashes[SH_BATCH_SIZE];                                                           \
+        for(size_t start = 0; start < count; start += SH_BATCH_SIZE) {                             \
+            size_t block_size = (count - start < SH_BATCH_SIZE) ? count - start : SH_BATCH_SIZE;   \
+            for(size_t i = 0; i < block_size; i++) {                                               \
+                key_t key = keys[start + i];                                                       \
+                key = key;  /* avoid unused variable warning if key_hash_expr doesn't use key   */ \
+                hashes[i] = (key_hash_expr) | SH_SLOT_FILLED;                                      \
+                name##_prefetch_slots(hashmap, hashes[i]);                                         \
+            }                                                                                      \
+                                                                                                   \
+            for(size_t i = 0; i < block_size; i++) {                                               \
+                bool inserted = false;                                                             \
+                value_t* value_ptr = name##_put_hashed(hashmap, keys[start + i], hashes[i],        \
+                    &inserted);                                                                    \
+                if (value_ptr == NULL)                                                             \
+                    return false;                                                                  \
+                *value_ptr = values[start + i];                                                    \
+            }                                                                                      \
+        }                                                                                          \
+                                                                                                   \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Inserts or combines one item of another hashmap, see name##_merge_item() of              */ \
+    /* SH_GEN_MAP_FUNCTIONS().                                                                  */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    bool name##_merge_item(struct name* dst, key_t key, sh_hash_t hash, value_t value,             \
+        void (*combine)(value_t* dst_value, value_t src_value, void* data), void* data) {          \
+        bool inserted = false;                                                                     \
+        value_t* value_ptr = name##_put_hashed(dst, key, hash, &inserted);                         \
+        if (value_ptr == NULL)                                                                     \
+            return false;                                                                          \
+        if (inserted || combine == NULL)                                                           \
+            *value_ptr = value;                                                                    \
+        else                                                                                       \
+            combine(value_ptr, value, data);                                                       \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Merges all items of `src` into `dst`. See name##_merge() of SH_GEN_MAP_FUNCTIONS().      */ \
+    bool name##_merge(struct name* dst, struct name* src,                                          \
+        void (*combine)(value_t* dst_value, value_t src_value, void* data), void* data) {          \
+        for(struct name##_slot* it = name##_start(src); it; it = name##_next(src, it)) {           \
+            if ( !name##_merge_item(dst, it->key, it->hash_or_flags, it->value, combine, data) )   \
+                return false;                                                                      \
+        }                                                                                          \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Adds the number of items in each of the 2^partition_bits hash ranges (see                */ \
+    /* sh_partition()) to `counts`.                                                             */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    void name##_count_partitions(struct name* hashmap, uint32_t partition_bits, size_t* counts) {  \
+        for(struct name##_slot* it = name##_start(hashmap); it; it = name##_next(hashmap, it))     \
+            counts[sh_partition(it->hash_or_flags, partition_bits)]++;                             \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Writes the position of each item into `positions`, grouped by hash range. See            */ \
+    /* name##_scatter_partitions() of SH_GEN_MAP_FUNCTIONS(). Items in the old slots get the    */ \
+    /* position `capacity + index`.                                                             */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    void name##_scatter_partitions(struct name* hashmap, uint32_t partition_bits,                  \
+        size_t* cursors, sh_size_t* positions) {                                                   \
+        for(struct name##_slot* it = name##_start(hashmap); it; it = name##_next(hashmap, it)) {   \
+            bool in_slots = (it >= hashmap->slots && it < hashmap->slots + hashmap->capacity);     \
+            uint32_t partition = sh_partition(it->hash_or_flags, partition_bits);                  \
+            positions[cursors[partition]++] = in_slots ? (sh_size_t)(it - hashmap->slots)          \
+                : hashmap->capacity + (sh_size_t)(it - hashmap->old_slots);                        \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Merges the `count` items of `src` at `positions` into `dst`. See                         */ \
+    /* name##_merge_positions() of SH_GEN_MAP_FUNCTIONS().                                      */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    bool name##_merge_positions(struct name* dst, struct name* src, sh_size_t* positions,          \
+        size_t count, void (*combine)(value_t* dst_value, value_t src_value, void* data),          \
+        void* data) {                                                                              \
+        for(size_t i = 0; i < count; i++) {                                                        \
+            struct name##_slot* slot = (positions[i] < src->capacity) ? &src->slots[positions[i]]  \
+                : &src->old_slots[positions[i] - src->capacity];                                   \
+            if ( !name##_merge_item(dst, slot->key, slot->hash_or_flags, slot->value, combine,     \
+                data) )                                                                            \
+                return false;                                                                      \
+        }                                                                                          \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Initializes a new hashmap with the `count` key-value pairs from the `keys` and `values`  */ \
+    /* arrays. The hashmap is allocated with the final capacity right away and the pairs are    */ \
+    /* inserted without any resizing. If a key occurs more than once the last value wins.       */ \
+    /*                                                                                          */ \
+    /* Returns `false` if the memory allocation failed. The hashmap is empty but still usable   */ \
+    /* in that case.                                                                            */ \
+    bool name##_build_from_arrays(struct name* hashmap, key_t* keys, value_t* values,              \
+        size_t count) {                                                                            \
+        if ( name##_new_with_capacity(hashmap, count) == false )                                   \
+            return false;                                                                          \
+        return name##_put_many(hashmap, keys, values, count);                                      \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Deletes the key-value pair for the specified key from the hashmap. The hashmap is shrunk */ \
+    /* if it is to sparse (unless items of a previous resize are still moved).                  */ \
+    /*                                                                                          */ \
+    /* Returns `true` if the key-value pair was deleted, `false` if the key wasn't found in the */ \
+    /* hashmap.                                                                                 */ \
+    bool name##_del(struct name* hashmap, key_t key) {                                             \
+        name##_migrate(hashmap, SH_MIGRATE_SLOTS);                                                 \
+                                                                                                   \
+        sh_hash_t hash = (key_hash_expr) | SH_SLOT_FILLED;                                         \
+        struct name##_slot* slot = name##_find_slot(hashmap, key, hash);                           \
+        struct name##_slot* old_slot = (slot) ? NULL : name##_find_old_slot(hashmap, key, hash);   \
+        if (slot == NULL && old_slot == NULL)                                                      \
+            return false;                                                                          \
+                                                                                                   \
+        name##_remove(hashmap, (slot) ? slot : old_slot);                                          \
+        name##_shrink_if_necessary(hashmap);                                                       \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Inserts a value at the specified key into the hashmap. An existing value for the same    */ \
+    /* key is overwritten. The hashmap is grown if necessary.                                   */ \
+    void name##_put(struct name* hashmap, key_t key, value_t value) {                              \
+        *name##_put_ptr(hashmap, key) = value;                                                     \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Fetches the value for the specified key from the hashmap. In case the key isn't found    */ \
+    /* the `default_value` is returned.                                                         */ \
+    value_t name##_get(struct name* hashmap, key_t key, value_t default_value) {                   \
+        value_t* value_ptr = name##_get_ptr(hashmap, key);                                         \
+        return (value_ptr) ? *value_ptr : default_value;                                           \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Checks if the specified key exists in the hashmap.                                       */ \
+    bool name##_contains(struct name* hashmap, key_t key) {                                        \
+        return (name##_get_ptr(hashmap, key) != NULL);                                             \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Returns an iterator pointing to the first item of the hashmap. Returns `NULL` if the     */ \
+    /* hashmap is empty. Iterates over the current slots and then the old ones. See             */ \
+    /* name##_start() of SH_GEN_MAP_FUNCTIONS() for how to use it.                              */ \
+    struct name##_slot* name##_start(struct name* hashmap) {                                       \
+        /* We need to start at an invalid slot address since sh_next() increments it before it  */ \
+        /* looks at it (so it's safe).                                                          */ \
+        return name##_next(hashmap, hashmap->slots - 1);                                           \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Advances the iterator to the next item in the hashmap or returns `NULL` if there is no   */ \
+    /* next element.                                                                            */ \
+    struct name##_slot* name##_next(struct name* hashmap, struct name##_slot* it) {                \
+        if (it == NULL)                                                                            \
+            return NULL;                                                                           \
+                                                                                                   \
+        struct name##_slot* end = hashmap->slots + hashmap->capacity;                              \
+        if (it >= hashmap->slots - 1 && it < end) {                                                \
+            do {                                                                                   \
+                it++;                                                                              \
+            } while( it < end && !(it->hash_or_flags & SH_SLOT_FILLED) );                          \
+            if (it < end)                                                                          \
+                return it;                                                                         \
+            if (hashmap->old_slots == NULL)                                                        \
+                return NULL;                                                                       \
+            /* All old slots before the migrated ones are empty                                 */ \
+            it = hashmap->old_slots + hashmap->migrated - 1;                                       \
+        }                                                                                          \
+                                                                                                   \
+        end = hashmap->old_slots + hashmap->old_capacity;                                          \
+        do {                                                                                       \
+            it++;                                                                                  \
+        } while( it < end && !(it->hash_or_flags & SH_SLOT_FILLED) );                              \
+        return (it < end) ? it : NULL;                                                             \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Removes the item the iterator points to from the hashmap. This function is meant to be   */ \
+    /* used while iterating over the hashmap. The hashmap is not resized.                       */ \
+    void name##_remove(struct name* hashmap, struct name##_slot* it) {                             \
+        bool in_slots = (it >= hashmap->slots && it < hashmap->slots + hashmap->capacity);         \
+        bool in_old_slots = (hashmap->old_slots && it >= hashmap->old_slots &&                     \
+            it < hashmap->old_slots + hashmap->old_capacity);                                      \
+        if (it != NULL && (in_slots || in_old_slots) && (it->hash_or_flags & SH_SLOT_FILLED)) {    \
+            key_t key = it->key;                                                                   \
+            key = key;  /* avoid unused variable warning                                        */ \
+            it->key = (key_del_expr);                                                              \
+            if (in_slots)                                                                          \
+                name##_delete_slot(hashmap, it);                                                   \
+            else                                                                                   \
+                name##_delete_old_slot(hashmap, it);                                               \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Shrinks the hashmap down if it became to sparse. Returns `true` if it was shrunk,        */ \
+    /* `false` if not. Doesn't shrink while items of a previous resize are still moved.         */ \
+    bool name##_shrink_if_necessary(struct name* hashmap) {                                        \
+        if (hashmap->old_slots)                                                                    \
+            return false;                                                                          \
+                                                                                                   \
+        sh_size_t new_capacity = sh_shrunk_capacity(hashmap->length, hashmap->capacity,            \
+            hashmap->min_load, hashmap->max_load);                                                 \
+                                                                                                   \
+        if (new_capacity < hashmap->capacity) {                                                    \
+            name##_resize(hashmap, new_capacity);                                                  \
+            return true;                                                                           \
+        }                                                                                          \
+                                                                                                   \
+        return false;                                                                              \
+    }                                                                                              \
+                                                                                                   \
+    mmap_gen(name, key_t, value_t, key_hash_expr, name##_migrate(hashmap, SH_SIZE_MAX))            \
+
+/**
+ * Declares a hashmap that stores the hashes, keys and values of its slots in three separate arrays
+ * (structure of arrays, SoA). Use SH_GEN_SOA_HASH_IMPL(), SH_GEN_SOA_DICT_IMPL() or
+ * SH_GEN_SOA_IMPL() with the same first three arguments to generate the implementation.
+ * 
+ * Probing only scans the dense hash and key arrays. The value array is only touched for the slot
+ * that matched. This helps with large values (which would otherwise be dragged through the cache
+ * while probing) and avoids padding between the fields of a slot (an int64_t -> int slot takes 24
+ * bytes, in the separate arrays it's 16 bytes).
+ * 
+ * The API is the same as with SH_GEN_DECL() except for iteration. There is no slot struct, an
+ * iterator is just the index of a slot. Use the keys and values arrays to access the item:
+ * 
+ *     for(sh_size_t i = soa_start(&soa); i < soa.capacity; i = soa_next(&soa, i)) {
+ *         soa.keys[i];    // access the key
+ *         soa.values[i];  // access the value
+ *         soa_remove(&soa, i);  // remove the current item
+ *     }
+ * 
+ * If SLIM_HASH_NO_TYPEDEFS is defined no typedefs for shorthand types ending with ..._t and ..._p
+ * are defined.
+ */
+#ifdef SLIM_HASH_NO_TYPEDEFS
+    #define SH_GEN_SOA_DECL(name, key_t, value_t)                                                  \
+        SH_GEN_SOA_TYPES_AND_PROTOTYPES(name, key_t, value_t)
+#else
+    #define SH_GEN_SOA_DECL(name, key_t, value_t)                                                  \
+        SH_GEN_SOA_TYPES_AND_PROTOTYPES(name, key_t, value_t)                                      \
+        typedef struct name name##_t, *name##_p;
+#endif
+
+#define SH_GEN_SOA_TYPES_AND_PROTOTYPES(name, key_t, value_t)                                      \
+    struct name {                                                                                  \
+        sh_size_t  length, capacity, deleted;                                                      \
+        sh_hash_t* hashes;  /* hash_or_flags of each slot                                       */ \
+        key_t*     keys;                                                                           \
+        value_t*   values;                                                                         \
+        /* When to grow and shrink, see name##_set_load_factors() of SH_GEN_MAP_FUNCTIONS()     */ \
+        float      max_load, min_load;                                                             \
+        uint32_t   growth_factor;                                                                  \
+    };                                                                                             \
+                                                                                                   \
+    void     name##_new(struct name* hashmap);                                                     \
+    bool     name##_new_with_capacity(struct name* hashmap, size_t length);                        \
+    bool     name##_build_from_arrays(struct name* hashmap, key_t* keys, value_t* values,          \
+                 size_t count);                                                                    \
+    void     name##_destroy(struct name* hashmap);                                                 \
+    bool     name##_reserve(struct name* hashmap, size_t length);                                  \
+    bool     name##_set_load_factors(struct name* hashmap, float max_load, float min_load,         \
+                 uint32_t growth_factor);                                                          \
+                                                                                                   \
+    value_t  name##_get(struct name* hashmap, key_t key, value_t default_value);                   \
+    void     name##_put(struct name* hashmap, key_t key, value_t value);                           \
+    bool     name##_del(struct name* hashmap, key_t key);                                          \
+    bool     name##_contains(struct name* hashmap, key_t key);                                     \
+                                                                                                   \
+    value_t* name##_get_ptr(struct name* hashmap, key_t key);                                      \
+    value_t* name##_put_ptr(struct name* hashmap, key_t key);                                      \
+    value_t* name##_upsert(struct name* hashmap, key_t key, bool* inserted);                       \
+                                                                                                   \
+    size_t   name##_get_many(struct name* hashmap, key_t* keys, size_t count, value_t** values);   \
+    bool     name##_put_many(struct name* hashmap, key_t* keys, value_t* values, size_t count);    \
+                                                                                                   \
+    bool     name##_merge(struct name* dst, struct name* src,                                      \
+                 void (*combine)(value_t* dst_value, value_t src_value, void* data), void* data);  \
+                                                                                                   \
+    sh_size_t name##_start(struct name* hashmap);                                                  \
+    sh_size_t name##_next(struct name* hashmap, sh_size_t index);                                  \
+    void      name##_remove(struct name* hashmap, sh_size_t index);                                \
+    bool      name##_shrink_if_necessary(struct name* hashmap);                                    \
+                                                                                                   \
+    SH_GEN_MMAP_PROTOTYPES(name)                                                                   \
+
+
+/**
+ * Same as SH_GEN_HASH_IMPL() but for hashmaps declared with SH_GEN_SOA_DECL().
+ */
+#define SH_GEN_SOA_HASH_IMPL(name, key_t, value_t)                                                 \
+    SH_GEN_SOA_IMPL(name, key_t, value_t,                                                          \
+        sh_value_hash(&key, sizeof(key)),  /* key_hash_expr(key_t key)                       */    \
+        (a == b),                          /* key_cmp_expr(key_t a, key_t b)                 */    \
+        key,                               /* key_put_expr(key_t key)                        */    \
+        0,                                 /* key_del_expr(key_t key)                        */    \
+        calloc(capacity, slot_size),       /* calloc_expr(size_t capacity, size_t slot_size) */    \
+        free(ptr)                          /* free_expr(void* ptr)                           */    \
+    )
+
+/**
+ * Same as SH_GEN_DICT_IMPL() but for hashmaps declared with SH_GEN_SOA_DECL().
+ */
+#define SH_GEN_SOA_DICT_IMPL(name, key_t, value_t)                                                 \
+    SH_GEN_SOA_FUNCTIONS(name, key_t, value_t,                                                     \
+        sh_bytes_hash(key, strlen(key)),  /* key_hash_expr(key_t key)                       */     \
+        (strcmp(a, b) == 0),              /* key_cmp_expr(key_t a, key_t b)                 */     \
+        sh_strdup(key),                   /* key_put_expr(key_t key)                        */     \
+        (free((void*)key), NULL),         /* key_del_expr(key_t key)                        */     \
+        calloc(capacity, slot_size),      /* calloc_expr(size_t capacity, size_t slot_size) */     \
+        free(ptr),                        /* free_expr(void* ptr)                           */     \
+        SH_GEN_NO_MMAP_FUNCTIONS          /* mmap_gen                                       */     \
+    )
+
+/**
+ * Same as SH_GEN_IMPL() but for hashmaps declared with SH_GEN_SOA_DECL(). Uses linear probing.
+ * calloc_expr is executed three times for each allocation, once for each array (slot_size is the
+ * size of one element of that array). free_expr is executed for each of the three arrays.
+ */
+#define SH_GEN_SOA_IMPL(name, key_t, value_t, key_hash_expr, key_cmp_expr, key_put_expr, key_del_expr, calloc_expr, free_expr)  \
+    SH_GEN_SOA_FUNCTIONS(name, key_t, value_t, key_hash_expr, key_cmp_expr, key_put_expr,          \
+        key_del_expr, calloc_expr, free_expr, SH_GEN_SOA_MMAP_FUNCTIONS)
+
+/**
+ * Internal macro that generates all functions of a hashmap declared with SH_GEN_SOA_DECL(). The
+ * arguments are the same as for SH_GEN_SOA_IMPL(). `mmap_gen` is the same as for
+ * SH_GEN_MAP_FUNCTIONS().
+ */
+#define SH_GEN_SOA_FUNCTIONS(name, key_t, value_t, key_hash_expr, key_cmp_expr, key_put_expr, key_del_expr, calloc_expr, free_expr, mmap_gen)  \
+    /* Some forward declarations for internal functions.                                        */ \
+    bool     name##_resize(struct name* hashmap, sh_size_t new_capacity);                          \
+    value_t* name##_put_hashed(struct name* hashmap, key_t key, sh_hash_t hash, bool* inserted);   \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Prefetches the hash and key of the home slot of `hash` so a following lookup doesn't     */ \
+    /* have to wait for memory.                                                                 */ \
+    void name##_prefetch(struct name* hashmap, sh_hash_t hash) {                                   \
+        sh_size_t index = hash & (hashmap->capacity - 1);                                          \
+        SH_PREFETCH(&hashmap->hashes[index]);                                                      \
+        SH_PREFETCH(&hashmap->keys[index]);                                                        \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Returns the index of the slot that contains the specified key or `hashmap->capacity` if  */ \
+    /* the key is not in the hashmap. Only the hashes and keys arrays are looked at.            */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    sh_size_t name##_find_index(struct name* hashmap, key_t key, sh_hash_t hash) {                 \
+        /* No slots at all, e.g. after a failed allocation in name##_new_with_capacity()        */ \
+        if (hashmap->capacity == 0)                                                                \
+            return 0;                                                                              \
+        sh_size_t index = hash & (hashmap->capacity - 1);                                          \
+        while ( !(hashmap->hashes[index] == SH_SLOT_FREE) ) {                                      \
+            if (hashmap->hashes[index] == hash) {                                                  \
+                key_t a = hashmap->keys[index];                                                    \
+                key_t b = key;                                                                     \
+                if (key_cmp_expr)                                                                  \
+                    return index;                                                                  \
+            }                                                                                      \
+                                                                                                   \
+            index = (index + 1) & (hashmap->capacity - 1);                                         \
+        }                                                                                          \
+                                                                                                   \
+        return hashmap->capacity;                                                                  \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Reserves a slot for a key that is known to not be in the hashmap (e.g. when resizing)    */ \
+    /* and returns its index. It DOESN'T check if the hashmap has a free slot.                  */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    sh_size_t name##_insert_index(struct name* hashmap, key_t key, sh_hash_t hash) {               \
+        sh_size_t index = hash & (hashmap->capacity - 1);                                          \
+        while ( !(                                                                                 \
+            hashmap->hashes[index] == SH_SLOT_FREE ||                                              \
+            hashmap->hashes[index] == SH_SLOT_DELETED                                              \
+        ) ) {                                                                                      \
+            index = (index + 1) & (hashmap->capacity - 1);                                         \
+        }                                                                                          \
+                                                                                                   \
+        if (hashmap->hashes[index] == SH_SLOT_DELETED)                                             \
+            hashmap->deleted--;                                                                    \
+        hashmap->length++;                                                                         \
+        hashmap->hashes[index] = hash;                                                             \
+        hashmap->keys[index] = key;                                                                \
+        return index;                                                                              \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Initializes a new empty hashmap. A small capacity is allocated so the hashmap doesn't    */ \
+    /* need to be resized as soon as the first item is inserted.                                */ \
+    void name##_new(struct name* hashmap) {                                                        \
+        name##_new_with_capacity(hashmap, 0);                                                      \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Initializes a new empty hashmap with enough capacity for `length` items. See             */ \
+    /* name##_new_with_capacity() of SH_GEN_MAP_FUNCTIONS().                                    */ \
+    bool name##_new_with_capacity(struct name* hashmap, size_t length) {                           \
+        hashmap->length = 0;                                                                       \
+        hashmap->capacity = 0;                                                                     \
+        hashmap->deleted = 0;                                                                      \
+        hashmap->hashes = NULL;                                                                    \
+        hashmap->keys = NULL;                                                                      \
+        hashmap->values = NULL;                                                                    \
+        hashmap->max_load = SH_MAX_LOAD;                                                           \
+        hashmap->min_load = SH_MIN_LOAD;                                                           \
+        hashmap->growth_factor = SH_GROWTH_FACTOR;                                                 \
+        sh_size_t capacity = sh_capacity_for(length, hashmap->max_load);                           \
+        return capacity != 0 && name##_resize(hashmap, capacity);                                  \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Grows the hashmap so it can hold `length` items without resizing. See name##_reserve()   */ \
+    /* of SH_GEN_MAP_FUNCTIONS().                                                               */ \
+    bool name##_reserve(struct name* hashmap, size_t length) {                                     \
+        if ( !sh_needs_to_grow(length + hashmap->deleted, hashmap->capacity, hashmap->max_load) )  \
+            return true;                                                                           \
+        sh_size_t new_capacity = sh_capacity_for(length, hashmap->max_load);                       \
+        if (new_capacity == 0)                                                                     \
+            return false;                                                                          \
+        if (new_capacity < hashmap->capacity)                                                      \
+            new_capacity = hashmap->capacity;                                                      \
+        return name##_resize(hashmap, new_capacity);                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Changes when the hashmap is resized. See name##_set_load_factors() of                    */ \
+    /* SH_GEN_MAP_FUNCTIONS().                                                                  */ \
+    bool name##_set_load_factors(struct name* hashmap, float max_load, float min_load,             \
+        uint32_t growth_factor) {                                                                  \
+        if ( !sh_valid_load_factors(max_load, min_load, growth_factor) )                           \
+            return false;                                                                          \
+        hashmap->max_load = max_load;                                                              \
+        hashmap->min_load = min_load;                                                              \
+        hashmap->growth_factor = growth_factor;                                                    \
+        return name##_reserve(hashmap, hashmap->length);                                           \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Initializes a new hashmap with the `count` key-value pairs from the `keys` and `values`  */ \
+    /* arrays. See name##_build_from_arrays() of SH_GEN_MAP_FUNCTIONS().                        */ \
+    bool name##_build_from_arrays(struct name* hashmap, key_t* keys, value_t* values,              \
+        size_t count) {                                                                            \
+        if ( name##_new_with_capacity(hashmap, count) == false )                                   \
+            return false;                                                                          \
+        return name##_put_many(hashmap, keys, values, count);                                      \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Looks up `count` keys at once. See name##_get_many() of SH_GEN_MAP_FUNCTIONS(). The      */ \
+    /* hashes and keys of a whole block are prefetched before the first key is looked up.       */ \
+    size_t name##_get_many(struct name* hashmap, key_t* keys, size_t count, value_t** values) {    \
+        /* Without slots there is nothing to prefetch or find.                                  */ \
+        if (hashmap->capacity == 0) {                                                              \
+            for(size_t i = 0; i < count; i++)                                                      \
+                values[i] = NULL;                                                                  \
+            return 0;                                                                              \
+        }                                                                                          \
+                                                                                                   \
+        sh_hash_t hashes[SH_BATCH_SIZE];                                                           \
+        size_t found = 0;                                                                          \
+        for(size_t start = 0; start < count; start += SH_BATCH_SIZE) {                             \
+            size_t block_size = (count - start < SH_BATCH_SIZE) ? count - start : SH_BATCH_SIZE;   \
+            for(size_t i = 0; i < block_size; i++) {                                               \
+                key_t key = keys[start + i];                                                       \
+                key = key;  /* avoid unused variable warning if key_hash_expr doesn't use key   */ \
+                hashes[i] = (key_hash_expr) | SH_SLOT_FILLED;                                      \
+                name##_prefetch(hashmap, hashes[i]);                                               \
+            }                                                                                      \
+                                                                                                   \
+            for(size_t i = 0; i < block_size; i++) {                                               \
+                sh_size_t index = name##_find_index(hashmap, keys[start + i], hashes[i]);          \
+                values[start + i] = (index < hashmap->capacity) ? &hashmap->values[index] : NULL;  \
+                if (index < hashmap->capacity)                                                     \
+                    found++;                                                                       \
+            }                                                                                      \
+        }                                                                                          \
+                                                                                                   \
+        return found;                                                                              \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Inserts `count` key-value pairs at once. See name##_put_many() of                        */ \
+    /* SH_GEN_MAP_FUNCTIONS(). The hashmap is grown only once for the whole batch.              */ \
+    bool name##_put_many(struct name* hashmap, key_t* keys, value_t* values, size_t count) {       \
+        if ( name##_reserve(hashmap, hashmap->length + count) == false )                           \
+            return false;                                                                          \
+                                                                                                   \
+        sh_hash_t hashes[SH_BATCH_SIZE];                                                           \
+        for(size_t start = 0; start < count; start += SH_BATCH_SIZE) {                             \
+            size_t block_size = (count - start < SH_BATCH_SIZE) ? count - start : SH_BATCH_SIZE;   \
+            for(size_t i = 0; i < block_size; i++) {                                               \
+                key_t key = keys[start + i];                                                       \
+                key = key;  /* avoid unused variable warning if key_hash_expr doesn't use key   */ \
+                hashes[i] = (key_hash_expr) | SH_SLOT_FILLED;                                      \
+                name##_prefetch(hashmap, hashes[i]);                                               \
+            }                                                                                      \
+                                                                                                   \
+            /* Can't fail, the hashmap already has enough capacity for all keys.                */ \
+            for(size_t i = 0; i < block_size; i++) {                                               \
+                bool inserted = false;                                                             \
+                *name##_put_hashed(hashmap, keys[start + i], hashes[i], &inserted) =               \
+                    values[start + i];                                                             \
+            }                                                                                      \
+        }                                                                                          \
+                                                                                                   \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Inserts or combines one item of another hashmap, see name##_merge_item() of              */ \
+    /* SH_GEN_MAP_FUNCTIONS().                                                                  */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    bool name##_merge_item(struct name* dst, key_t key, sh_hash_t hash, value_t value,             \
+        void (*combine)(value_t* dst_value, value_t src_value, void* data), void* data) {          \
+        bool inserted = false;                                                                     \
+        value_t* value_ptr = name##_put_hashed(dst, key, hash, &inserted);                         \
+        if (value_ptr == NULL)                                                                     \
+            return false;                                                                          \
+        if (inserted || combine == NULL)                                                           \
+            *value_ptr = value;                                                                    \
+        else                                                                                       \
+            combine(value_ptr, value, data);                                                       \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Merges all items of `src` into `dst`. See name##_merge() of SH_GEN_MAP_FUNCTIONS().      */ \
+    bool name##_merge(struct name* dst, struct name* src,                                          \
+        void (*combine)(value_t* dst_value, value_t src_value, void* data), void* data) {          \
+        for(sh_size_t i = name##_start(src); i < src->capacity; i = name##_next(src, i)) {         \
+            if ( !name##_merge_item(dst, src->keys[i], src->hashes[i], src->values[i], combine,    \
+                data) )                                                                            \
+                return false;                                                                      \
+        }                                                                                          \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Counts the items per hash range, see name##_count_partitions() of                        */ \
+    /* SH_GEN_MAP_FUNCTIONS(). Only looks at the hashes array.                                  */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    void name##_count_partitions(struct name* hashmap, uint32_t partition_bits, size_t* counts) {  \
+        sh_size_t i = name##_start(hashmap);                                                       \
+        for(; i < hashmap->capacity; i = name##_next(hashmap, i))                                  \
+            counts[sh_partition(hashmap->hashes[i], partition_bits)]++;                            \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Writes the index of each item into `positions`, grouped by hash range. See               */ \
+    /* name##_scatter_partitions() of SH_GEN_MAP_FUNCTIONS().                                   */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    void name##_scatter_partitions(struct name* hashmap, uint32_t partition_bits,                  \
+        size_t* cursors, sh_size_t* positions) {                                                   \
+        sh_size_t i = name##_start(hashmap);                                                       \
+        for(; i < hashmap->capacity; i = name##_next(hashmap, i))                                  \
+            positions[cursors[sh_partition(hashmap->hashes[i], partition_bits)]++] = i;            \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Merges the `count` items of `src` at the indices in `positions` into `dst`. See          */ \
+    /* name##_merge_positions() of SH_GEN_MAP_FUNCTIONS().                                      */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    bool name##_merge_positions(struct name* dst, struct name* src, sh_size_t* positions,          \
+        size_t count, void (*combine)(value_t* dst_value, value_t src_value, void* data),          \
+        void* data) {                                                                              \
+        for(size_t i = 0; i < count; i++) {                                                        \
+            sh_size_t index = positions[i];                                                        \
+            if ( !name##_merge_item(dst, src->keys[index], src->hashes[index], src->values[index], \
+                combine, data) )                                                                   \
+                return false;                                                                      \
+        }                                                                                          \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Destroys the hashmap. Cleans up all the keys be executing the key_del_expr for each one  */ \
+    /* and frees all associated memory.                                                         */ \
+    void name##_destroy(struct name* hashmap) {                                                    \
+        sh_size_t i = name##_start(hashmap);                                                       \
+        for(; i < hashmap->capacity; i = name##_next(hashmap, i)) {                                \
+            key_t key = hashmap->keys[i];                                                          \
+            key = key;  /* avoid unused variable warning                                        */ \
+            hashmap->keys[i] = (key_del_expr);                                                     \
+            hashmap->hashes[i] = SH_SLOT_DELETED;                                                  \
+        }                                                                                          \
+                                                                                                   \
+        hashmap->length = 0;                                                                       \
+        hashmap->capacity = 0;                                                                     \
+        hashmap->deleted = 0;                                                                      \
+                                                                                                   \
+        /* ptr is used as an argument to the  free_expr which should free the  memory of ptr    */ \
+        /* like free() does.                                                                    */ \
+        void* ptr = hashmap->hashes;                                                               \
+        free_expr;                                                                                 \
+        ptr = hashmap->keys;                                                                       \
+        free_expr;                                                                                 \
+        ptr = hashmap->values;                                                                     \
+        free_expr;                                                                                 \
+                                                                                                   \
+        hashmap->hashes = NULL;                                                                    \
+        hashmap->keys = NULL;                                                                      \
+        hashmap->values = NULL;                                                                    \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Resizes the hashmap to the specified new capacity. All existing itmes are moved into the */ \
+    /* new hashmap using the stored hashes (key_hash_expr isn't executed again). The new        */ \
+    /* capacity has to be a power of two.                                                       */ \
+    /*                                                                                          */ \
+    /* Returns `true` if the resizing was successfull, `false` if the memory allocation for the */ \
+    /* new capacity failed. In that case the hashmap remains unchanged and can still be used.   */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    bool name##_resize(struct name* hashmap, sh_size_t new_capacity) {                             \
+        /* Can't make hashmap smaller than it needs to be.                                      */ \
+        if (new_capacity < hashmap->length)                                                        \
+            return false;                                                                          \
+        clock_t start_time = SH_RESIZE_CLOCK();                                                    \
+        start_time = start_time;  /* avoid unused variable warning if the hook ignores seconds  */ \
+                                                                                                   \
+        struct name new_hashmap;                                                                   \
+        new_hashmap.length = 0;                                                                    \
+        new_hashmap.capacity = new_capacity;                                                       \
+        new_hashmap.deleted = 0;                                                                   \
+        new_hashmap.max_load = hashmap->max_load;                                                  \
+        new_hashmap.min_load = hashmap->min_load;                                                  \
+        new_hashmap.growth_factor = hashmap->growth_factor;                                        \
+                                                                                                   \
+        /* capacity and slot_size variables are used to pass arguments to calloc_expr which in  */ \
+        /* turn should allocate memory like calloc() does. One allocation for each array.       */ \
+        size_t capacity = new_capacity;                                                            \
+        size_t slot_size = sizeof(new_hashmap.hashes[0]);                                          \
+        new_hashmap.hashes = calloc_expr;                                                          \
+        slot_size = sizeof(new_hashmap.keys[0]);                                                   \
+        new_hashmap.keys = calloc_expr;                                                            \
+        slot_size = sizeof(new_hashmap.values[0]);                                                 \
+        new_hashmap.values = calloc_expr;                                                          \
+                                                                                                   \
+        /* Failed to allocate memory for new hashmap, free what we got and leave the original   */ \
+        /* untouched.                                                                           */ \
+        if (!new_hashmap.hashes || !new_hashmap.keys || !new_hashmap.values) {                     \
+            void* ptr = NULL;                                                                      \
+            if ( (ptr = new_hashmap.hashes) != NULL )                                              \
+                free_expr;                                                                         \
+            if ( (ptr = new_hashmap.keys) != NULL )                                                \
+                free_expr;                                                                         \
+            if ( (ptr = new_hashmap.values) != NULL )                                              \
+                free_expr;                                                                         \
+            return false;                                                                          \
+        }                                                                                          \
+                                                                                                   \
+        sh_size_t i = name##_start(hashmap);                                                       \
+        for(; i < hashmap->capacity; i = name##_next(hashmap, i)) {                                \
+            key_t key = hashmap->keys[i];                                                          \
+            sh_size_t index = name##_insert_index(&new_hashmap, key, hashmap->hashes[i]);          \
+            new_hashmap.values[index] = hashmap->values[i];                                        \
+        }                                                                                          \
+                                                                                                   \
+        /* ptr is used as an argument to the free_expr which should free the memory of ptr like */ \
+        /* free() does.                                                                         */ \
+        void* ptr = hashmap->hashes;                                                               \
+        free_expr;                                                                                 \
+        ptr = hashmap->keys;                                                                       \
+        free_expr;                                                                                 \
+        ptr = hashmap->values;                                                                     \
+        free_expr;                                                                                 \
+        SH_RESIZE_STATS(#name, hashmap->capacity, new_capacity, new_hashmap.length,                \
+            (double)(SH_RESIZE_CLOCK() - start_time) / CLOCKS_PER_SEC);                            \
+        *hashmap = new_hashmap;                                                                    \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Inserts a new key-value pair into the hashmap, growing the hashmap if necessary. Returns */ \
+    /* a pointer to the storage for the value. If the key is already in the hashmap the pointer */ \
+    /* to its value is returned. See name##_put_ptr() of SH_GEN_IMPL() for details.             */ \
+    value_t* name##_put_ptr(struct name* hashmap, key_t key) {                                     \
+        bool inserted = false;                                                                     \
+        return name##_put_hashed(hashmap, key, (key_hash_expr) | SH_SLOT_FILLED, &inserted);       \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Looks up the key and inserts it if it isn't in the hashmap yet, both with one probe. See */ \
+    /* name##_upsert() of SH_GEN_MAP_FUNCTIONS() for details.                                   */ \
+    value_t* name##_upsert(struct name* hashmap, key_t key, bool* inserted) {                      \
+        value_t* value_ptr = name##_put_hashed(hashmap, key, (key_hash_expr) | SH_SLOT_FILLED,     \
+            inserted);                                                                             \
+        if (value_ptr && *inserted)                                                                \
+            memset(value_ptr, 0, sizeof(*value_ptr));                                              \
+        return value_ptr;                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Same as name##_put_ptr() but with the hash of the key already calculated (including      */ \
+    /* SH_SLOT_FILLED). Sets `*inserted` to `true` if the key wasn't in the hashmap before. The */ \
+    /* key_put_expr is only executed in that case.                                              */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    value_t* name##_put_hashed(struct name* hashmap, key_t key, sh_hash_t hash, bool* inserted) {  \
+        *inserted = false;                                                                         \
+        sh_size_t used = hashmap->length + hashmap->deleted + 1;                                   \
+        if ( sh_needs_to_grow(used, hashmap->capacity, hashmap->max_load) ) {                      \
+            sh_size_t new_capacity = sh_grown_capacity(hashmap->capacity, hashmap->length,         \
+                hashmap->deleted, hashmap->max_load, hashmap->growth_factor);                      \
+            if ( name##_resize(hashmap, new_capacity) == false )                                   \
+                return NULL;                                                                       \
+        }                                                                                          \
+                                                                                                   \
+        /* Look for the key until the next free slot but remember the first deleted slot on the */ \
+        /* way. The new key goes there if it isn't already in the hashmap.                      */ \
+        sh_size_t index = hash & (hashmap->capacity - 1);                                          \
+        sh_size_t deleted_index = SH_SIZE_MAX;                                                     \
+        while ( !(hashmap->hashes[index] == SH_SLOT_FREE) ) {                                      \
+            if (hashmap->hashes[index] == hash) {                                                  \
+                key_t a = hashmap->keys[index];                                                    \
+                key_t b = key;                                                                     \
+                if (key_cmp_expr)                                                                  \
+                    return &hashmap->values[index];                                                \
+            } else if (hashmap->hashes[index] == SH_SLOT_DELETED                                   \
+                && deleted_index == SH_SIZE_MAX) {                                                 \
+                deleted_index = index;                                                             \
+            }                                                                                      \
+                                                                                                   \
+            index = (index + 1) & (hashmap->capacity - 1);                                         \
+        }                                                                                          \
+                                                                                                   \
+        if (deleted_index != SH_SIZE_MAX) {                                                        \
+            index = deleted_index;                                                                 \
+            hashmap->deleted--;                                                                    \
+        }                                                                                          \
+        hashmap->length++;                                                                         \
+        hashmap->hashes[index] = hash;                                                             \
+        hashmap->keys[index] = (key_put_expr);                                                     \
+        *inserted = true;                                                                          \
+        return &hashmap->values[index];                                                            \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Looks up the specified key in the hashmap and returns a pointer to the value stored for  */ \
+    /* that key. Returns `NULL` if the key could not be found.                                  */ \
+    value_t* name##_get_ptr(struct name* hashmap, key_t key) {                                     \
+        sh_hash_t hash = (key_hash_expr) | SH_SLOT_FILLED;                                         \
+        sh_size_t index = name##_find_index(hashmap, key, hash);                                   \
+        return (index < hashmap->capacity) ? &hashmap->values[index] : NULL;                       \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Deletes the key-value pair for the specified key from the hashmap. The hashmap is shrunk */ \
+    /* if it is to sparse. Returns `true` if the key-value pair was deleted, `false` if the key */ \
+    /* wasn't found in the hashmap.                                                             */ \
+    bool name##_del(struct name* hashmap, key_t key) {                                             \
+        sh_hash_t hash = (key_hash_expr) | SH_SLOT_FILLED;                                         \
+        sh_size_t index = name##_find_index(hashmap, key, hash);                                   \
+        if (index == hashmap->capacity)                                                            \
+            return false;                                                                          \
+                                                                                                   \
+        name##_remove(hashmap, index);                                                             \
+        name##_shrink_if_necessary(hashmap);                                                       \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Inserts a value at the specified key into the hashmap. An existing value for the same    */ \
+    /* key is overwritten. The hashmap is grown if necessary.                                   */ \
+    void name##_put(struct name* hashmap, key_t key, value_t value) {                              \
+        *name##_put_ptr(hashmap, key) = value;                                                     \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Fetches the value for the specified key from the hashmap. In case the key isn't found    */ \
+    /* the `default_value` is returned.                                                         */ \
+    value_t name##_get(struct name* hashmap, key_t key, value_t default_value) {                   \
+        value_t* value_ptr = name##_get_ptr(hashmap, key);                                         \
+        return (value_ptr) ? *value_ptr : default_value;                                           \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Checks if the specified key exists in the hashmap. Doesn't touch the values array.       */ \
+    bool name##_contains(struct name* hashmap, key_t key) {                                        \
+        sh_hash_t hash = (key_hash_expr) | SH_SLOT_FILLED;                                         \
+        return (name##_find_index(hashmap, key, hash) < hashmap->capacity);                        \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Returns the index of the first item in the hashmap. Returns `hashmap->capacity` if the   */ \
+    /* hashmap is empty. See SH_GEN_SOA_DECL() for how to iterate over the hashmap.             */ \
+    sh_size_t name##_start(struct name* hashmap) {                                                 \
+        /* SH_SIZE_MAX + 1 wraps around to the first slot                                       */ \
+        return name##_next(hashmap, SH_SIZE_MAX);                                                  \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Returns the index of the next item after `index` or `hashmap->capacity` if there is no   */ \
+    /* next item.                                                                               */ \
+    sh_size_t name##_next(struct name* hashmap, sh_size_t index) {                                 \
+        do {                                                                                       \
+            index++;                                                                               \
+        } while (                                                                                  \
+            index < hashmap->capacity &&                                                           \
+            (hashmap->hashes[index] == SH_SLOT_FREE || hashmap->hashes[index] == SH_SLOT_DELETED)  \
+        );                                                                                         \
+                                                                                                   \
+        return (index < hashmap->capacity) ? index : hashmap->capacity;                            \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Removes the item at the specified index from the hashmap. Meant to be used while         */ \
+    /* iterating over the hashmap. The hashmap is not resized, even if all items are removed.   */ \
+    void name##_remove(struct name* hashmap, sh_size_t index) {                                    \
+        if (index < hashmap->capacity && (hashmap->hashes[index] & SH_SLOT_FILLED)) {              \
+            key_t key = hashmap->keys[index];                                                      \
+            key = key;  /* avoid unused variable warning                                        */ \
+            hashmap->keys[index] = (key_del_expr);                                                 \
+            hashmap->hashes[index] = SH_SLOT_DELETED;                                              \
+            hashmap->length--;                                                                     \
+            hashmap->deleted++;                                                                    \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Shrinks the hashmap down if it became to sparse. Returns `true` if it was shrunk,        */ \
+    /* `false` if not.                                                                          */ \
+    bool name##_shrink_if_necessary(struct name* hashmap) {                                        \
+        sh_size_t new_capacity = sh_shrunk_capacity(hashmap->length, hashmap->capacity,            \
+            hashmap->min_load, hashmap->max_load);                                                 \
+                                                                                                   \
+        if (new_capacity < hashmap->capacity) {                                                    \
+            name##_resize(hashmap, new_capacity);                                                  \
+            return true;                                                                           \
+        }                                                                                          \
+                                                                                                   \
+        return false;                                                                              \
+    }                                                                                              \
+                                                                                                   \
+    mmap_gen(name, key_t, value_t, key_hash_expr)                                                  \
+
+/**
+ * Declares a hash set: Like SH_GEN_DECL() but the slots only contain the hash and the key, no
+ * value. A set of int64_t keys takes 16 bytes per slot instead of the 24 bytes of an int64_t ->
+ * char hashmap (the char value is padded to 8 bytes), so probing touches fewer cache lines. Use
+ * SH_GEN_SET_HASH_IMPL(), SH_GEN_SET_DICT_IMPL() or SH_GEN_SET_IMPL() with the same first two
+ * arguments to generate the implementation.
+ * 
+ *     SH_GEN_SET_DECL(seen, int64_t);
+ *     SH_GEN_SET_HASH_IMPL(seen, int64_t);
+ *     
+ *     seen_t seen;
+ *     seen_new(&seen);
+ *     if ( seen_insert(&seen, id) )
+ *         printf("first time we saw %ld\n", id);
+ *     seen_destroy(&seen);
+ * 
+ * Sets use linear probing and have most of the hashmap functions minus the value ones:
+ * 
+ *     bool seen_insert(struct seen* set, int64_t key);  // true if the key was new
+ *     bool seen_del(struct seen* set, int64_t key);
+ *     bool seen_contains(struct seen* set, int64_t key);
+ *     bool seen_union(struct seen* dst, struct seen* src);
+ *     void seen_intersect(struct seen* dst, struct seen* src);
+ * 
+ * ..._new(), ..._new_with_capacity(), ..._destroy(), ..._reserve(), ..._set_load_factors() and
+ * iteration with ..._start(), ..._next() and ..._remove() work the same as with hashmaps.
+ * 
+ * If SLIM_HASH_NO_TYPEDEFS is defined no typedefs for shorthand types ending with ..._t and ..._p
+ * are defined.
+ */
+#ifdef SLIM_HASH_NO_TYPEDEFS
+    #define SH_GEN_SET_DECL(name, key_t)  SH_GEN_SET_TYPES_AND_PROTOTYPES(name, key_t)
+#else
+    #define SH_GEN_SET_DECL(name, key_t)  SH_GEN_SET_TYPES_AND_PROTOTYPES(name, key_t)             \
+        typedef struct name name##_t, *name##_p;                                                   \
+        typedef struct name##_slot *name##_it_p;
+#endif
+
+#define SH_GEN_SET_TYPES_AND_PROTOTYPES(name, key_t)                                               \
+    struct name##_slot {                                                                           \
+        sh_hash_t hash_or_flags;                                                                   \
+        key_t key;                                                                                 \
+    };                                                                                             \
+                                                                                                   \
+    struct name {                                                                                  \
+        sh_size_t length, capacity, deleted;                                                       \
+        struct name##_slot* slots;                                                                 \
+        /* When to grow and shrink, see name##_set_load_factors() of SH_GEN_MAP_FUNCTIONS()     */ \
+        float max_load, min_load;                                                                  \
+        uint32_t growth_factor;                                                                    \
+    };                                                                                             \
+                                                                                                   \
+    void     name##_new(struct name* set);                                                         \
+    bool     name##_new_with_capacity(struct name* set, size_t length);                            \
+    void     name##_destroy(struct name* set);                                                     \
+    bool     name##_reserve(struct name* set, size_t length);                                      \
+    bool     name##_set_load_factors(struct name* set, float max_load, float min_load,             \
+                 uint32_t growth_factor);                                                          \
+                                                                                                   \
+    bool     name##_insert(struct name* set, key_t key);                                           \
+    bool     name##_del(struct name* set, key_t key);                                              \
+    bool     name##_contains(struct name* set, key_t key);                                         \
+                                                                                                   \
+    bool     name##_union(struct name* dst, struct name* src);                                     \
+    void     name##_intersect(struct name* dst, struct name* src);                                 \
+                                                                                                   \
+    struct name##_slot*  name##_start(struct name* set);                                           \
+    struct name##_slot*  name##_next(struct name* set, struct name##_slot* it);                    \
+    void                 name##_remove(struct name* set, struct name##_slot* it);                  \
+    bool                 name##_shrink_if_necessary(struct name* set);                             \
+
+
+/**
+ * Same as SH_GEN_HASH_IMPL() but for sets declared with SH_GEN_SET_DECL().
+ */
+#define SH_GEN_SET_HASH_IMPL(name, key_t)                                                          \
+    SH_GEN_SET_IMPL(name, key_t,                                                                   \
+        sh_value_hash(&key, sizeof(key)),  /* key_hash_expr(key_t key)                       */    \
+        (a == b),                          /* key_cmp_expr(key_t a, key_t b)                 */    \
+        key,                               /* key_put_expr(key_t key)                        */    \
+        0,                                 /* key_del_expr(key_t key)                        */    \
+        calloc(capacity, slot_size),       /* calloc_expr(size_t capacity, size_t slot_size) */    \
+        free(ptr)                          /* free_expr(void* ptr)                           */    \
+    )
+
+/**
+ * Same as SH_GEN_DICT_IMPL() but for sets declared with SH_GEN_SET_DECL(). The string keys are
+ * duplicated when they are inserted and freed when they are deleted.
+ */
+#define SH_GEN_SET_DICT_IMPL(name, key_t)                                                          \
+    SH_GEN_SET_IMPL(name, key_t,                                                                   \
+        sh_bytes_hash(key, strlen(key)),  /* key_hash_expr(key_t key)                       */     \
+        (strcmp(a, b) == 0),              /* key_cmp_expr(key_t a, key_t b)                 */     \
+        sh_strdup(key),                   /* key_put_expr(key_t key)                        */     \
+        (free((void*)key), NULL),         /* key_del_expr(key_t key)                        */     \
+        calloc(capacity, slot_size),      /* calloc_expr(size_t capacity, size_t slot_size) */     \
+        free(ptr)                         /* free_expr(void* ptr)                           */     \
+    )
+
+/**
+ * Same as SH_GEN_IMPL() but for sets declared with SH_GEN_SET_DECL(). The expressions are the same
+ * as for SH_GEN_IMPL(). Uses the probing functions of SH_GEN_LINEAR_PROBING() since they never
+ * touch the value of a slot.
+ */
+#define SH_GEN_SET_IMPL(name, key_t, key_hash_expr, key_cmp_expr, key_put_expr, key_del_expr, calloc_expr, free_expr)  \
+    SH_GEN_LINEAR_PROBING(name, key_t, key_t, key_cmp_expr)                                        \
+                                                                                                   \
+    /* Some forward declarations for internal functions.                                        */ \
+    bool     name##_resize(struct name* set, sh_size_t new_capacity);                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Initializes a new empty set. Same as name##_new() of SH_GEN_MAP_FUNCTIONS().             */ \
+    void name##_new(struct name* set) {                                                            \
+        name##_new_with_capacity(set, 0);                                                          \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Initializes a new empty set with enough capacity for `length` keys. Returns `false` if   */ \
+    /* the memory allocation failed. The set is empty but still usable in that case.            */ \
+    bool name##_new_with_capacity(struct name* set, size_t length) {                               \
+        set->length = 0;                                                                           \
+        set->capacity = 0;                                                                         \
+        set->deleted = 0;                                                                          \
+        set->slots = NULL;                                                                         \
+        set->max_load = SH_MAX_LOAD;                                                               \
+        set->min_load = SH_MIN_LOAD;                                                               \
+        set->growth_factor = SH_GROWTH_FACTOR;                                                     \
+        sh_size_t capacity = sh_capacity_for(length, set->max_load);                               \
+        return capacity != 0 && name##_resize(set, capacity);                                      \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Grows the set so it can hold `length` keys (in total) without resizing. Returns `false`  */ \
+    /* if the memory allocation failed, the set remains unchanged in that case.                 */ \
+    bool name##_reserve(struct name* set, size_t length) {                                         \
+        if ( !sh_needs_to_grow(length + set->deleted, set->capacity, set->max_load) )              \
+            return true;                                                                           \
+        sh_size_t new_capacity = sh_capacity_for(length, set->max_load);                           \
+        if (new_capacity == 0)                                                                     \
+            return false;                                                                          \
+        if (new_capacity < set->capacity)                                                          \
+            new_capacity = set->capacity;                                                          \
+        return name##_resize(set, new_capacity);                                                   \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Changes when the set grows and shrinks. Same as name##_set_load_factors() of             */ \
+    /* SH_GEN_MAP_FUNCTIONS().                                                                  */ \
+    bool name##_set_load_factors(struct name* set, float max_load, float min_load,                 \
+        uint32_t growth_factor) {                                                                  \
+        if ( !sh_valid_load_factors(max_load, min_load, growth_factor) )                           \
+            return false;                                                                          \
+        set->max_load = max_load;                                                                  \
+        set->min_load = min_load;                                                                  \
+        set->growth_factor = growth_factor;                                                        \
+        return name##_reserve(set, set->length);                                                   \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Destroys the set. Executes the key_del_expr for each key and frees all associated        */ \
+    /* memory.                                                                                  */ \
+    void name##_destroy(struct name* set) {                                                        \
+        for(struct name##_slot* it = name##_start(set); it; it = name##_next(set, it)) {           \
+            key_t key = it->key;                                                                   \
+            key = key;  /* avoid unused variable warning                                        */ \
+            it->key = (key_del_expr);                                                              \
+            it->hash_or_flags = SH_SLOT_DELETED;                                                   \
+        }                                                                                          \
+                                                                                                   \
+        set->length = 0;                                                                           \
+        set->capacity = 0;                                                                         \
+        set->deleted = 0;                                                                          \
+                                                                                                   \
+        void* ptr = set->slots;                                                                    \
+        ptr = ptr;  /* avoid unused variable warning if free_expr doesn't use ptr               */ \
+        free_expr;                                                                                 \
+        set->slots = NULL;                                                                         \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Moves all keys into new slots with the specified capacity (a power of two). Reuses the   */ \
+    /* stored hashes like name##_resize() of SH_GEN_MAP_FUNCTIONS(). Returns `false` if the     */ \
+    /* memory allocation failed, the set remains unchanged in that case.                        */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    bool name##_resize(struct name* set, sh_size_t new_capacity) {                                 \
+        if (new_capacity < set->length)                                                            \
+            return false;                                                                          \
+        clock_t start_time = SH_RESIZE_CLOCK();                                                    \
+        start_time = start_time;  /* avoid unused variable warning if the hook ignores seconds  */ \
+                                                                                                   \
+        struct name new_set = *set;                                                                \
+        new_set.length = 0;                                                                        \
+        new_set.capacity = new_capacity;                                                           \
+        new_set.deleted = 0;                                                                       \
+                                                                                                   \
+        size_t capacity = name##_allocation_size(new_capacity);                                    \
+        size_t slot_size = sizeof(new_set.slots[0]);                                               \
+        new_set.slots = calloc_expr;                                                               \
+        if (new_set.slots == NULL)                                                                 \
+            return false;                                                                          \
+                                                                                                   \
+        for(struct name##_slot* it = name##_start(set); it; it = name##_next(set, it))             \
+            name##_insert_slot(&new_set, it->key, it->hash_or_flags);                              \
+                                                                                                   \
+        void* ptr = set->slots;                                                                    \
+        ptr = ptr;  /* avoid unused variable warning if free_expr doesn't use ptr               */ \
+        free_expr;                                                                                 \
+        SH_RESIZE_STATS(#name, set->capacity, new_capacity, new_set.length,                        \
+            (double)(SH_RESIZE_CLOCK() - start_time) / CLOCKS_PER_SEC);                            \
+        *set = new_set;                                                                            \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Inserts a key with an already calculated hash (including SH_SLOT_FILLED), growing the    */ \
+    /* set if necessary. Returns its slot or `NULL` if the set needed to grow but failed to     */ \
+    /* allocate more memory for that. Sets `*inserted` to `true` if the key wasn't in the set   */ \
+    /* before. The key_put_expr is only executed in that case.                                  */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    struct name##_slot* name##_put_hashed(struct name* set, key_t key, sh_hash_t hash,             \
+        bool* inserted) {                                                                          \
+        *inserted = false;                                                                         \
+        sh_size_t used = set->length + set->deleted + 1;                                           \
+        if ( sh_needs_to_grow(used, set->capacity, set->max_load) ) {                              \
+            sh_size_t new_capacity = sh_grown_capacity(set->capacity, set->length, set->deleted,   \
+                set->max_load, set->growth_factor);                                                \
+            if ( name##_resize(set, new_capacity) == false )                                       \
+                return NULL;                                                                       \
+        }                                                                                          \
+                                                                                                   \
+        struct name##_slot* slot = name##_put_slot(set, key, hash, inserted);                      \
+        if (*inserted)                                                                             \
+            slot->key = (key_put_expr);                                                            \
+        return slot;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Inserts a key into the set, growing it if necessary. Returns `true` if the key was       */ \
+    /* inserted and `false` if it already was in the set. Also returns `false` if the set       */ \
+    /* needed to grow but failed to allocate more memory for that. Use name##_reserve()         */ \
+    /* beforehand if you need to tell those cases apart.                                        */ \
+    /*                                                                                          */ \
+    /* Don't use this function while iterating over the set, it might resize the set.           */ \
+    bool name##_insert(struct name* set, key_t key) {                                              \
+        bool inserted = false;                                                                     \
+        name##_put_hashed(set, key, (key_hash_expr) | SH_SLOT_FILLED, &inserted);                  \
+        return inserted;                                                                           \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Returns `true` if the key is in the set, `false` if not.                                 */ \
+    bool name##_contains(struct name* set, key_t key) {                                            \
+        sh_hash_t hash = (key_hash_expr) | SH_SLOT_FILLED;                                         \
+        return name##_find_slot(set, key, hash) != NULL;                                           \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Deletes the key from the set and shrinks the set if it became to sparse. Returns `true`  */ \
+    /* if the key was deleted, `false` if it wasn't in the set.                                 */ \
+    /*                                                                                          */ \
+    /* Don't use this function while iterating over the set, use name##_remove() instead.       */ \
+    bool name##_del(struct name* set, key_t key) {                                                 \
+        sh_hash_t hash = (key_hash_expr) | SH_SLOT_FILLED;                                         \
+        struct name##_slot* slot = name##_find_slot(set, key, hash);                               \
+        if (slot == NULL)                                                                          \
+            return false;                                                                          \
+                                                                                                   \
+        name##_remove(set, slot);                                                                  \
+        name##_shrink_if_necessary(set);                                                           \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Inserts all keys of `src` into `dst` (the key_put_expr is executed for keys that are new */ \
+    /* to `dst`). `src` isn't changed. The hashes stored in `src` are reused, so key_hash_expr  */ \
+    /* isn't executed.                                                                          */ \
+    /*                                                                                          */ \
+    /* Returns `false` if `dst` needed to grow but failed to allocate more memory for that. In  */ \
+    /* that case only some keys are inserted.                                                   */ \
+    bool name##_union(struct name* dst, struct name* src) {                                        \
+        if ( name##_reserve(dst, dst->length + src->length) == false )                             \
+            return false;                                                                          \
+        for(struct name##_slot* it = name##_start(src); it; it = name##_next(src, it)) {           \
+            bool inserted = false;                                                                 \
+            if ( name##_put_hashed(dst, it->key, it->hash_or_flags, &inserted) == NULL )           \
+                return false;                                                                      \
+        }                                                                                          \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Removes all keys from `dst` that are not in `src` (the key_del_expr is executed for      */ \
+    /* them) and shrinks `dst` if it became to sparse. `src` isn't changed. The hashes stored   */ \
+    /* in `dst` are used to look up the keys in `src`, so key_hash_expr isn't executed.         */ \
+    void name##_intersect(struct name* dst, struct name* src) {                                    \
+        for(struct name##_slot* it = name##_start(dst); it; it = name##_next(dst, it)) {           \
+            if (src->length == 0 || name##_find_slot(src, it->key, it->hash_or_flags) == NULL)     \
+                name##_remove(dst, it);                                                            \
+        }                                                                                          \
+        name##_shrink_if_necessary(dst);                                                           \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Iterates over the keys of the set like name##_start() and name##_next() of               */ \
+    /* SH_GEN_MAP_FUNCTIONS():                                                                  */ \
+    /*                                                                                          */ \
+    /*    for(words_it_p it = words_start(&words); it != NULL; it = words_next(&words, it)) {   */ \
+    /*        it->key;  // access the key                                                       */ \
+    /*        words_remove(&words, it);  // remove the current key                              */ \
+    /*    }                                                                                     */ \
+    struct name##_slot* name##_start(struct name* set) {                                           \
+        return name##_next(set, set->slots - 1);                                                   \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Advances the iterator to the next key or returns `NULL` if there is no next key.         */ \
+    struct name##_slot* name##_next(struct name* set, struct name##_slot* it) {                    \
+        if (it == NULL)                                                                            \
+            return NULL;                                                                           \
+                                                                                                   \
+        do {                                                                                       \
+            it++;                                                                                  \
+            if ((size_t)(it - set->slots) >= set->capacity)                                        \
+                return NULL;                                                                       \
+        } while( it->hash_or_flags == SH_SLOT_FREE || it->hash_or_flags == SH_SLOT_DELETED );      \
+                                                                                                   \
+        return it;                                                                                 \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Removes the key the iterator points to from the set. The set is not resized, call        */ \
+    /* name##_shrink_if_necessary() after the loop if you removed most keys.                    */ \
+    void name##_remove(struct name* set, struct name##_slot* it) {                                 \
+        if (it != NULL && it >= set->slots && (size_t)(it - set->slots) < set->capacity) {         \
+            key_t key = it->key;                                                                   \
+            key = key;  /* avoid unused variable warning                                        */ \
+            it->key = (key_del_expr);                                                              \
+            name##_tombstone_slot(set, it);                                                        \
+        }                                                                                          \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Shrinks the set down if it became to sparse. Returns `true` if it was shrunk, `false` if */ \
+    /* not.                                                                                     */ \
+    bool name##_shrink_if_necessary(struct name* set) {                                            \
+        sh_size_t new_capacity = sh_shrunk_capacity(set->length, set->capacity, set->min_load,     \
+            set->max_load);                                                                        \
+                                                                                                   \
+        if (new_capacity < set->capacity) {                                                        \
+            name##_resize(set, new_capacity);                                                      \
+            return true;                                                                           \
+        }                                                                                          \
+                                                                                                   \
+        return false;                                                                              \
+    }                                                                                              \
+
+/**
+ * Declares a frozen table: A read-only copy of a hashmap that uses a minimal perfect hash function.
+ * Every key has its own item, so a lookup looks at exactly one item and compares one key. There are
+ * no free slots and no stored hashes. A table with n items takes n items plus 1 byte per item (the
+ * pilots), a lot less than a hashmap at a load of 0.5. Use it for tables that are built once and
+ * queried a lot, e.g. keyword tables.
+ * 
+ * `map` has to be declared with SH_GEN_DECL() and implemented with any of the ..._IMPL() macros
+ * except the SoA ones. Generate the implementation with SH_GEN_FROZEN_IMPL(),
+ * SH_GEN_FROZEN_HASH_IMPL() or SH_GEN_FROZEN_DICT_IMPL() using the same arguments.
+ * 
+ *     SH_GEN_DECL(keywords, const char*, int);
+ *     SH_GEN_DICT_IMPL(keywords, const char*, int);
+ *     SH_GEN_FROZEN_DECL(keywords_frozen, keywords, const char*, int);
+ *     SH_GEN_FROZEN_DICT_IMPL(keywords_frozen, keywords, const char*, int);
+ *     
+ *     struct keywords k;
+ *     keywords_new(&k);
+ *     keywords_put(&k, "while", 1);
+ *     keywords_put(&k, "for", 2);
+ *     
+ *     struct keywords_frozen f;
+ *     keywords_frozen_build(&f, &k);
+ *     keywords_destroy(&k);
+ *     int v = keywords_frozen_get(&f, "for", 0);
+ *     keywords_frozen_destroy(&f);
+ * 
+ * The keys are split into buckets of about SH_FROZEN_BUCKET_SIZE keys each (by their hash). For
+ * each bucket the build searches a pilot, a number that moves all keys of the bucket into items no
+ * other key uses (like the CHD and PTHash algorithms). Building takes a bit longer than inserting
+ * the keys into a hashmap. The items can be iterated with an index from 0 to `length`.
+ * 
+ * The resulting functions:
+ * 
+ *     bool     name##_build(struct name* frozen, struct map* hashmap);
+ *     void     name##_destroy(struct name* frozen);
+ *     
+ *     value_t  name##_get(struct name* frozen, key_t key, value_t default_value);
+ *     value_t* name##_get_ptr(struct name* frozen, key_t key);
+ *     bool     name##_contains(struct name* frozen, key_t key);
+ * 
+ * If SLIM_HASH_NO_TYPEDEFS is defined no typedefs for shorthand types ending with ..._t and ..._p
+ * are defined.
+ */
+#ifdef SLIM_HASH_NO_TYPEDEFS
+    #define SH_GEN_FROZEN_DECL(name, map, key_t, value_t)                                          \
+        SH_GEN_FROZEN_TYPES_AND_PROTOTYPES(name, map, key_t, value_t)
+#else
+    #define SH_GEN_FROZEN_DECL(name, map, key_t, value_t)                                          \
+        SH_GEN_FROZEN_TYPES_AND_PROTOTYPES(name, map, key_t, value_t)                              \
+        typedef struct name name##_t, *name##_p;
+#endif
+
+#define SH_GEN_FROZEN_TYPES_AND_PROTOTYPES(name, map, key_t, value_t)                              \
+    struct name##_item {                                                                           \
+        key_t key;                                                                                 \
+        value_t value;                                                                             \
+    };                                                                                             \
+                                                                                                   \
+    struct name {                                                                                  \
+        size_t length, bucket_count;                                                               \
+        uint32_t* pilots;                                                                          \
+        struct name##_item* items;                                                                 \
+    };                                                                                             \
+                                                                                                   \
+    bool     name##_build(struct name* frozen, struct map* hashmap);                               \
+    void     name##_destroy(struct name* frozen);                                                  \
+                                                                                                   \
+    value_t  name##_get(struct name* frozen, key_t key, value_t default_value);                    \
+    value_t* name##_get_ptr(struct name* frozen, key_t key);                                       \
+    bool     name##_contains(struct name* frozen, key_t key);                                      \
+
+/**
+ * Same as SH_GEN_HASH_IMPL() but for frozen tables declared with SH_GEN_FROZEN_DECL(). Keys are
+ * hashed with sh_value_hash64().
+ */
+#define SH_GEN_FROZEN_HASH_IMPL(name, map, key_t, value_t)                                         \
+    SH_GEN_FROZEN_IMPL(name, map, key_t, value_t,                                                  \
+        sh_value_hash64(&key, sizeof(key)),  /* key_hash_expr(key_t key)                        */ \
+        (a == b),                            /* key_cmp_expr(key_t a, key_t b)                  */ \
+        key,                                 /* key_put_expr(key_t key)                         */ \
+        0                                    /* key_del_expr(key_t key)                         */ \
+    )
+
+/**
+ * Same as SH_GEN_DICT_IMPL() but for frozen tables declared with SH_GEN_FROZEN_DECL(). Keys are
+ * hashed with sh_wyhash() and copied with strdup().
+ */
+#define SH_GEN_FROZEN_DICT_IMPL(name, map, key_t, value_t)                                         \
+    SH_GEN_FROZEN_IMPL(name, map, key_t, value_t,                                                  \
+        sh_wyhash(key, strlen(key), 0),      /* key_hash_expr(key_t key)                        */ \
+        (strcmp(a, b) == 0),                 /* key_cmp_expr(key_t a, key_t b)                  */ \
+        sh_strdup(key),                      /* key_put_expr(key_t key)                         */ \
+        (free((void*)key), NULL)             /* key_del_expr(key_t key)                         */ \
+    )
+
+/**
+ * Generates the implementation of a frozen table declared with SH_GEN_FROZEN_DECL(). The
+ * expressions work like the ones of SH_GEN_IMPL(), except that key_hash_expr has to return a 64 bit
+ * hash (uint64_t). With fewer bits different keys get the same hash too often.
+ */
+#define SH_GEN_FROZEN_IMPL(name, map, key_t, value_t, key_hash_expr, key_cmp_expr, key_put_expr, key_del_expr)  \
+    /**                                                                                         */ \
+    /* Builds a frozen table with all items of `hashmap`. Each key is copied with key_put_expr, */ \
+    /* so the hashmap can be destroyed afterwards. Keys are hashed again with key_hash_expr     */ \
+    /* (the stored hashes don't have enough bits to tell millions of keys apart).               */ \
+    /*                                                                                          */ \
+    /* Returns `false` if the memory allocation failed or two keys have the same 64 bit hash.   */ \
+    /* The frozen table is empty in that case but can still be used and destroyed.              */ \
+    bool name##_build(struct name* frozen, struct map* hashmap) {                                  \
+        size_t length = hashmap->length;                                                           \
+        frozen->length = 0;                                                                        \
+        frozen->bucket_count = 0;                                                                  \
+        frozen->pilots = NULL;                                                                     \
+        frozen->items = NULL;                                                                      \
+        if (length == 0)                                                                           \
+            return true;                                                                           \
+                                                                                                   \
+        size_t bucket_count = length / SH_FROZEN_BUCKET_SIZE + 1;                                  \
+        uint64_t* hashes = malloc(length * sizeof(hashes[0]));                                     \
+        struct map##_slot** slots = malloc(length * sizeof(slots[0]));                             \
+        size_t* positions = malloc(length * sizeof(positions[0]));                                 \
+        uint32_t* pilots = malloc(bucket_count * sizeof(pilots[0]));                               \
+        struct name##_item* items = malloc(length * sizeof(items[0]));                             \
+        bool success = hashes && slots && positions && pilots && items;                            \
+                                                                                                   \
+        if (success) {                                                                             \
+            size_t i = 0;                                                                          \
+            for(struct map##_slot* it = map##_start(hashmap); it; it = map##_next(hashmap, it)) {  \
+                key_t key = it->key;                                                               \
+                hashes[i] = (key_hash_expr);                                                       \
+                slots[i++] = it;                                                                   \
+            }                                                                                      \
+            success = sh_perfect_hash_build(hashes, length, bucket_count, pilots, positions);      \
+        }                                                                                          \
+                                                                                                   \
+        if (success) {                                                                             \
+            for(size_t i = 0; i < length; i++) {                                                   \
+                key_t key = slots[i]->key;                                                         \
+                items[positions[i]].key = (key_put_expr);                                          \
+                items[positions[i]].value = slots[i]->value;                                       \
+            }                                                                                      \
+            frozen->length = length;                                                               \
+            frozen->bucket_count = bucket_count;                                                   \
+            frozen->pilots = pilots;                                                               \
+            frozen->items = items;                                                                 \
+        } else {                                                                                   \
+            free(pilots);                                                                          \
+            free(items);                                                                           \
+        }                                                                                          \
+                                                                                                   \
+        free(hashes);                                                                              \
+        free(slots);                                                                               \
+        free(positions);                                                                           \
+        return success;                                                                            \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Destroys the frozen table. Executes key_del_expr for each key and frees all memory.      */ \
+    void name##_destroy(struct name* frozen) {                                                     \
+        for(size_t i = 0; i < frozen->length; i++) {                                               \
+            key_t key = frozen->items[i].key;                                                      \
+            key = key;  /* avoid unused variable warning                                        */ \
+            frozen->items[i].key = (key_del_expr);                                                 \
+        }                                                                                          \
+        free(frozen->pilots);                                                                      \
+        free(frozen->items);                                                                       \
+        frozen->length = 0;                                                                        \
+        frozen->bucket_count = 0;                                                                  \
+        frozen->pilots = NULL;                                                                     \
+        frozen->items = NULL;                                                                      \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Returns a pointer to the value of `key` or NULL if the key isn't in the table. The pilot */ \
+    /* of the key's bucket selects the only item the key can be in, so there is just one key    */ \
+    /* compare.                                                                                 */ \
+    value_t* name##_get_ptr(struct name* frozen, key_t key) {                                      \
+        if (frozen->length == 0)                                                                   \
+            return NULL;                                                                           \
+                                                                                                   \
+        uint64_t hash = (key_hash_expr);                                                           \
+        uint32_t pilot = frozen->pilots[sh_range(hash, frozen->bucket_count)];                     \
+        size_t position = sh_perfect_hash_position(hash, pilot, frozen->length);                   \
+        struct name##_item* item = &frozen->items[position];                                       \
+        key_t a = item->key;                                                                       \
+        key_t b = key;                                                                             \
+        return (key_cmp_expr) ? &item->value : NULL;                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Returns the value of `key` or `default_value` if the key isn't in the table.             */ \
+    value_t name##_get(struct name* frozen, key_t key, value_t default_value) {                    \
+        value_t* value = name##_get_ptr(frozen, key);                                              \
+        return value ? *value : default_value;                                                     \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Returns `true` if the key is in the table.                                               */ \
+    bool name##_contains(struct name* frozen, key_t key) {                                         \
+        return name##_get_ptr(frozen, key) != NULL;                                                \
+    }                                                                                              \
+
+#ifdef SLIM_HASH_CONCURRENT
+
+/**
+ * Declares a hashmap that can be used by many threads at once. It's split into shards by the upper
+ * bits of the hash and each shard is a normal hashmap of type `map` with its own reader/writer
+ * lock. Lookups run in parallel and writes only block threads that access the same shard. `map` has
+ * to be declared with SH_GEN_DECL() or SH_GEN_SOA_DECL() and implemented with any of the ..._IMPL()
+ * macros. Generate the implementation with SH_GEN_CONCURRENT_IMPL(), SH_GEN_CONCURRENT_HASH_IMPL()
+ * or SH_GEN_CONCURRENT_DICT_IMPL() using the same arguments.
+ * 
+ * Only available if SLIM_HASH_CONCURRENT is defined before including the library. The library then
+ * includes pthread.h, so link with -pthread.
+ * 
+ *     SH_GEN_DECL(table, int64_t, int);
+ *     SH_GEN_HASH_IMPL(table, int64_t, int);
+ *     SH_GEN_CONCURRENT_DECL(shared_table, table, int64_t, int);
+ *     SH_GEN_CONCURRENT_HASH_IMPL(shared_table, table, int64_t, int);
+ *     
+ *     struct shared_table t;
+ *     shared_table_new(&t, 64);            // 64 shards
+ *     shared_table_put(&t, 7, 1);          // from any thread
+ *     int v = shared_table_get(&t, 7, 0);  // from any thread
+ *     shared_table_destroy(&t);
+ * 
+ * Each function is atomic on its own. name##_get() copies the value out since other threads can
+ * move it around anytime. Therefore there are no ..._ptr() functions and no iterators. Use
+ * name##_update() to change a value based on its current value.
+ * 
+ * The resulting functions:
+ * 
+ *     bool     name##_new(struct name* hashmap, uint32_t shard_count);
+ *     void     name##_destroy(struct name* hashmap);
+ *     
+ *     value_t  name##_get(struct name* hashmap, key_t key, value_t default_value);
+ *     bool     name##_put(struct name* hashmap, key_t key, value_t value);
+ *     bool     name##_del(struct name* hashmap, key_t key);
+ *     bool     name##_contains(struct name* hashmap, key_t key);
+ *     bool     name##_update(struct name* hashmap, key_t key,
+ *                  void (*func)(value_t* value, bool inserted, void* data), void* data);
+ *     size_t   name##_length(struct name* hashmap);
+ *     bool     name##_reduce(struct name* hashmap, struct map* maps, size_t map_count,
+ *                  void (*combine)(value_t* dst_value, value_t src_value, void* data), void* data,
+ *                  uint32_t thread_count);
+ * 
+ * name##_reduce() merges many normal hashmaps (e.g. one filled by each thread) into the shared one
+ * with several threads. Each thread merges the items of a different range of shards.
+ * 
+ * If SLIM_HASH_NO_TYPEDEFS is defined no typedefs for shorthand types ending with ..._t and ..._p
+ * are defined.
+ */
+#ifdef SLIM_HASH_NO_TYPEDEFS
+    #define SH_GEN_CONCURRENT_DECL(name, map, key_t, value_t)                                      \
+        SH_GEN_CONCURRENT_TYPES_AND_PROTOTYPES(name, map, key_t, value_t)
+#else
+    #define SH_GEN_CONCURRENT_DECL(name, map, key_t, value_t)                                      \
+        SH_GEN_CONCURRENT_TYPES_AND_PROTOTYPES(name, map, key_t, value_t)                          \
+        typedef struct name name##_t, *name##_p;
+#endif
+
+#define SH_GEN_CONCURRENT_TYPES_AND_PROTOTYPES(name, map, key_t, value_t)                          \
+    struct name##_shard {                                                                          \
+        pthread_rwlock_t lock;                                                                     \
+        struct map hashmap;                                                                        \
+        /* Keeps the locks of neighboring shards in different cache lines                       */ \
+        char padding[64];                                                                          \
+    };                                                                                             \
+                                                                                                   \
+    struct name {                                                                                  \
+        uint32_t shard_bits;                                                                       \
+        struct name##_shard* shards;                                                               \
+    };                                                                                             \
+                                                                                                   \
+    bool     name##_new(struct name* hashmap, uint32_t shard_count);                               \
+    void     name##_destroy(struct name* hashmap);                                                 \
+                                                                                                   \
+    value_t  name##_get(struct name* hashmap, key_t key, value_t default_value);                   \
+    bool     name##_put(struct name* hashmap, key_t key, value_t value);                           \
+    bool     name##_del(struct name* hashmap, key_t key);                                          \
+    bool     name##_contains(struct name* hashmap, key_t key);                                     \
+    bool     name##_update(struct name* hashmap, key_t key,                                        \
+                 void (*func)(value_t* value, bool inserted, void* data), void* data);             \
+    size_t   name##_length(struct name* hashmap);                                                  \
+    bool     name##_reduce(struct name* hashmap, struct map* maps, size_t map_count,               \
+                 void (*combine)(value_t* dst_value, value_t src_value, void* data), void* data,   \
+                 uint32_t thread_count);                                                           \
+
+/**
+ * Same as SH_GEN_HASH_IMPL() but for hashmaps declared with SH_GEN_CONCURRENT_DECL(). `map` should
+ * be implemented with SH_GEN_HASH_IMPL() or one of its variants.
+ */
+#define SH_GEN_CONCURRENT_HASH_IMPL(name, map, key_t, value_t)                                     \
+    SH_GEN_CONCURRENT_IMPL(name, map, key_t, value_t,                                              \
+        sh_value_hash(&key, sizeof(key))  /* key_hash_expr(key_t key)                           */ \
+    )
+
+/**
+ * Same as SH_GEN_DICT_IMPL() but for hashmaps declared with SH_GEN_CONCURRENT_DECL(). `map` should
+ * be implemented with SH_GEN_DICT_IMPL() or one of its variants.
+ */
+#define SH_GEN_CONCURRENT_DICT_IMPL(name, map, key_t, value_t)                                     \
+    SH_GEN_CONCURRENT_IMPL(name, map, key_t, value_t,                                              \
+        sh_bytes_hash(key, strlen(key))  /* key_hash_expr(key_t key)                            */ \
+    )
+
+/**
+ * Internal macro that declares the functions SH_GEN_CONCURRENT_IMPL() uses to merge hashmaps in
+ * parallel. All hashmap implementations generate them, but they are not part of the public API and
+ * not declared by SH_GEN_DECL() or SH_GEN_SOA_DECL().
+ */
+#define SH_GEN_PARTITION_PROTOTYPES(name, key_t, value_t)                                          \
+    void     name##_count_partitions(struct name* hashmap, uint32_t partition_bits,                \
+                 size_t* counts);                                                                  \
+    void     name##_scatter_partitions(struct name* hashmap, uint32_t partition_bits,              \
+                 size_t* cursors, sh_size_t* positions);                                           \
+    bool     name##_merge_positions(struct name* dst, struct name* src, sh_size_t* positions,      \
+                 size_t count, void (*combine)(value_t* dst_value, value_t src_value, void* data), \
+                 void* data);                                                                      \
+
+/**
+ * Generates the implementation of a hashmap declared with SH_GEN_CONCURRENT_DECL(). key_hash_expr
+ * selects the shard of a key (by its upper bits) and should be the same hash `map` uses. The shard
+ * then hashes the key again to find its slot.
+ */
+#define SH_GEN_CONCURRENT_IMPL(name, map, key_t, value_t, key_hash_expr)                           \
+    SH_GEN_PARTITION_PROTOTYPES(map, key_t, value_t)                                               \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Returns the shard responsible for the key. The upper bits of the hash select the shard   */ \
+    /* (see sh_partition()), the shard itself uses the lower bits to select the slot.           */ \
+    /*                                                                                          */ \
+    /* This function is not part of the public API! Don't use it in your code unless you know   */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    struct name##_shard* name##_shard_for(struct name* hashmap, key_t key) {                       \
+        sh_hash_t hash = (key_hash_expr) | SH_SLOT_FILLED;                                         \
+        return &hashmap->shards[sh_partition(hash, hashmap->shard_bits)];                          \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Initializes a new empty hashmap with `shard_count` shards (rounded up to the next power  */ \
+    /* of two, at most 65536). Use a few times more shards than threads access the hashmap so   */ \
+    /* writers rarely block each other.                                                         */ \
+    /*                                                                                          */ \
+    /* Returns `false` if the memory allocation for the shards failed.                          */ \
+    bool name##_new(struct name* hashmap, uint32_t shard_count) {                                  \
+        hashmap->shard_bits = 0;                                                                   \
+        while ((1u << hashmap->shard_bits) < shard_count && hashmap->shard_bits < 16)              \
+            hashmap->shard_bits++;                                                                 \
+                                                                                                   \
+        uint32_t count = 1u << hashmap->shard_bits;                                                \
+        hashmap->shards = calloc(count, sizeof(hashmap->shards[0]));                               \
+        if (hashmap->shards == NULL)                                                               \
+            return false;                                                                          \
+                                                                                                   \
+        for(uint32_t i = 0; i < count; i++) {                                                      \
+            pthread_rwlock_init(&hashmap->shards[i].lock, NULL);                                   \
+            map##_new(&hashmap->shards[i].hashmap);                                                \
+        }                                                                                          \
+        return true;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Destroys the hashmap and all its shards. No other thread may use the hashmap at that     */ \
+    /* point.                                                                                   */ \
+    void name##_destroy(struct name* hashmap) {                                                    \
+        for(uint32_t i = 0; i < (1u << hashmap->shard_bits); i++) {                                \
+            map##_destroy(&hashmap->shards[i].hashmap);                                            \
+            pthread_rwlock_destroy(&hashmap->shards[i].lock);                                      \
+        }                                                                                          \
+        free(hashmap->shards);                                                                     \
+        hashmap->shards = NULL;                                                                    \
+        hashmap->shard_bits = 0;                                                                   \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Fetches a copy of the value for the specified key or returns `default_value` if the key  */ \
+    /* isn't in the hashmap. Only takes the read lock of the shard.                             */ \
+    value_t name##_get(struct name* hashmap, key_t key, value_t default_value) {                   \
+        struct name##_shard* shard = name##_shard_for(hashmap, key);                               \
+        pthread_rwlock_rdlock(&shard->lock);                                                       \
+        value_t value = map##_get(&shard->hashmap, key, default_value);                            \
+        pthread_rwlock_unlock(&shard->lock);                                                       \
+        return value;                                                                              \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Checks if the specified key exists in the hashmap. Only takes the read lock of the       */ \
+    /* shard.                                                                                   */ \
+    bool name##_contains(struct name* hashmap, key_t key) {                                        \
+        struct name##_shard* shard = name##_shard_for(hashmap, key);                               \
+        pthread_rwlock_rdlock(&shard->lock);                                                       \
+        bool found = map##_contains(&shard->hashmap, key);                                         \
+        pthread_rwlock_unlock(&shard->lock);                                                       \
+        return found;                                                                              \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Inserts a value at the specified key. An existing value for the same key is overwritten. */ \
+    /* Returns `false` if the shard needed to grow but the memory allocation for that failed.   */ \
+    bool name##_put(struct name* hashmap, key_t key, value_t value) {                              \
+        struct name##_shard* shard = name##_shard_for(hashmap, key);                               \
+        pthread_rwlock_wrlock(&shard->lock);                                                       \
+        value_t* value_ptr = map##_put_ptr(&shard->hashmap, key);                                  \
+        if (value_ptr)                                                                             \
+            *value_ptr = value;                                                                    \
+        pthread_rwlock_unlock(&shard->lock);                                                       \
+        return value_ptr != NULL;                                                                  \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Deletes the key-value pair for the specified key. Returns `true` if it was deleted,      */ \
+    /* `false` if the key wasn't in the hashmap.                                                */ \
+    bool name##_del(struct name* hashmap, key_t key) {                                             \
+        struct name##_shard* shard = name##_shard_for(hashmap, key);                               \
+        pthread_rwlock_wrlock(&shard->lock);                                                       \
+        bool deleted = map##_del(&shard->hashmap, key);                                            \
+        pthread_rwlock_unlock(&shard->lock);                                                       \
+        return deleted;                                                                            \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Calls `func` with a pointer to the value of the specified key while holding the write    */ \
+    /* lock of its shard. If the key isn't in the hashmap yet it is inserted first and          */ \
+    /* `inserted` is `true`. `func` has to initialize the value in that case. `data` is passed  */ \
+    /* to `func` as it is. Use this to change a value based on its current value, e.g. to       */ \
+    /* increment a counter:                                                                     */ \
+    /*                                                                                          */ \
+    /*    void increment(int* value, bool inserted, void* data) {                               */ \
+    /*        *value = inserted ? 1 : *value + 1;                                               */ \
     /*    }                                                                                     */ \
+    /*    shared_table_update(&t, key, increment, NULL);                                        */ \
     /*                                                                                          */ \
-    /*    // If you removed almost all items this will shrink the hashmap after the loop.       */ \
-    /*    // This is only needed in extreme cases.                                              */ \
-    /*    hash_shrink_if_necessary(&hash);                                                      */ \
+    /* `func` must not use the hashmap. Returns `false` if the shard needed to grow but the     */ \
+    /* memory allocation for that failed, `func` isn't called in that case.                     */ \
+    bool name##_update(struct name* hashmap, key_t key,                                            \
+        void (*func)(value_t* value, bool inserted, void* data), void* data) {                     \
+        struct name##_shard* shard = name##_shard_for(hashmap, key);                               \
+        pthread_rwlock_wrlock(&shard->lock);                                                       \
+        sh_size_t length = shard->hashmap.length;                                                  \
+        value_t* value_ptr = map##_put_ptr(&shard->hashmap, key);                                  \
+        if (value_ptr)                                                                             \
+            func(value_ptr, shard->hashmap.length > length, data);                                 \
+        pthread_rwlock_unlock(&shard->lock);                                                       \
+        return value_ptr != NULL;                                                                  \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Returns the number of items in all shards. The shards are counted one after the other so */ \
+    /* with concurrent writes the result is just an estimate.                                   */ \
+    size_t name##_length(struct name* hashmap) {                                                   \
+        size_t length = 0;                                                                         \
+        for(uint32_t i = 0; i < (1u << hashmap->shard_bits); i++) {                                \
+            pthread_rwlock_rdlock(&hashmap->shards[i].lock);                                       \
+            length += hashmap->shards[i].hashmap.length;                                           \
+            pthread_rwlock_unlock(&hashmap->shards[i].lock);                                       \
+        }                                                                                          \
+        return length;                                                                             \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Arguments of the threads started by name##_reduce(). Each thread either sorts the items  */ \
+    /* of the maps `first` to `last` (exclusive) by shard or merges the sorted items of all     */ \
+    /* maps into the shards `first` to `last` (exclusive).                                      */ \
     /*                                                                                          */ \
-    /* You can't add new items to the hashmap during iteration (name##_put() or                 */ \
-    /* name##_put_ptr()) since that invalidates the pointer of the iterator (and might lead to  */ \
-    /* seg faults). name##_del() also can't be used during iteration (same problem) but you can */ \
-    /* use name##_remove() to mark the current item as deleted and call                         */ \
-    /* name##_shrink_if_necessary() if chances are that you deleted most items.                 */ \
+    /* This struct is not part of the public API! Don't use it in your code unless you know     */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    struct name##_reduce_part {                                                                    \
+        pthread_t thread;                                                                          \
+        struct name* hashmap;                                                                      \
+        struct map* maps;                                                                          \
+        size_t map_count;                                                                          \
+        /* Items per shard and where they end in `positions`, one row of shard_count entries    */ \
+        /* per map. The positions of all items are grouped by map and then by shard.            */ \
+        size_t* counts;                                                                            \
+        size_t* ends;                                                                              \
+        sh_size_t* positions;                                                                      \
+        uint32_t first, last;                                                                      \
+        void (*combine)(value_t* dst_value, value_t src_value, void* data);                        \
+        void* data;                                                                                \
+        bool success;                                                                              \
+    };                                                                                             \
+                                                                                                   \
+    void* name##_count_thread(void* arg) {                                                         \
+        struct name##_reduce_part* part = arg;                                                     \
+        uint32_t shard_count = 1u << part->hashmap->shard_bits;                                    \
+        for(uint32_t m = part->first; m < part->last; m++) {                                       \
+            size_t* counts = part->counts + (size_t)m * shard_count;                               \
+            size_t* ends = part->ends + (size_t)m * shard_count;                                   \
+            map##_count_partitions(&part->maps[m], part->hashmap->shard_bits, counts);             \
+                                                                                                   \
+            /* ends[0] is the first position of the map, the other shards follow. The scatter   */ \
+            /* then moves each entry from the start to the end of its shard.                    */ \
+            for(uint32_t s = 1; s < shard_count; s++)                                              \
+                ends[s] = ends[s - 1] + counts[s - 1];                                             \
+            map##_scatter_partitions(&part->maps[m], part->hashmap->shard_bits, ends,              \
+                part->positions);                                                                  \
+        }                                                                                          \
+        return NULL;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    void* name##_merge_thread(void* arg) {                                                         \
+        struct name##_reduce_part* part = arg;                                                     \
+        struct name* hashmap = part->hashmap;                                                      \
+        uint32_t shard_count = 1u << hashmap->shard_bits;                                          \
+                                                                                                   \
+        /* Reserve the capacity for all items of a shard up front so it's never resized while   */ \
+        /* merging. Keys in more than one map are counted multiple times, so with many of those */ \
+        /* the shards end up larger than necessary.                                             */ \
+        for(uint32_t s = part->first; s < part->last; s++) {                                       \
+            pthread_rwlock_wrlock(&hashmap->shards[s].lock);                                       \
+            size_t length = hashmap->shards[s].hashmap.length;                                     \
+            for(size_t m = 0; m < part->map_count; m++)                                            \
+                length += part->counts[m * shard_count + s];                                       \
+            if ( map##_reserve(&hashmap->shards[s].hashmap, length) == false )                     \
+                part->success = false;                                                             \
+        }                                                                                          \
+                                                                                                   \
+        /* Only the items of our own shards are touched, their positions were sorted out by     */ \
+        /* name##_count_thread().                                                               */ \
+        for(uint32_t s = part->first; s < part->last && part->success; s++) {                      \
+            for(size_t m = 0; m < part->map_count && part->success; m++) {                         \
+                size_t count = part->counts[m * shard_count + s];                                  \
+                sh_size_t* positions = part->positions + part->ends[m * shard_count + s] - count;  \
+                part->success = map##_merge_positions(&hashmap->shards[s].hashmap,                 \
+                    &part->maps[m], positions, count, part->combine, part->data);                  \
+            }                                                                                      \
+        }                                                                                          \
+                                                                                                   \
+        for(uint32_t s = part->first; s < part->last; s++)                                         \
+            pthread_rwlock_unlock(&hashmap->shards[s].lock);                                       \
+        return NULL;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Merges the items of all `map_count` hashmaps in `maps` into the shared hashmap. Keys     */ \
+    /* that are in more than one hashmap are combined with `combine` like name##_merge() of     */ \
+    /* SH_GEN_MAP_FUNCTIONS() does (`NULL` overwrites the values). E.g. to sum up the word      */ \
+    /* counts of several threads:                                                               */ \
     /*                                                                                          */ \
-    struct name##_slot* name##_start(struct name* hashmap) {                                       \
-        /* We need to start at an invalid slot address since sh_next() increments it before it  */ \
-        /* looks at it (so it's safe).                                                          */ \
-        return name##_next(hashmap, hashmap->slots - 1);                                           \
+    /*    void add(int* dst_value, int src_value, void* data) {                                 */ \
+    /*        *dst_value += src_value;                                                          */ \
+    /*    }                                                                                     */ \
+    /*    shared_words_reduce(&total_counts, thread_counts, thread_count, add, NULL, 8);        */ \
+    /*                                                                                          */ \
+    /* `thread_count` threads do the work (at most one per shard). First they count how many    */ \
+    /* items of each hashmap belong into which shard and sort the positions of the items by    */  \
+    /* shard. Then each thread reserves the capacity of its range of shards and merges just the */ \
+    /* items of that range from all hashmaps. The threads never write to the same shard, the    */ \
+    /* shards are not resized while merging and the stored hashes of the items are reused.     */  \
+    /* `maps` aren't changed and `combine` has to be thread-safe. The sorting needs one         */ \
+    /* sh_size_t per item of `maps` as temporary memory.                                       */  \
+    /*                                                                                          */ \
+    /* Returns `false` if starting the threads or a memory allocation failed. In that case only */ \
+    /* some items are merged.                                                                   */ \
+    bool name##_reduce(struct name* hashmap, struct map* maps, size_t map_count,                   \
+        void (*combine)(value_t* dst_value, value_t src_value, void* data), void* data,            \
+        uint32_t thread_count) {                                                                   \
+        uint32_t shard_count = 1u << hashmap->shard_bits;                                          \
+        if (thread_count < 1)                                                                      \
+            thread_count = 1;                                                                      \
+        if (thread_count > shard_count)                                                            \
+            thread_count = shard_count;                                                            \
+                                                                                                   \
+        size_t item_count = 0;                                                                     \
+        for(size_t m = 0; m < map_count; m++)                                                      \
+            item_count += maps[m].length;                                                          \
+                                                                                                   \
+        struct name##_reduce_part* parts = calloc(thread_count, sizeof(parts[0]));                 \
+        size_t* counts = calloc(map_count * shard_count + 1, sizeof(counts[0]));                   \
+        size_t* ends = calloc(map_count * shard_count + 1, sizeof(ends[0]));                       \
+        sh_size_t* positions = malloc((item_count + 1) * sizeof(positions[0]));                    \
+        bool success = (parts != NULL && counts != NULL && ends != NULL && positions != NULL);     \
+                                                                                                   \
+        /* The positions of each map start after the ones of the maps before it                 */ \
+        for(size_t m = 1; m < map_count && success; m++)                                           \
+            ends[m * shard_count] = ends[(m - 1) * shard_count] + maps[m - 1].length;              \
+                                                                                                   \
+        /* First phase counts, second phase merges. Both split their work evenly.               */ \
+        void* (*phases[2])(void*) = { name##_count_thread, name##_merge_thread };                  \
+        size_t work[2] = { map_count, shard_count };                                               \
+        for(int phase = 0; phase < 2 && success; phase++) {                                        \
+            uint32_t started = 0;                                                                  \
+            for(; started < thread_count; started++) {                                             \
+                parts[started] = (struct name##_reduce_part){                                      \
+                    .hashmap = hashmap, .maps = maps, .map_count = map_count, .counts = counts,    \
+                    .ends = ends, .positions = positions,                                          \
+                    .first = work[phase] * started / thread_count,                                 \
+                    .last = work[phase] * (started + 1) / thread_count,                            \
+                    .combine = combine, .data = data, .success = true                              \
+                };                                                                                 \
+                if ( pthread_create(&parts[started].thread, NULL, phases[phase],                   \
+                    &parts[started]) != 0 ) {                                                      \
+                    success = false;                                                               \
+                    break;                                                                         \
+                }                                                                                  \
+            }                                                                                      \
+                                                                                                   \
+            for(uint32_t i = 0; i < started; i++) {                                                \
+                pthread_join(parts[i].thread, NULL);                                               \
+                success = success && parts[i].success;                                             \
+            }                                                                                      \
+        }                                                                                          \
+                                                                                                   \
+        free(parts);                                                                               \
+        free(counts);                                                                              \
+        free(ends);                                                                                \
+        free(positions);                                                                           \
+        return success;                                                                            \
+    }                                                                                              \
+
+/**
+ * Declares an insert-only hashmap that many threads can fill at the same time without any locks,
+ * e.g. to build a large lookup or deduplication table in parallel and only read it afterwards.
+ * Generate the implementation with SH_GEN_ATOMIC_IMPL(), SH_GEN_ATOMIC_HASH_IMPL() or
+ * SH_GEN_ATOMIC_DICT_IMPL() using the same arguments.
+ * 
+ * The capacity is fixed when the table is created and items can't be deleted. Inserting threads
+ * claim a free slot with an atomic compare-and-swap on its hash_or_flags, write the key and value
+ * and then publish the hash with a release store. Readers never wait, they simply don't see an
+ * item until it's published. Only an insert that finds an unpublished slot with the same hash
+ * waits for it, so the same key is never inserted twice.
+ * 
+ * Only available if SLIM_HASH_CONCURRENT is defined before including the library and the compiler
+ * supports the __atomic builtins (GCC and Clang do).
+ * 
+ *     SH_GEN_ATOMIC_DECL(ids, int64_t, uint32_t);
+ *     SH_GEN_ATOMIC_HASH_IMPL(ids, int64_t, uint32_t);
+ *     
+ *     struct ids t;
+ *     ids_new(&t, 1000000);  // room for 1 million items
+ *     
+ *     // From any thread
+ *     bool inserted = false;
+ *     uint32_t* id = ids_insert(&t, key, next_id, &inserted);
+ *     if (!inserted)
+ *         ...  // key was already in the table, *id is the value inserted first
+ *     
+ *     ids_destroy(&t);
+ * 
+ * The resulting functions:
+ * 
+ *     bool      name##_new(struct name* table, size_t length);
+ *     bool      name##_build_from_arrays(struct name* table, key_t* keys, value_t* values,
+ *                   size_t count, uint32_t thread_count);
+ *     void      name##_destroy(struct name* table);
+ *     
+ *     value_t*  name##_insert(struct name* table, key_t key, value_t value, bool* inserted);
+ *     value_t   name##_get(struct name* table, key_t key, value_t default_value);
+ *     bool      name##_contains(struct name* table, key_t key);
+ *     value_t*  name##_get_ptr(struct name* table, key_t key);
+ *     size_t    name##_length(struct name* table);
+ *     
+ *     struct name##_slot*  name##_start(struct name* table);
+ *     struct name##_slot*  name##_next(struct name* table, struct name##_slot* it);
+ * 
+ * Values must not be changed once the item is inserted (other threads might read them at the same
+ * time). If SLIM_HASH_NO_TYPEDEFS is defined no typedefs for shorthand types ending with ..._t and
+ * ..._p are defined.
+ */
+#ifdef SLIM_HASH_NO_TYPEDEFS
+    #define SH_GEN_ATOMIC_DECL(name, key_t, value_t)                                               \
+        SH_GEN_ATOMIC_TYPES_AND_PROTOTYPES(name, key_t, value_t)
+#else
+    #define SH_GEN_ATOMIC_DECL(name, key_t, value_t)                                               \
+        SH_GEN_ATOMIC_TYPES_AND_PROTOTYPES(name, key_t, value_t)                                   \
+        typedef struct name name##_t, *name##_p;                                                   \
+        typedef struct name##_slot *name##_it_p;
+#endif
+
+#define SH_GEN_ATOMIC_TYPES_AND_PROTOTYPES(name, key_t, value_t)                                   \
+    struct name##_slot {                                                                           \
+        sh_hash_t hash_or_flags;                                                                   \
+        key_t key;                                                                                 \
+        value_t value;                                                                             \
+    };                                                                                             \
+                                                                                                   \
+    struct name {                                                                                  \
+        sh_size_t capacity;                                                                        \
+        struct name##_slot* slots;                                                                 \
+    };                                                                                             \
+                                                                                                   \
+    bool      name##_new(struct name* table, size_t length);                                       \
+    bool      name##_build_from_arrays(struct name* table, key_t* keys, value_t* values,           \
+                  size_t count, uint32_t thread_count);                                            \
+    void      name##_destroy(struct name* table);                                                  \
+                                                                                                   \
+    value_t*  name##_insert(struct name* table, key_t key, value_t value, bool* inserted);         \
+    value_t   name##_get(struct name* table, key_t key, value_t default_value);                    \
+    bool      name##_contains(struct name* table, key_t key);                                      \
+    value_t*  name##_get_ptr(struct name* table, key_t key);                                       \
+    size_t    name##_length(struct name* table);                                                   \
+                                                                                                   \
+    struct name##_slot*  name##_start(struct name* table);                                         \
+    struct name##_slot*  name##_next(struct name* table, struct name##_slot* it);                  \
+
+/**
+ * Same as SH_GEN_HASH_IMPL() but for tables declared with SH_GEN_ATOMIC_DECL().
+ */
+#define SH_GEN_ATOMIC_HASH_IMPL(name, key_t, value_t)                                              \
+    SH_GEN_ATOMIC_IMPL(name, key_t, value_t,                                                       \
+        sh_value_hash(&key, sizeof(key)),  /* key_hash_expr(key_t key)                          */ \
+        (a == b),  /* key_cmp_expr(key_t a, key_t b)                                            */ \
+        key,  /* key_put_expr(key_t key)                                                        */ \
+        0,  /* key_del_expr(key_t key)                                                          */ \
+        calloc(capacity, slot_size),  /* calloc_expr(size_t capacity, size_t slot_size)         */ \
+        free(ptr)  /* free_expr(void* ptr)                                                      */ \
+    )                                                                                              \
+
+/**
+ * Same as SH_GEN_DICT_IMPL() but for tables declared with SH_GEN_ATOMIC_DECL().
+ */
+#define SH_GEN_ATOMIC_DICT_IMPL(name, key_t, value_t)                                              \
+    SH_GEN_ATOMIC_IMPL(name, key_t, value_t,                                                       \
+        sh_bytes_hash(key, strlen(key)),  /* key_hash_expr(key_t key)                           */ \
+        (strcmp(a, b) == 0),  /* key_cmp_expr(key_t a, key_t b)                                 */ \
+        sh_strdup(key),  /* key_put_expr(key_t key)                                             */ \
+        (free((void*)key), NULL),  /* key_del_expr(key_t key)                                   */ \
+        calloc(capacity, slot_size),  /* calloc_expr(size_t capacity, size_t slot_size)         */ \
+        free(ptr)  /* free_expr(void* ptr)                                                      */ \
+    )                                                                                              \
+
+/**
+ * Generates the implementation of a table declared with SH_GEN_ATOMIC_DECL(). The arguments are the
+ * same as for SH_GEN_IMPL(). key_put_expr is executed by the inserting thread before the item is
+ * published, key_del_expr only when the table is destroyed.
+ */
+#define SH_GEN_ATOMIC_IMPL(name, key_t, value_t, key_hash_expr, key_cmp_expr, key_put_expr, key_del_expr, calloc_expr, free_expr)  \
+    /**                                                                                         */ \
+    /* Initializes a new empty table with a fixed capacity for `length` items (with the default */ \
+    /* load factor SH_MAX_LOAD). Inserts fail when the table is completely full and get slower  */ \
+    /* the more the table is filled beyond that.                                                */ \
+    /*                                                                                          */ \
+    /* Returns `false` if the memory allocation failed.                                         */ \
+    bool name##_new(struct name* table, size_t length) {                                           \
+        table->capacity = sh_capacity_for(length, SH_MAX_LOAD);                                    \
+        table->slots = NULL;                                                                       \
+        if (table->capacity == 0)                                                                  \
+            return false;                                                                          \
+                                                                                                   \
+        /* capacity and slot_size variables are used to pass arguments to calloc_expr which in  */ \
+        /* turn should allocate memory like calloc() does.                                      */ \
+        size_t capacity = table->capacity;                                                         \
+        size_t slot_size = sizeof(table->slots[0]);                                                \
+        table->slots = calloc_expr;                                                                \
+        if (table->slots == NULL)                                                                  \
+            table->capacity = 0;                                                                   \
+        return table->slots != NULL;                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Destroys the table. Cleans up all the keys be executing the key_del_expr for each one    */ \
+    /* and frees all associated memory. No other thread may use the table at that point.        */ \
+    void name##_destroy(struct name* table) {                                                      \
+        for(struct name##_slot* it = name##_start(table); it; it = name##_next(table, it)) {       \
+            key_t key = it->key;                                                                   \
+            key = key;  /* avoid unused variable warning                                        */ \
+            it->key = (key_del_expr);                                                              \
+        }                                                                                          \
+                                                                                                   \
+        /* ptr is used as an argument to the  free_expr which should free the  memory of ptr    */ \
+        /* like free() does.                                                                    */ \
+        void* ptr = table->slots;                                                                  \
+        ptr = ptr;  /* avoid unused variable warning if free_expr doesn't use ptr               */ \
+        free_expr;                                                                                 \
+        table->slots = NULL;                                                                       \
+        table->capacity = 0;                                                                       \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Inserts the key-value pair unless the key is already in the table. Sets `inserted` to    */ \
+    /* `true` if the pair was inserted and `false` if the key was already there. Returns a      */ \
+    /* pointer to the value stored for the key (either `value` or the value inserted first).    */ \
+    /* Can be called by many threads at once.                                                   */ \
+    /*                                                                                          */ \
+    /* Returns `NULL` if the table is full.                                                     */ \
+    value_t* name##_insert(struct name* table, key_t key, value_t value, bool* inserted) {         \
+        sh_hash_t hash = (key_hash_expr) | SH_SLOT_FILLED;                                         \
+        sh_hash_t claimed = (hash & (SH_SLOT_CLAIMED - 1)) | SH_SLOT_CLAIMED;                      \
+        sh_size_t index = hash & (table->capacity - 1);                                            \
+                                                                                                   \
+        for(sh_size_t probes = 0; probes < table->capacity; probes++) {                            \
+            struct name##_slot* slot = &table->slots[index];                                       \
+            sh_hash_t current = __atomic_load_n(&slot->hash_or_flags, __ATOMIC_ACQUIRE);           \
+            if (current == SH_SLOT_FREE) {                                                         \
+                if ( __atomic_compare_exchange_n(&slot->hash_or_flags, &current, claimed, false,   \
+                    __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE) ) {                                        \
+                    slot->key = (key_put_expr);                                                    \
+                    slot->value = value;                                                           \
+                    __atomic_store_n(&slot->hash_or_flags, hash, __ATOMIC_RELEASE);                \
+                    *inserted = true;                                                              \
+                    return &slot->value;                                                           \
+                }                                                                                  \
+                /* Another thread claimed the slot first, current now contains its state        */ \
+            }                                                                                      \
+                                                                                                   \
+            /* Another thread is inserting a key that might be the same, wait until it's        */ \
+            /* published so we can compare the keys.                                            */ \
+            while (current == claimed)                                                             \
+                current = __atomic_load_n(&slot->hash_or_flags, __ATOMIC_ACQUIRE);                 \
+                                                                                                   \
+            if (current == hash) {                                                                 \
+                key_t a = slot->key;                                                               \
+                key_t b = key;                                                                     \
+                if (key_cmp_expr) {                                                                \
+                    *inserted = false;                                                             \
+                    return &slot->value;                                                           \
+                }                                                                                  \
+            }                                                                                      \
+                                                                                                   \
+            index = (index + 1) & (table->capacity - 1);                                           \
+        }                                                                                          \
+                                                                                                   \
+        return NULL;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Looks up the specified key and returns a pointer to its value or `NULL` if the key isn't */ \
+    /* in the table. Never waits for other threads, items that are just being inserted are not  */ \
+    /* found yet.                                                                               */ \
+    value_t* name##_get_ptr(struct name* table, key_t key) {                                       \
+        sh_hash_t hash = (key_hash_expr) | SH_SLOT_FILLED;                                         \
+        sh_size_t index = hash & (table->capacity - 1);                                            \
+                                                                                                   \
+        for(sh_size_t probes = 0; probes < table->capacity; probes++) {                            \
+            struct name##_slot* slot = &table->slots[index];                                       \
+            sh_hash_t current = __atomic_load_n(&slot->hash_or_flags, __ATOMIC_ACQUIRE);           \
+            if (current == SH_SLOT_FREE)                                                           \
+                return NULL;                                                                       \
+                                                                                                   \
+            if (current == hash) {                                                                 \
+                key_t a = slot->key;                                                               \
+                key_t b = key;                                                                     \
+                if (key_cmp_expr)                                                                  \
+                    return &slot->value;                                                           \
+            }                                                                                      \
+                                                                                                   \
+            index = (index + 1) & (table->capacity - 1);                                           \
+        }                                                                                          \
+                                                                                                   \
+        return NULL;                                                                               \
     }                                                                                              \
                                                                                                    \
     /**                                                                                         */ \
-    /* Advances the iterator to the next item in the hashmap or returns `NULL` if there is no   */ \
-    /* next element.                                                                            */ \
-    /*                                                                                          */ \
-    /* See name##_start() for how to use this function.                                         */ \
-    struct name##_slot* name##_next(struct name* hashmap, struct name##_slot* it) {                            \
+    /* Fetches the value for the specified key or returns `default_value` if the key isn't in   */ \
+    /* the table.                                                                               */ \
+    value_t name##_get(struct name* table, key_t key, value_t default_value) {                     \
+        value_t* value_ptr = name##_get_ptr(table, key);                                           \
+        return (value_ptr) ? *value_ptr : default_value;                                           \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Checks if the specified key is in the table.                                             */ \
+    bool name##_contains(struct name* table, key_t key) {                                          \
+        return name##_get_ptr(table, key) != NULL;                                                 \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Counts the items in the table. This looks at every slot, so it's meant to be used after  */ \
+    /* the table was filled.                                                                    */ \
+    size_t name##_length(struct name* table) {                                                     \
+        size_t length = 0;                                                                         \
+        for(struct name##_slot* it = name##_start(table); it; it = name##_next(table, it))         \
+            length++;                                                                              \
+        return length;                                                                             \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Iterates over all published items. Works like name##_start() and name##_next() of        */ \
+    /* SH_GEN_MAP_FUNCTIONS(), except that items can't be removed.                              */ \
+    struct name##_slot* name##_start(struct name* table) {                                         \
+        return name##_next(table, table->slots - 1);                                               \
+    }                                                                                              \
+                                                                                                   \
+    struct name##_slot* name##_next(struct name* table, struct name##_slot* it) {                  \
         if (it == NULL)                                                                            \
             return NULL;                                                                           \
                                                                                                    \
         do {                                                                                       \
             it++;                                                                                  \
-            /* Check if we're past the last slot.                                               */ \
-            if (it - hashmap->slots >= hashmap->capacity)                                          \
+            if ((size_t)(it - table->slots) >= table->capacity)                                    \
                 return NULL;                                                                       \
-        } while( it->hash_or_flags == SH_SLOT_FREE || it->hash_or_flags == SH_SLOT_DELETED );      \
+        } while ( !(__atomic_load_n(&it->hash_or_flags, __ATOMIC_ACQUIRE) & SH_SLOT_FILLED) );     \
                                                                                                    \
         return it;                                                                                 \
     }                                                                                              \
                                                                                                    \
     /**                                                                                         */ \
-    /* Removes the item the iterator points to from the hashmap. This function is meant to be   */ \
-    /* used while iterating over all items of the hashmap. The hashmap is not resized, even if  */ \
-    /* all items are removed. Instead it is shrunk at the next call to name##_del() or          */ \
-    /* name##_shrink_if_necessary().                                                            */ \
+    /* Arguments of the threads started by name##_build_from_arrays().                          */ \
     /*                                                                                          */ \
-    /* See name##_start() for how to use this function.                                         */ \
-    void name##_remove(struct name* hashmap, struct name##_slot* it) {                             \
-        if (it != NULL && it >= hashmap->slots && it - hashmap->slots < hashmap->capacity) {       \
+    /* This struct is not part of the public API! Don't use it in your code unless you know     */ \
+    /* _exactly_ what you're doing!                                                             */ \
+    struct name##_build_part {                                                                     \
+        pthread_t thread;                                                                          \
+        struct name* table;                                                                        \
+        key_t* keys;                                                                               \
+        value_t* values;                                                                           \
+        size_t count;                                                                              \
+        bool full;                                                                                 \
+    };                                                                                             \
+                                                                                                   \
+    void* name##_build_thread(void* arg) {                                                         \
+        struct name##_build_part* part = arg;                                                      \
+        bool inserted = false;                                                                     \
+        for(size_t i = 0; i < part->count; i++) {                                                  \
+            if (name##_insert(part->table, part->keys[i], part->values[i], &inserted) == NULL)     \
+                part->full = true;                                                                 \
+        }                                                                                          \
+        return NULL;                                                                               \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Initializes a new table with the `count` key-value pairs from the `keys` and `values`    */ \
+    /* arrays. The arrays are split into `thread_count` parts that are inserted by as many      */ \
+    /* threads in parallel. If a key is in the arrays multiple times one of the values is kept  */ \
+    /* (which one depends on the timing of the threads).                                        */ \
+    /*                                                                                          */ \
+    /* Returns `false` if the memory allocation or starting the threads failed. The table is    */ \
+    /* empty but still has to be destroyed in that case.                                        */ \
+    bool name##_build_from_arrays(struct name* table, key_t* keys, value_t* values,                \
+        size_t count, uint32_t thread_count) {                                                     \
+        if ( name##_new(table, count) == false )                                                   \
+            return false;                                                                          \
+        if (thread_count < 1)                                                                      \
+            thread_count = 1;                                                                      \
+                                                                                                   \
+        struct name##_build_part* parts = calloc(thread_count, sizeof(parts[0]));                  \
+        if (parts == NULL)                                                                         \
+            return false;                                                                          \
+                                                                                                   \
+        size_t started = 0, start = 0;                                                             \
+        bool success = true;                                                                       \
+        for(; started < thread_count; started++) {                                                 \
+            size_t end = count * (started + 1) / thread_count;                                     \
+            parts[started] = (struct name##_build_part){                                           \
+                .table = table, .keys = keys + start, .values = values + start,                    \
+                .count = end - start, .full = false                                                \
+            };                                                                                     \
+            if ( pthread_create(&parts[started].thread, NULL, name##_build_thread,                 \
+                &parts[started]) != 0 ) {                                                          \
+                success = false;                                                                   \
+                break;                                                                             \
+            }                                                                                      \
+            start = end;                                                                           \
+        }                                                                                          \
+                                                                                                   \
+        for(size_t i = 0; i < started; i++) {                                                      \
+            pthread_join(parts[i].thread, NULL);                                                   \
+            success = success && !parts[i].full;                                                   \
+        }                                                                                          \
+        free(parts);                                                                               \
+        return success;                                                                            \
+    }                                                                                              \
+
+#endif // SLIM_HASH_CONCURRENT
+
+#ifdef SLIM_HASH_MMAP
+
+// Sections of the files written by ..._save() start at multiples of this many bytes
+#define SH_FILE_ALIGNMENT     64
+// Offset of the first section, right after the header
+#define SH_FILE_DATA_OFFSET   128
+#define SH_FILE_MAX_SECTIONS  3
+// Number of items whose stored hash is compared with key_hash_expr when a file is opened
+#define SH_FILE_CHECK_ITEMS   16
+#define SH_FILE_VERSION       1
+
+/**
+ * Header of the files written by the ..._save() functions. It's followed by the sections of the
+ * hashmap (e.g. the slots), each one starting at a multiple of SH_FILE_ALIGNMENT bytes. Sections
+ * contain the raw memory of the hashmap, so a file only works on machines with the same byte order
+ * and struct layout. The hashmaps don't use a seed but the hash function and probing depend on the
+ * generated code. So the name of the hashmap is stored to identify them, along with the key, value
+ * and slot sizes.
+ */
+struct sh_file_header {
+    char     magic[8];  // "SLIMHASH"
+    char     name[32];  // Name of the hashmap, zero padded
+    uint32_t version, hash_bits;
+    uint32_t key_size, value_size, slot_size, section_count;
+    uint64_t capacity, length, deleted, file_size;
+    uint64_t section_offsets[SH_FILE_MAX_SECTIONS];
+};
+
+void sh_file_init_header(struct sh_file_header* header, const char* name, size_t key_size,
+    size_t value_size, size_t slot_size, uint32_t section_count);
+bool sh_file_save(const char* path, struct sh_file_header* header, const void** sections,
+    const size_t* section_sizes);
+const struct sh_file_header* sh_file_open(const char* path, const struct sh_file_header* expected);
+const void* sh_file_section(const struct sh_file_header* header, uint32_t index, size_t size);
+void sh_file_close(const struct sh_file_header* header);
+
+/**
+ * Returns the header of a mapped file from a pointer to its first section.
+ */
+static inline const struct sh_file_header* sh_file_header_of(const void* first_section) {
+    return (const struct sh_file_header*)((const char*)first_section - SH_FILE_DATA_OFFSET);
+}
+
+/**
+ * Internal macros that generate the prototypes and functions to save hashmaps into files and open
+ * them with mmap(). Only available if SLIM_HASH_MMAP is defined before including the library (needs
+ * POSIX), otherwise they generate nothing. `before_save_expr` is executed before a hashmap is
+ * saved, SH_GEN_INCREMENTAL_IMPL() uses it to finish a running resize.
+ */
+#define SH_GEN_MMAP_PROTOTYPES(name)                                                               \
+    bool     name##_save(struct name* hashmap, const char* path);                                  \
+    bool     name##_open_mmap(struct name* hashmap, const char* path);                             \
+    void     name##_close_mmap(struct name* hashmap);                                              \
+
+#define SH_GEN_MMAP_FUNCTIONS(name, key_t, value_t, key_hash_expr, before_save_expr)               \
+    /**                                                                                         */ \
+    /* Writes the hashmap into the file at `path` so it can be opened with name##_open_mmap()   */ \
+    /* later on, e.g. by other processes. The slots are written as they are, so this only works */ \
+    /* for keys and values without pointers (integers, floats, structs of them, ...). The file  */ \
+    /* is written to `path` with ".tmp" appended first and then renamed. Processes that still   */ \
+    /* have the old file opened keep their mapping of it.                                       */ \
+    /*                                                                                          */ \
+    /* Returns `false` if the file couldn't be written or the hashmap has no capacity.          */ \
+    bool name##_save(struct name* hashmap, const char* path) {                                     \
+        (void)(before_save_expr);                                                                  \
+        if (hashmap->capacity == 0)                                                                \
+            return false;                                                                          \
+                                                                                                   \
+        struct sh_file_header header;                                                              \
+        sh_file_init_header(&header, #name, sizeof(key_t), sizeof(value_t),                        \
+            sizeof(hashmap->slots[0]), 1);                                                         \
+        header.capacity = hashmap->capacity;                                                       \
+        header.length = hashmap->length;                                                           \
+        header.deleted = hashmap->deleted;                                                         \
+        const void* sections[1] = { hashmap->slots };                                              \
+        size_t sizes[1] = {                                                                        \
+            name##_allocation_size(hashmap->capacity) * sizeof(hashmap->slots[0]) };               \
+        return sh_file_save(path, &header, sections, sizes);                                       \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Opens a file written by name##_save() as a read-only hashmap. The file is mapped into    */ \
+    /* memory with mmap() instead of inserting its items one by one. Lookups then work right on */ \
+    /* the page cache and processes that open the same file share its memory. Only use          */ \
+    /* functions that don't change the hashmap (name##_get(), name##_get_ptr(),                 */ \
+    /* name##_contains(), iteration, ...) and close it with name##_close_mmap() instead of      */ \
+    /* name##_destroy().                                                                        */ \
+    /*                                                                                          */ \
+    /* Returns `false` if the file couldn't be opened or was written by a different hashmap     */ \
+    /* (other name, key or value size, SLIM_HASH_64BIT setting, ...). The hashes of the first   */ \
+    /* few items are also compared with key_hash_expr to catch a changed hash function.         */ \
+    /*                                                                                          */ \
+    /* key_hash_expr is executed for the stored keys. So this only works for keys without       */ \
+    /* pointers, the dictionary shorthands don't generate these functions at all.               */ \
+    bool name##_open_mmap(struct name* hashmap, const char* path) {                                \
+        struct sh_file_header expected;                                                            \
+        sh_file_init_header(&expected, #name, sizeof(key_t), sizeof(value_t),                      \
+            sizeof(hashmap->slots[0]), 1);                                                         \
+        const struct sh_file_header* header = sh_file_open(path, &expected);                       \
+        if (header == NULL)                                                                        \
+            return false;                                                                          \
+                                                                                                   \
+        *hashmap = (struct name){ 0 };                                                             \
+        hashmap->length = header->length;                                                          \
+        hashmap->capacity = header->capacity;                                                      \
+        hashmap->deleted = header->deleted;                                                        \
+        hashmap->slots = (struct name##_slot*)sh_file_section(header, 0,                           \
+            name##_allocation_size(header->capacity) * sizeof(hashmap->slots[0]));                 \
+        hashmap->max_load = SH_MAX_LOAD;                                                           \
+        hashmap->min_load = SH_MIN_LOAD;                                                           \
+        hashmap->growth_factor = SH_GROWTH_FACTOR;                                                 \
+                                                                                                   \
+        bool valid = (hashmap->slots != NULL);                                                     \
+        size_t checked = 0;                                                                        \
+        for(struct name##_slot* it = valid ? name##_start(hashmap) : NULL;                         \
+            it && checked < SH_FILE_CHECK_ITEMS; it = name##_next(hashmap, it), checked++) {       \
             key_t key = it->key;                                                                   \
             key = key;  /* avoid unused variable warning                                        */ \
-            it->key = (key_del_expr);                                                              \
-            it->hash_or_flags = SH_SLOT_DELETED;                                                   \
+            valid = valid && (((key_hash_expr) | SH_SLOT_FILLED) == it->hash_or_flags);            \
+        }                                                                                          \
                                                                                                    \
-            hashmap->length--;                                                                     \
-            hashmap->deleted++;                                                                    \
+        if (!valid) {                                                                              \
+            sh_file_close(header);                                                                 \
+            hashmap->slots = NULL;                                                                 \
+            hashmap->length = 0;                                                                   \
+            hashmap->capacity = 0;                                                                 \
+            hashmap->deleted = 0;                                                                  \
         }                                                                                          \
+        return valid;                                                                              \
     }                                                                                              \
                                                                                                    \
     /**                                                                                         */ \
-    /* Shrinks the hashmap down if it became to sparse. Returns `true` if it was shrunk,        */ \
-    /* `false` if not. This function is meant to be called after you removed many items while   */ \
-    /* iterating over the hashmap and want to make sure you don't wast to much memory.          */ \
-    /*                                                                                          */ \
-    /* Implementation detail: Other functions assume that the capacity is always > 0 or they'll */ \
-    /* crash. Therefore this function only shrinks the capacity down to a minimal value but not */ \
-    /* 0.                                                                                       */ \
-    bool name##_shrink_if_necessary(struct name* hashmap) {                                        \
-        uint32_t new_capacity = hashmap->capacity;                                                 \
-        while ( hashmap->length < new_capacity * 0.25 && new_capacity > 8 )                        \
-            new_capacity /= 2;                                                                     \
+    /* Unmaps a hashmap opened with name##_open_mmap(). The hashmap is empty afterwards and has */ \
+    /* no capacity. Use name##_new() before using it again.                                     */ \
+    void name##_close_mmap(struct name* hashmap) {                                                 \
+        if (hashmap->slots)                                                                        \
+            sh_file_close(sh_file_header_of(hashmap->slots));                                      \
+        hashmap->slots = NULL;                                                                     \
+        hashmap->length = 0;                                                                       \
+        hashmap->capacity = 0;                                                                     \
+        hashmap->deleted = 0;                                                                      \
+    }                                                                                              \
+
+#define SH_GEN_SOA_MMAP_FUNCTIONS(name, key_t, value_t, key_hash_expr)                             \
+    /**                                                                                         */ \
+    /* Writes the hashmap into the file at `path`, see name##_save() of SH_GEN_MAP_FUNCTIONS(). */ \
+    /* The hashes, keys and values are written as three sections.                               */ \
+    bool name##_save(struct name* hashmap, const char* path) {                                     \
+        if (hashmap->capacity == 0)                                                                \
+            return false;                                                                          \
                                                                                                    \
-        if (new_capacity < hashmap->capacity) {                                                    \
-            name##_resize(hashmap, new_capacity);                                                  \
-            return true;                                                                           \
+        struct sh_file_header header;                                                              \
+        sh_file_init_header(&header, #name, sizeof(key_t), sizeof(value_t), 0, 3);                 \
+        header.capacity = hashmap->capacity;                                                       \
+        header.length = hashmap->length;                                                           \
+        header.deleted = hashmap->deleted;                                                         \
+        const void* sections[3] = { hashmap->hashes, hashmap->keys, hashmap->values };             \
+        size_t sizes[3] = { hashmap->capacity * sizeof(sh_hash_t),                                 \
+            hashmap->capacity * sizeof(key_t), hashmap->capacity * sizeof(value_t) };              \
+        return sh_file_save(path, &header, sections, sizes);                                       \
+    }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Opens a file written by name##_save() as a read-only hashmap, see name##_open_mmap() of  */ \
+    /* SH_GEN_MAP_FUNCTIONS().                                                                  */ \
+    bool name##_open_mmap(struct name* hashmap, const char* path) {                                \
+        struct sh_file_header expected;                                                            \
+        sh_file_init_header(&expected, #name, sizeof(key_t), sizeof(value_t), 0, 3);               \
+        const struct sh_file_header* header = sh_file_open(path, &expected);                       \
+        if (header == NULL)                                                                        \
+            return false;                                                                          \
+                                                                                                   \
+        hashmap->length = header->length;                                                          \
+        hashmap->capacity = header->capacity;                                                      \
+        hashmap->deleted = header->deleted;                                                        \
+        hashmap->hashes = (sh_hash_t*)sh_file_section(header, 0,                                   \
+            header->capacity * sizeof(sh_hash_t));                                                 \
+        hashmap->keys = (key_t*)sh_file_section(header, 1, header->capacity * sizeof(key_t));      \
+        hashmap->values = (value_t*)sh_file_section(header, 2,                                     \
+            header->capacity * sizeof(value_t));                                                   \
+        hashmap->max_load = SH_MAX_LOAD;                                                           \
+        hashmap->min_load = SH_MIN_LOAD;                                                           \
+        hashmap->growth_factor = SH_GROWTH_FACTOR;                                                 \
+                                                                                                   \
+        bool valid = hashmap->hashes && hashmap->keys && hashmap->values;                          \
+        size_t checked = 0;                                                                        \
+        for(sh_size_t i = valid ? name##_start(hashmap) : hashmap->capacity;                       \
+            i < hashmap->capacity && checked < SH_FILE_CHECK_ITEMS;                                \
+            i = name##_next(hashmap, i), checked++) {                                              \
+            key_t key = hashmap->keys[i];                                                          \
+            key = key;  /* avoid unused variable warning                                        */ \
+            valid = valid && (((key_hash_expr) | SH_SLOT_FILLED) == hashmap->hashes[i]);           \
         }                                                                                          \
                                                                                                    \
-        return false;                                                                              \
+        if (!valid) {                                                                              \
+            sh_file_close(header);                                                                 \
+            hashmap->hashes = NULL;                                                                \
+            hashmap->keys = NULL;                                                                  \
+            hashmap->values = NULL;                                                                \
+            hashmap->length = 0;                                                                   \
+            hashmap->capacity = 0;                                                                 \
+            hashmap->deleted = 0;                                                                  \
+        }                                                                                          \
+        return valid;                                                                              \
     }                                                                                              \
+                                                                                                   \
+    /**                                                                                         */ \
+    /* Unmaps a hashmap opened with name##_open_mmap(), see name##_close_mmap() of              */ \
+    /* SH_GEN_MAP_FUNCTIONS().                                                                  */ \
+    void name##_close_mmap(struct name* hashmap) {                                                 \
+        if (hashmap->hashes)                                                                       \
+            sh_file_close(sh_file_header_of(hashmap->hashes));                                     \
+        hashmap->hashes = NULL;                                                                    \
+        hashmap->keys = NULL;                                                                      \
+        hashmap->values = NULL;                                                                    \
+        hashmap->length = 0;                                                                       \
+        hashmap->capacity = 0;                                                                     \
+        hashmap->deleted = 0;                                                                      \
+    }                                                                                              \
+
+#else
+
+#define SH_GEN_MMAP_PROTOTYPES(name)
+#define SH_GEN_MMAP_FUNCTIONS(name, key_t, value_t, key_hash_expr, before_save_expr)
+#define SH_GEN_SOA_MMAP_FUNCTIONS(name, key_t, value_t, key_hash_expr)
+
+#endif // SLIM_HASH_MMAP
+
+/**
+ * Generates nothing. Passed as `mmap_gen` to SH_GEN_MAP_FUNCTIONS() and friends for keys that
+ * contain pointers. Saving those keys into a file makes no sense and name##_open_mmap() would
+ * follow the stale pointers in the file to check the hashes.
+ */
+#define SH_GEN_NO_MMAP_FUNCTIONS(...)
 
 #if _SVID_SOURCE || _BSD_SOURCE || _XOPEN_SOURCE >= 500 || _XOPEN_SOURCE && _XOPEN_SOURCE_EXTENDED || _POSIX_C_SOURCE >= 200809L
 #define sh_strdup strdup
@@ -738,8 +5213,10 @@ uint32_t sh_murmur3(const void* key, int size, uint32_t seed) {
     switch(size & 3) {
         case 3:
             k1 ^= tail[2] << 16;
+            // fall through
         case 2:
             k1 ^= tail[1] << 8;
+            // fall through
         case 1:
             k1 ^= tail[0];
             k1 *= c1;
@@ -773,13 +5250,243 @@ uint32_t sh_murmur3(const void* key, int size, uint32_t seed) {
  */
 uint32_t sh_fnv1a(const char* key) {
     uint32_t hash = 2166136261;
-    for(uint8_t c = *key; c != '\0'; c++) {
-        hash ^= c;
+    for(const uint8_t* c = (const uint8_t*)key; *c != '\0'; c++) {
+        hash ^= *c;
         hash *= 16777619;
     }
     return hash;
 }
 
+// Helpers for the 64 bit hash functions. Reads are done in the byte order of the machine (like in
+// sh_murmur3()), so the hashes differ between little and big endian machines.
+static inline uint64_t sh_read64(const uint8_t* p) {
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t sh_read32(const uint8_t* p) {
+    uint32_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+// Multiplies a and b to a 128 bit result. The lower 64 bits end up in a, the upper 64 bits in b.
+static inline void sh_mul128(uint64_t* a, uint64_t* b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t result = (__uint128_t)*a * *b;
+    *a = (uint64_t)result;
+    *b = (uint64_t)(result >> 64);
+#else
+    uint64_t a_lo = (uint32_t)*a, a_hi = *a >> 32, b_lo = (uint32_t)*b, b_hi = *b >> 32;
+    uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo, lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+    uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+    *a = (cross << 32) | (uint32_t)lo_lo;
+    *b = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+#endif
+}
+
+// Multiplies a and b to a 128 bit result and folds it back to 64 bits with an xor.
+static inline uint64_t sh_mix64(uint64_t a, uint64_t b) {
+    sh_mul128(&a, &b);
+    return a ^ b;
+}
+
+/**
+ * Calculate a 64 bit hash of a memory block in the style of wyhash (final version 4) by Wang Yi.
+ * Short keys are read with a few overlapping loads, longer keys in 16 or 48 byte steps, each mixed
+ * with a 64x64 -> 128 bit multiplication. This makes it a lot faster than sh_murmur3() for all but
+ * the smallest keys and it passes the SMHasher quality tests. Well suited for strings and for keys
+ * up to a few hundred bytes.
+ * 
+ * The hashmaps just use the lower 32 bits of the hash, e.g. sh_wyhash(key, strlen(key), 0) as
+ * key_hash_expr. See sh_murmur3() for what the seed is good for.
+ * 
+ * It uses the same algorithm and default secret as wyhash and on little endian machines produces
+ * the same hashes as the reference implementation. See https://github.com/wangyi-fudan/wyhash
+ */
+uint64_t sh_wyhash(const void* key, size_t size, uint64_t seed) {
+    static const uint64_t secret[4] = {
+        0x2d358dccaa6c78a5, 0x8bb84b93962eacc9, 0x4b33a62ed433d4a3, 0x4d5a2da51de1aa47
+    };
+    const uint8_t* p = (const uint8_t*)key;
+    uint64_t a, b;
+    
+    seed ^= sh_mix64(seed ^ secret[0], secret[1]);
+    if (size <= 16) {
+        if (size >= 4) {
+            size_t offset = (size >> 3) << 2;
+            a = (sh_read32(p) << 32) | sh_read32(p + offset);
+            b = (sh_read32(p + size - 4) << 32) | sh_read32(p + size - 4 - offset);
+        } else if (size > 0) {
+            a = ((uint64_t)p[0] << 16) | ((uint64_t)p[size >> 1] << 8) | p[size - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t remaining = size;
+        if (remaining > 48) {
+            uint64_t seed1 = seed, seed2 = seed;
+            do {
+                seed = sh_mix64(sh_read64(p) ^ secret[1], sh_read64(p + 8) ^ seed);
+                seed1 = sh_mix64(sh_read64(p + 16) ^ secret[2], sh_read64(p + 24) ^ seed1);
+                seed2 = sh_mix64(sh_read64(p + 32) ^ secret[3], sh_read64(p + 40) ^ seed2);
+                p += 48;
+                remaining -= 48;
+            } while (remaining > 48);
+            seed ^= seed1 ^ seed2;
+        }
+        
+        while (remaining > 16) {
+            seed = sh_mix64(sh_read64(p) ^ secret[1], sh_read64(p + 8) ^ seed);
+            p += 16;
+            remaining -= 16;
+        }
+        
+        a = sh_read64(p + remaining - 16);
+        b = sh_read64(p + remaining - 8);
+    }
+    
+    a ^= secret[1];
+    b ^= seed;
+    sh_mul128(&a, &b);
+    return sh_mix64(a ^ secret[0] ^ size, b ^ secret[1]);
+}
+
+// Adds `stripes` 64 byte stripes of input to the 8 accumulators of sh_xxhash(). Each accumulator
+// gets the product of the lower and upper 32 bits of (input ^ secret) and the input of its neighbor
+// lane. The secret is shifted by 8 bytes for each stripe. The SIMD variants keep the accumulators
+// in registers while processing the stripes.
+#if defined(__AVX2__)
+static inline __m256i sh_xxhash_accumulate_256(__m256i acc, const uint8_t* input,
+    const uint64_t* secret) {
+    __m256i data = _mm256_loadu_si256((const __m256i*)input);
+    __m256i key = _mm256_xor_si256(data, _mm256_loadu_si256((const __m256i*)secret));
+    __m256i product = _mm256_mul_epu32(key, _mm256_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+    __m256i swapped = _mm256_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+    return _mm256_add_epi64(_mm256_add_epi64(acc, swapped), product);
+}
+
+static inline void sh_xxhash_accumulate(uint64_t* acc, const uint8_t* input,
+    const uint64_t* secret, size_t stripes) {
+    __m256i acc0 = _mm256_loadu_si256((const __m256i*)acc);
+    __m256i acc1 = _mm256_loadu_si256((const __m256i*)(acc + 4));
+    for(size_t n = 0; n < stripes; n++) {
+        acc0 = sh_xxhash_accumulate_256(acc0, input + n * 64, secret + n);
+        acc1 = sh_xxhash_accumulate_256(acc1, input + n * 64 + 32, secret + n + 4);
+    }
+    _mm256_storeu_si256((__m256i*)acc, acc0);
+    _mm256_storeu_si256((__m256i*)(acc + 4), acc1);
+}
+#elif defined(__SSE2__)
+static inline __m128i sh_xxhash_accumulate_128(__m128i acc, const uint8_t* input,
+    const uint64_t* secret) {
+    __m128i data = _mm_loadu_si128((const __m128i*)input);
+    __m128i key = _mm_xor_si128(data, _mm_loadu_si128((const __m128i*)secret));
+    __m128i product = _mm_mul_epu32(key, _mm_shuffle_epi32(key, _MM_SHUFFLE(0, 3, 0, 1)));
+    __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+    return _mm_add_epi64(_mm_add_epi64(acc, swapped), product);
+}
+
+static inline void sh_xxhash_accumulate(uint64_t* acc, const uint8_t* input,
+    const uint64_t* secret, size_t stripes) {
+    __m128i acc0 = _mm_loadu_si128((const __m128i*)acc);
+    __m128i acc1 = _mm_loadu_si128((const __m128i*)(acc + 2));
+    __m128i acc2 = _mm_loadu_si128((const __m128i*)(acc + 4));
+    __m128i acc3 = _mm_loadu_si128((const __m128i*)(acc + 6));
+    for(size_t n = 0; n < stripes; n++) {
+        acc0 = sh_xxhash_accumulate_128(acc0, input + n * 64, secret + n);
+        acc1 = sh_xxhash_accumulate_128(acc1, input + n * 64 + 16, secret + n + 2);
+        acc2 = sh_xxhash_accumulate_128(acc2, input + n * 64 + 32, secret + n + 4);
+        acc3 = sh_xxhash_accumulate_128(acc3, input + n * 64 + 48, secret + n + 6);
+    }
+    _mm_storeu_si128((__m128i*)acc, acc0);
+    _mm_storeu_si128((__m128i*)(acc + 2), acc1);
+    _mm_storeu_si128((__m128i*)(acc + 4), acc2);
+    _mm_storeu_si128((__m128i*)(acc + 6), acc3);
+}
+#else
+static inline void sh_xxhash_accumulate(uint64_t* acc, const uint8_t* input,
+    const uint64_t* secret, size_t stripes) {
+    for(size_t n = 0; n < stripes; n++) {
+        for(size_t i = 0; i < 8; i++) {
+            uint64_t data = sh_read64(input + n * 64 + i * 8);
+            uint64_t key = data ^ secret[n + i];
+            acc[i ^ 1] += data;
+            acc[i] += (key & 0xffffffff) * (key >> 32);
+        }
+    }
+}
+#endif
+
+// Scrambles the accumulators of sh_xxhash() after each block of 16 stripes so that the upper bits
+// of the accumulators feed back into the lower ones.
+static inline void sh_xxhash_scramble(uint64_t* acc, const uint64_t* secret) {
+    for(size_t i = 0; i < 8; i++) {
+        uint64_t value = acc[i];
+        value ^= value >> 47;
+        value ^= secret[i];
+        acc[i] = value * 0x9e3779b1;
+    }
+}
+
+/**
+ * Calculate a 64 bit hash of a memory block in the style of XXH3 by Yann Collet. Keys with up to
+ * 128 bytes are hashed with sh_wyhash(). Longer keys are processed in 64 byte stripes by 8
+ * independent accumulators, using AVX2 or SSE2 if available. Use it for long keys (e.g. file
+ * contents or large structs), there it's several times faster than sh_murmur3(). With AVX2 it's
+ * also faster than sh_wyhash() for keys above about 1 KiB, without it sh_wyhash() is faster.
+ * 
+ * The structure (stripes, accumulators, scrambling and the final merge) follows XXH3 but the secret
+ * is different and the results are NOT compatible with the official XXH3 implementation. See
+ * https://github.com/Cyan4973/xxHash for the original.
+ */
+uint64_t sh_xxhash(const void* key, size_t size, uint64_t seed) {
+    static const uint64_t default_secret[24] = {
+        0x3ebee68310b5c160, 0x0cf1d4b63a6861f5, 0xc01ea30577030583, 0xc5d0beaa16fa28d3,
+        0x8d2ba1717de3596d, 0x21117782087b4d71, 0x1f0bcfd0e73eb18b, 0x36f6e413ea151595,
+        0xf840302de8c28b71, 0x1298614257b2f215, 0xab0737ee23bb7583, 0xf2bab2308a7eeeb0,
+        0x21c7fe1ad606b050, 0x576ea34a762d3949, 0x6808914bc1d4b714, 0x76c3476611a760d2,
+        0x59bb5a0c6e5a8768, 0xb85e33026af88f0c, 0x12552830cfbab3f6, 0x29789017ea4f6cfa,
+        0x3bf3c115fe2fc3a6, 0x9e5aa2cbf3360c50, 0x8bf7078a754950b2, 0x4e7f36f3b5430aba
+    };
+    if (size <= 128)
+        return sh_wyhash(key, size, seed);
+    
+    // Derive a secret for the seed like XXH3 does: add the seed to the even and subtract it from
+    // the odd secret values.
+    uint64_t secret[24];
+    for(size_t i = 0; i < 24; i++)
+        secret[i] = (i & 1) ? default_secret[i] - seed : default_secret[i] + seed;
+    
+    uint64_t acc[8] = {
+        0x00000000c2b2ae3d, 0x9e3779b185ebca87, 0xc2b2ae3d27d4eb4f, 0x165667b19e3779f9,
+        0x85ebca77c2b2ae63, 0x0000000085ebca77, 0x27d4eb2f165667c5, 0x000000009e3779b1
+    };
+    
+    // Blocks of 16 stripes with a scramble after each block, then the remaining full stripes
+    // except the last one. The last 64 bytes are always processed separately (overlapping with the
+    // previous stripe if the size isn't a multiple of 64).
+    const uint8_t* p = (const uint8_t*)key;
+    size_t stripes = (size - 1) / 64;
+    for(; stripes >= 16; stripes -= 16, p += 16 * 64) {
+        sh_xxhash_accumulate(acc, p, secret, 16);
+        sh_xxhash_scramble(acc, secret + 16);
+    }
+    sh_xxhash_accumulate(acc, p, secret, stripes);
+    sh_xxhash_accumulate(acc, (const uint8_t*)key + size - 64, secret + 15, 1);
+    
+    uint64_t hash = size * 0x9e3779b185ebca87;
+    for(size_t i = 0; i < 8; i += 2)
+        hash += sh_mix64(acc[i] ^ secret[i + 1], acc[i + 1] ^ secret[i + 2]);
+    
+    hash ^= hash >> 37;
+    hash *= 0x165667919e3779f9;
+    hash ^= hash >> 32;
+    return hash;
+}
+
 /**
  * Portable version of strdup() that doesn't require feature test macros to be set. But if we got a
  * POSIX strdup() use it.
@@ -796,5 +5503,312 @@ char* sh_strdup(const char* src) {
 }
 #endif
 
+/**
+ * Copies the `length` bytes of `str` into newly allocated memory and zero terminates the copy. This
+ * is the key_put_expr of SH_GEN_STR_DICT_IMPL(). Returns a string with a NULL ptr if the allocation
+ * failed. Free the copy with free((void*)copy.ptr).
+ */
+struct sh_str sh_str_dup(struct sh_str str) {
+    char* copy = malloc(str.length + 1);
+    if (copy == NULL)
+        return sh_str_n(NULL, 0);
+    if (str.length > 0)
+        memcpy(copy, str.ptr, str.length);
+    copy[str.length] = '\0';
+    return sh_str_n(copy, str.length);
+}
+
+/**
+ * Copies the string of a long small-string key onto the heap, short keys are returned unchanged.
+ * This is the key_put_expr of SH_GEN_SSO_DICT_IMPL(). The string pointer of the returned key is
+ * NULL if the allocation failed.
+ */
+struct sh_sso sh_sso_dup(struct sh_sso key) {
+    if ( !sh_sso_is_long(&key) )
+        return key;
+    char* copy = sh_strdup(sh_sso_chars(&key));
+    memcpy(key.bytes, &copy, sizeof(copy));
+    return key;
+}
+
+/**
+ * Frees the string of a long small-string key that was duplicated by sh_sso_dup(). Does nothing
+ * for short keys.
+ */
+void sh_sso_free(struct sh_sso key) {
+    if ( sh_sso_is_long(&key) )
+        free((void*)sh_sso_chars(&key));
+}
+
+/**
+ * Allocates `size` bytes from an arena. The memory comes from the newest chunk of the arena if it
+ * has enough space left. Otherwise a new chunk with SH_ARENA_CHUNK_SIZE bytes (or `size` bytes if
+ * that is larger) is allocated first. An arena is just a pointer to its newest chunk, initialize it
+ * with NULL. Returns NULL if the allocation failed.
+ */
+void* sh_arena_alloc(struct sh_arena_chunk** arena, size_t size) {
+    struct sh_arena_chunk* chunk = *arena;
+    if (chunk == NULL || chunk->size - chunk->used < size) {
+        size_t chunk_size = (size > SH_ARENA_CHUNK_SIZE) ? size : SH_ARENA_CHUNK_SIZE;
+        chunk = malloc(sizeof(struct sh_arena_chunk) + chunk_size);
+        if (chunk == NULL)
+            return NULL;
+        chunk->next = *arena;
+        chunk->used = 0;
+        chunk->size = chunk_size;
+        *arena = chunk;
+    }
+    
+    void* ptr = chunk->data + chunk->used;
+    chunk->used += size;
+    return ptr;
+}
+
+/**
+ * Copies a zero terminated string into an arena. This is the key_put_expr of
+ * SH_GEN_ARENA_DICT_IMPL(). Returns NULL if the allocation failed.
+ */
+char* sh_arena_strdup(struct sh_arena_chunk** arena, const char* str) {
+    size_t size = strlen(str) + 1;
+    char* copy = sh_arena_alloc(arena, size);
+    if (copy == NULL)
+        return NULL;
+    memcpy(copy, str, size);
+    return copy;
+}
+
+/**
+ * Frees all chunks of an arena and sets it to NULL. Does nothing for an empty (NULL) arena.
+ */
+void sh_arena_free(struct sh_arena_chunk** arena) {
+    struct sh_arena_chunk* chunk = *arena;
+    while (chunk) {
+        struct sh_arena_chunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    *arena = NULL;
+}
+
+/**
+ * Builds the minimal perfect hash function of a frozen table for `length` 64 bit hashes. Each hash
+ * belongs to one of `bucket_count` buckets (by sh_range()). Starting with the largest bucket a
+ * pilot is searched for each bucket that puts all its hashes on positions that are still free (see
+ * sh_perfect_hash_position()). Stores the pilot of each bucket in `pilots` and the position of each
+ * hash in `positions`. Returns `false` if two hashes are equal or a memory allocation failed.
+ */
+bool sh_perfect_hash_build(const uint64_t* hashes, size_t length, size_t bucket_count,
+    uint32_t* pilots, size_t* positions) {
+    size_t* bucket_starts = calloc(bucket_count + 1, sizeof(size_t));
+    size_t* bucket_fill = calloc(bucket_count, sizeof(size_t));
+    size_t* bucket_keys = malloc(length * sizeof(size_t));
+    size_t* order = malloc(bucket_count * sizeof(size_t));
+    uint8_t* taken = calloc(length, 1);
+    size_t* size_starts = NULL;
+    bool success = bucket_starts && bucket_fill && bucket_keys && order && taken;
+    
+    // Group the keys by bucket: Count the keys of each bucket, then sort them into the buckets
+    size_t max_bucket_size = 0;
+    if (success) {
+        for(size_t i = 0; i < length; i++)
+            bucket_starts[sh_range(hashes[i], bucket_count) + 1]++;
+        for(size_t b = 0; b < bucket_count; b++) {
+            if (bucket_starts[b + 1] > max_bucket_size)
+                max_bucket_size = bucket_starts[b + 1];
+            bucket_starts[b + 1] += bucket_starts[b];
+        }
+        for(size_t i = 0; i < length; i++) {
+            size_t b = sh_range(hashes[i], bucket_count);
+            bucket_keys[bucket_starts[b] + bucket_fill[b]++] = i;
+        }
+        
+        // Sort the buckets by their size, largest first (also a counting sort)
+        size_starts = calloc(max_bucket_size + 2, sizeof(size_t));
+        success = (size_starts != NULL);
+    }
+    if (success) {
+        for(size_t b = 0; b < bucket_count; b++)
+            size_starts[max_bucket_size - bucket_fill[b] + 1]++;
+        for(size_t s = 0; s <= max_bucket_size; s++)
+            size_starts[s + 1] += size_starts[s];
+        for(size_t b = 0; b < bucket_count; b++)
+            order[size_starts[max_bucket_size - bucket_fill[b]]++] = b;
+    }
+    
+    // The last buckets have to find one of a few free positions. That takes about `length` tries
+    // for the very last one, so there's no need to give up early.
+    uint64_t max_tries = (uint64_t)length * 100 + 1000;
+    if (max_tries > UINT32_MAX)
+        max_tries = UINT32_MAX;
+    
+    for(size_t o = 0; success && o < bucket_count; o++) {
+        size_t b = order[o], size = bucket_fill[b];
+        const size_t* keys = bucket_keys + bucket_starts[b];
+        pilots[b] = 0;
+        if (size == 0)
+            continue;
+        
+        // Keys with the same hash would always end up in the same position
+        for(size_t i = 0; i < size; i++) {
+            for(size_t j = i + 1; j < size; j++)
+                success = success && hashes[keys[i]] != hashes[keys[j]];
+        }
+        
+        bool found = false;
+        for(uint64_t pilot = 0; success && !found && pilot < max_tries; pilot++) {
+            found = true;
+            for(size_t i = 0; found && i < size; i++) {
+                size_t position = sh_perfect_hash_position(hashes[keys[i]], pilot, length);
+                positions[keys[i]] = position;
+                found = !taken[position];
+                for(size_t j = 0; found && j < i; j++)
+                    found = positions[keys[j]] != position;
+            }
+            if (found) {
+                pilots[b] = pilot;
+                for(size_t i = 0; i < size; i++)
+                    taken[positions[keys[i]]] = 1;
+            }
+        }
+        success = success && found;
+    }
+    
+    free(bucket_starts);
+    free(bucket_fill);
+    free(bucket_keys);
+    free(order);
+    free(taken);
+    free(size_starts);
+    return success;
+}
+
+#ifdef SLIM_HASH_MMAP
+
+/**
+ * Fills the fields of a file header that identify the hashmap. The ..._save() functions use it to
+ * write the header, ..._open_mmap() to create the header it expects.
+ */
+void sh_file_init_header(struct sh_file_header* header, const char* name, size_t key_size,
+    size_t value_size, size_t slot_size, uint32_t section_count) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, "SLIMHASH", sizeof(header->magic));
+    strncpy(header->name, name, sizeof(header->name) - 1);
+    header->version = SH_FILE_VERSION;
+    header->hash_bits = SH_HASH_BITS;
+    header->key_size = key_size;
+    header->value_size = value_size;
+    header->slot_size = slot_size;
+    header->section_count = section_count;
+}
+
+/**
+ * Writes the header and `header->section_count` sections into the file at `path`. Fills in the
+ * section offsets and the file size of the header. The file is written to `path` with ".tmp"
+ * appended and then renamed, so a file that is mapped by other processes is never changed.
+ * Returns `false` if something went wrong, the temporary file is removed in that case.
+ */
+bool sh_file_save(const char* path, struct sh_file_header* header, const void** sections,
+    const size_t* section_sizes) {
+    // Each section is padded to the next multiple of SH_FILE_ALIGNMENT (a power of two)
+    size_t paddings[SH_FILE_MAX_SECTIONS];
+    uint64_t offset = SH_FILE_DATA_OFFSET;
+    for(uint32_t i = 0; i < header->section_count; i++) {
+        paddings[i] = -section_sizes[i] & (SH_FILE_ALIGNMENT - 1);
+        header->section_offsets[i] = offset;
+        offset += section_sizes[i] + paddings[i];
+    }
+    header->file_size = offset;
+    
+    char* tmp_path = malloc(strlen(path) + 5);
+    if (tmp_path == NULL)
+        return false;
+    strcpy(tmp_path, path);
+    strcat(tmp_path, ".tmp");
+    
+    FILE* file = fopen(tmp_path, "wb");
+    bool success = (file != NULL);
+    if (success) {
+        static const char zeros[SH_FILE_DATA_OFFSET] = { 0 };
+        success = fwrite(header, sizeof(*header), 1, file) == 1
+            && fwrite(zeros, SH_FILE_DATA_OFFSET - sizeof(*header), 1, file) == 1;
+        for(uint32_t i = 0; success && i < header->section_count; i++) {
+            success = fwrite(sections[i], 1, section_sizes[i], file) == section_sizes[i]
+                && fwrite(zeros, 1, paddings[i], file) == paddings[i];
+        }
+        success = (fclose(file) == 0) && success;
+        success = success && rename(tmp_path, path) == 0;
+        if (!success)
+            remove(tmp_path);
+    }
+    
+    free(tmp_path);
+    return success;
+}
+
+/**
+ * Maps the file at `path` into memory (read-only) and returns its header. Returns NULL if the file
+ * couldn't be mapped or its header doesn't match the `expected` one (magic, version, name, sizes
+ * and section count). The section offsets and the file size are checked as well.
+ */
+const struct sh_file_header* sh_file_open(const char* path, const struct sh_file_header* expected) {
+    int fd = open(path, O_RDONLY);
+    if (fd == -1)
+        return NULL;
+    struct stat info;
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && (size_t)info.st_size >= SH_FILE_DATA_OFFSET)
+        mapping = mmap(NULL, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping stays valid after the file is closed
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return NULL;
+    
+    const struct sh_file_header* header = mapping;
+    bool valid = memcmp(header->magic, expected->magic, sizeof(header->magic)) == 0
+        && memcmp(header->name, expected->name, sizeof(header->name)) == 0
+        && header->version == expected->version && header->hash_bits == expected->hash_bits
+        && header->key_size == expected->key_size && header->value_size == expected->value_size
+        && header->slot_size == expected->slot_size
+        && header->section_count == expected->section_count
+        && header->file_size == (uint64_t)info.st_size
+        && header->capacity > 0 && (header->capacity & (header->capacity - 1)) == 0
+        && header->capacity <= SH_MAX_CAPACITY && header->length < header->capacity;
+    for(uint32_t i = 0; valid && i < header->section_count; i++) {
+        valid = header->section_offsets[i] % SH_FILE_ALIGNMENT == 0
+            && header->section_offsets[i] >= SH_FILE_DATA_OFFSET
+            && header->section_offsets[i] <= header->file_size;
+    }
+    valid = valid && header->section_offsets[0] == SH_FILE_DATA_OFFSET;
+    
+    if (!valid) {
+        munmap(mapping, info.st_size);
+        return NULL;
+    }
+    return header;
+}
+
+/**
+ * Returns a pointer to a section of a mapped file or NULL if the section isn't `size` bytes large
+ * (it would extend beyond the next section or the end of the file).
+ */
+const void* sh_file_section(const struct sh_file_header* header, uint32_t index, size_t size) {
+    if (index >= header->section_count)
+        return NULL;
+    uint64_t end = (index + 1 < header->section_count) ? header->section_offsets[index + 1]
+        : header->file_size;
+    if (end < header->section_offsets[index] || end - header->section_offsets[index] < size)
+        return NULL;
+    return (const char*)header + header->section_offsets[index];
+}
+
+/**
+ * Unmaps a file mapped by sh_file_open().
+ */
+void sh_file_close(const struct sh_file_header* header) {
+    munmap((void*)header, header->file_size);
+}
+
+#endif // SLIM_HASH_MMAP
+
 
 #endif // SLIM_HASH_IMPLEMENTATION
\ No newline at end of file
@@ -0,0 +1,198 @@
+#define SDT_DEAD_RECKONING_IMPLEMENTATION
+#include "../sdt_dead_reckoning.h"
+#define SLIM_TEST_IMPLEMENTATION
+#include "../slim_test.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+
+
+// A 32x32 mask with a filled square from 10..21 (inclusive) in both directions
+uint8_t* square_mask(uint8_t value) {
+	uint8_t* mask = calloc(32 * 32, 1);
+	for(int y = 10; y <= 21; y++) {
+		for(int x = 10; x <= 21; x++)
+			mask[x + y * 32] = value;
+	}
+	return mask;
+}
+
+// A 32x32 coverage mask with the left side covered up to the vertical edge at x = edge (pixel centers are at integer
+// coordinates)
+uint8_t* half_plane_mask(float edge) {
+	uint8_t* mask = calloc(32 * 32, 1);
+	for(int y = 0; y < 32; y++) {
+		for(int x = 0; x < 32; x++) {
+			float coverage = fmaxf(0, fminf(1, edge - (x - 0.5f)));
+			mask[x + y * 32] = roundf(coverage * 255);
+		}
+	}
+	return mask;
+}
+
+
+void test_square() {
+	uint8_t* mask = square_mask(255);
+	float* df = malloc(32 * 32 * sizeof(df[0]));
+	sdt_dead_reckoning(32, 32, 127, mask, df);
+	
+	// Border pixels of the inside are 0, outside pixels positive, inside pixels negative
+	st_check_float(df[10 + 16 * 32], 0.0f, 0.001f);
+	st_check_float(df[5 + 16 * 32], 5.0f, 0.001f);
+	st_check_float(df[26 + 16 * 32], 5.0f, 0.001f);
+	st_check_float(df[13 + 16 * 32], -3.0f, 0.001f);
+	st_check_float(df[5 + 5 * 32], sqrtf(2 * 5*5), 0.001f);
+	
+	free(df);
+	free(mask);
+}
+
+void test_aa_sub_pixel_edge() {
+	uint8_t* mask = half_plane_mask(10.3f);
+	float* df = malloc(32 * 32 * sizeof(df[0]));
+	sdt_dead_reckoning_aa(32, 32, mask, df);
+	
+	st_check_float(df[20 + 16 * 32], 20 - 10.3f, 0.05f);
+	st_check_float(df[11 + 16 * 32], 11 - 10.3f, 0.05f);
+	st_check_float(df[10 + 16 * 32], 10 - 10.3f, 0.05f);
+	st_check_float(df[5 + 16 * 32], 5 - 10.3f, 0.05f);
+	
+	free(df);
+	free(mask);
+}
+
+void test_aa_hard_edge() {
+	// Without anti-aliasing the outline is placed half way between the inside and outside pixels
+	uint8_t* mask = square_mask(255);
+	float* df = malloc(32 * 32 * sizeof(df[0]));
+	sdt_dead_reckoning_aa(32, 32, mask, df);
+	
+	st_check_float(df[10 + 16 * 32], -0.5f, 0.001f);
+	st_check_float(df[9 + 16 * 32], 0.5f, 0.001f);
+	st_check_float(df[5 + 16 * 32], 4.5f, 0.001f);
+	st_check_float(df[13 + 16 * 32], -3.5f, 0.001f);
+	
+	free(df);
+	free(mask);
+}
+
+void test_f32_iso_contour() {
+	// Linear ramp that crosses the threshold of 0 at x = 10.3
+	float* image = malloc(32 * 32 * sizeof(image[0]));
+	for(int n = 0; n < 32 * 32; n++)
+		image[n] = 10.3f - (n % 32);
+	float* df = malloc(32 * 32 * sizeof(df[0]));
+	sdt_dead_reckoning_f32(32, 32, 0.0f, image, df);
+	
+	st_check_float(df[20 + 16 * 32], 20 - 10.3f, 0.001f);
+	st_check_float(df[11 + 16 * 32], 11 - 10.3f, 0.001f);
+	st_check_float(df[10 + 16 * 32], 10 - 10.3f, 0.001f);
+	st_check_float(df[0 + 16 * 32], 0 - 10.3f, 0.001f);
+	
+	// A cone with its iso-contour at radius 8 around 15.5, 15.5
+	for(int y = 0; y < 32; y++) {
+		for(int x = 0; x < 32; x++)
+			image[x + y * 32] = 8 - sqrtf((x - 15.5f)*(x - 15.5f) + (y - 15.5f)*(y - 15.5f));
+	}
+	sdt_dead_reckoning_f32(32, 32, 0.0f, image, df);
+	for(int y = 0; y < 32; y++) {
+		for(int x = 0; x < 32; x++)
+			st_check_float(df[x + y * 32], -image[x + y * 32], 0.1f);
+	}
+	
+	free(df);
+	free(image);
+}
+
+void test_u16_iso_contour() {
+	uint16_t* image = malloc(32 * 32 * sizeof(image[0]));
+	for(int n = 0; n < 32 * 32; n++)
+		image[n] = 20000 + 1000 * (10.3f - (n % 32));
+	float* df = malloc(32 * 32 * sizeof(df[0]));
+	sdt_dead_reckoning_u16(32, 32, 20000, image, df);
+	
+	st_check_float(df[20 + 16 * 32], 20 - 10.3f, 0.001f);
+	st_check_float(df[10 + 16 * 32], 10 - 10.3f, 0.001f);
+	
+	free(df);
+	free(image);
+}
+
+void test_multi() {
+	// Noise mask with values 0..255 and a brighter square
+	uint8_t* image = malloc(48 * 40);
+	srand(7);
+	for(int n = 0; n < 48 * 40; n++)
+		image[n] = rand() % 256;
+	for(int y = 10; y < 30; y++) {
+		for(int x = 10; x < 35; x++)
+			image[x + y * 48] = 200 + (x + y) % 56;
+	}
+	
+	// Each distance field has to be exactly the same as the one created by sdt_dead_reckoning()
+	uint8_t thresholds[3] = { 16, 127, 210 };
+	float* fields = malloc(3 * 48 * 40 * sizeof(fields[0]));
+	float* single = malloc(48 * 40 * sizeof(single[0]));
+	sdt_dead_reckoning_multi(48, 40, 3, thresholds, image, fields);
+	for(int l = 0; l < 3; l++) {
+		sdt_dead_reckoning(48, 40, thresholds[l], image, single);
+		st_check(memcmp(fields + l * 48 * 40, single, 48 * 40 * sizeof(single[0])) == 0);
+	}
+	
+	free(single);
+	free(fields);
+	free(image);
+}
+
+void test_text_effects() {
+	uint8_t* mask = calloc(64 * 64, 1);
+	for(int y = 20; y <= 43; y++) {
+		for(int x = 20; x <= 43; x++)
+			mask[x + y * 64] = 255;
+	}
+	uint8_t* rgba = malloc(64 * 64 * 4);
+	#define PIXEL(x, y) (rgba + ((x) + (y) * 64) * 4)
+	
+	struct sdt_text_effect effect = {
+		.fill_color = { 255, 255, 255, 255 },
+		.outline_color = { 0, 0, 255, 255 }, .outline_width = 2,
+		.shadow_color = { 0, 0, 0, 255 }, .shadow_offset_x = 4, .shadow_offset_y = 4, .shadow_sigma = 0
+	};
+	sdt_text_effects(64, 64, mask, &effect, rgba);
+	
+	// Fill in the center, outline around it, shadow below right and nothing far away from the glyph
+	st_check_int(PIXEL(32, 32)[0], 255);
+	st_check_int(PIXEL(32, 32)[3], 255);
+	st_check_int(PIXEL(18, 32)[0], 0);
+	st_check_int(PIXEL(18, 32)[2], 255);
+	st_check_int(PIXEL(18, 32)[3], 255);
+	st_check_int(PIXEL(47, 47)[2], 0);
+	st_check_int(PIXEL(47, 47)[3], 255);
+	st_check_int(PIXEL(5, 5)[3], 0);
+	st_check_int(PIXEL(60, 10)[3], 0);
+	
+	// A glow is a gauss blur of the outlined glyph. 10px left of the glyph that is 7.5px away from the outline.
+	struct sdt_text_effect glow = {
+		.glow_color = { 255, 255, 255, 255 }, .glow_sigma = 5, .outline_width = 2
+	};
+	sdt_text_effects(64, 64, mask, &glow, rgba);
+	st_check_float(PIXEL(10, 32)[3] / 255.0f, 0.5f * erfcf(7.5f / (5 * sqrtf(2))), 0.01f);
+	st_check(PIXEL(32, 32)[3] > 250);
+	st_check_int(PIXEL(0, 0)[3], 0);
+	
+	#undef PIXEL
+	free(rgba);
+	free(mask);
+}
+
+
+int main() {
+	st_run(test_square);
+	st_run(test_aa_sub_pixel_edge);
+	st_run(test_aa_hard_edge);
+	st_run(test_f32_iso_contour);
+	st_run(test_u16_iso_contour);
+	st_run(test_multi);
+	st_run(test_text_effects);
+	return st_show_report();
+}
@@ -0,0 +1,183 @@
+#define SLIM_HASH_64BIT
+#define SLIM_HASH_IMPLEMENTATION
+#include "../slim_hash.h"
+#define SLIM_TEST_IMPLEMENTATION
+#include "../slim_test.h"
+
+
+SH_GEN_DECL(sh, int64_t, int);
+SH_GEN_HASH_IMPL(sh, int64_t, int);
+
+SH_GEN_DECL(dict, const char*, int);
+SH_GEN_DICT_IMPL(dict, const char*, int);
+
+SH_GEN_DECL(rh, int64_t, int);
+SH_GEN_RH_HASH_IMPL(rh, int64_t, int);
+
+SH_GEN_DECL(swiss, int64_t, int);
+SH_GEN_SWISS_HASH_IMPL(swiss, int64_t, int);
+
+SH_GEN_INCREMENTAL_DECL(inc, int64_t, int);
+SH_GEN_INCREMENTAL_HASH_IMPL(inc, int64_t, int);
+
+SH_GEN_SOA_DECL(soa, int64_t, int);
+SH_GEN_SOA_HASH_IMPL(soa, int64_t, int);
+
+void test_types() {
+	sh_t hash;
+	soa_t soa;
+	st_check_int(sizeof(sh_size_t), 8);
+	st_check_int(sizeof(sh_hash_t), 8);
+	st_check_int(sizeof(hash.length), 8);
+	st_check_int(sizeof(hash.capacity), 8);
+	st_check_int(sizeof(hash.slots[0].hash_or_flags), 8);
+	st_check_int(sizeof(soa.capacity), 8);
+	st_check_int(sizeof(soa.hashes[0]), 8);
+	st_check(SH_SLOT_FILLED == (sh_hash_t)1 << 63);
+}
+
+void test_capacity_beyond_32bit() {
+	// Capacities for 3 billion items, too large to actually allocate them in a test
+	st_check(sh_capacity_for(3000000000, 0.8) == (sh_size_t)1 << 32);
+	st_check(sh_capacity_for(4000000000, 0.8) == (sh_size_t)1 << 33);
+	st_check(sh_grown_capacity((sh_size_t)1 << 31, 1717986918, 0, 0.8, 2) == (sh_size_t)1 << 32);
+	st_check(sh_grown_capacity(SH_MAX_CAPACITY, 1, 0, 0.8, 2) == 0);
+	
+	// The partition uses the upper bits of the 64 bit hash
+	st_check_int(sh_partition(SH_SLOT_FILLED | (sh_hash_t)1 << 62, 1), 1);
+	st_check_int(sh_partition(SH_SLOT_FILLED | (sh_hash_t)1 << 31, 1), 0);
+	st_check_int(sh_partition(SH_SLOT_FILLED | (sh_hash_t)0xff << 55, 8), 0xff);
+}
+
+void test_stored_hashes() {
+	sh_t hash;
+	sh_new(&hash);
+	
+	// At least some keys need hashes with bits above the lower 32 bits
+	bool upper_bits = false;
+	for(int64_t i = 0; i < 100; i++)
+		sh_put(&hash, i, i);
+	for(sh_it_p it = sh_start(&hash); it != NULL; it = sh_next(&hash, it)) {
+		st_check(it->hash_or_flags == (sh_int_hash(it->key) | SH_SLOT_FILLED));
+		if ((it->hash_or_flags & ~SH_SLOT_FILLED) >> 32)
+			upper_bits = true;
+	}
+	st_check(upper_bits);
+	
+	sh_destroy(&hash);
+}
+
+void test_linear_and_rh() {
+	sh_t hash;
+	rh_t rh;
+	sh_new(&hash);
+	rh_new(&rh);
+	
+	for(int64_t i = 0; i < 10000; i++) {
+		sh_put(&hash, i * 7, i);
+		rh_put(&rh, i * 7, i);
+	}
+	for(int64_t i = 0; i < 10000; i += 2) {
+		sh_del(&hash, i * 7);
+		rh_del(&rh, i * 7);
+	}
+	
+	st_check_int(hash.length, 5000);
+	st_check_int(rh.length, 5000);
+	for(int64_t i = 0; i < 10000; i++) {
+		st_check_int(sh_get(&hash, i * 7, -1), (i % 2) ? i : -1);
+		st_check_int(rh_get(&rh, i * 7, -1), (i % 2) ? i : -1);
+	}
+	
+	sh_destroy(&hash);
+	rh_destroy(&rh);
+}
+
+void test_swiss() {
+	swiss_t hash;
+	swiss_new(&hash);
+	
+	for(int64_t i = 0; i < 10000; i++)
+		swiss_put(&hash, i, i);
+	for(int64_t i = 0; i < 10000; i += 3)
+		swiss_del(&hash, i);
+	
+	st_check_int(hash.length, 6666);
+	for(int64_t i = 0; i < 10000; i++)
+		st_check_int(swiss_get(&hash, i, -1), (i % 3) ? i : -1);
+	
+	swiss_destroy(&hash);
+}
+
+void test_incremental() {
+	inc_t hash;
+	inc_new(&hash);
+	
+	for(int64_t i = 0; i < 10000; i++)
+		inc_put(&hash, i, i);
+	for(int64_t i = 0; i < 10000; i++)
+		st_check_int(inc_get(&hash, i, -1), i);
+	
+	int count = 0;
+	for(inc_it_p it = inc_start(&hash); it != NULL; it = inc_next(&hash, it)) {
+		if (it->key % 2 == 0)
+			inc_remove(&hash, it);
+		count++;
+	}
+	st_check_int(count, 10000);
+	st_check_int(hash.length, 5000);
+	
+	inc_destroy(&hash);
+}
+
+void test_soa() {
+	soa_t soa;
+	soa_new(&soa);
+	
+	for(int64_t i = 0; i < 10000; i++)
+		soa_put(&soa, i, i);
+	
+	int count = 0;
+	for(sh_size_t i = soa_start(&soa); i < soa.capacity; i = soa_next(&soa, i)) {
+		if (soa.keys[i] % 2 == 0)
+			soa_remove(&soa, i);
+		count++;
+	}
+	st_check_int(count, 10000);
+	st_check_int(soa.length, 5000);
+	for(int64_t i = 0; i < 10000; i++)
+		st_check_int(soa_get(&soa, i, -1), (i % 2) ? i : -1);
+	
+	soa_destroy(&soa);
+}
+
+void test_dict() {
+	dict_t dict;
+	dict_new(&dict);
+	
+	dict_put(&dict, "foo", 1);
+	dict_put(&dict, "bar", 2);
+	dict_put(&dict, "a key longer than a few words", 3);
+	st_check_int(dict_get(&dict, "foo", 0), 1);
+	st_check_int(dict_get(&dict, "bar", 0), 2);
+	st_check_int(dict_get(&dict, "a key longer than a few words", 0), 3);
+	st_check_int(dict_contains(&dict, "baz"), false);
+	
+	dict_it_p it = dict_start(&dict);
+	st_check_not_null(it);
+	st_check(it->hash_or_flags == (sh_bytes_hash(it->key, strlen(it->key)) | SH_SLOT_FILLED));
+	
+	dict_destroy(&dict);
+}
+
+int main() {
+	st_run(test_types);
+	st_run(test_capacity_beyond_32bit);
+	st_run(test_stored_hashes);
+	st_run(test_linear_and_rh);
+	st_run(test_swiss);
+	st_run(test_incremental);
+	st_run(test_soa);
+	st_run(test_dict);
+	return st_show_report();
+}
@@ -0,0 +1,196 @@
+/**
+ * Benchmark of the hash functions in slim_hash.h. Build and run it with "make bench".
+ *
+ * For different key lengths it measures the throughput of each hash function and how evenly it
+ * distributes structured keys (keys that only differ in a counter) across the slots of a hashmap.
+ * The distribution is measured with a chi-squared test on the lower bits of the hash (that's what
+ * the hashmaps use). Values close to 1.0 are ideal, larger values mean more collisions than random.
+ */
+#define SLIM_HASH_IMPLEMENTATION
+#include "../slim_hash.h"
+#include <stdio.h>
+#include <time.h>
+
+
+// Wrappers so all hash functions can be called the same way. sh_fnv1a() needs zero terminated keys
+// so all keys in this benchmark are zero terminated and don't contain zero bytes.
+uint64_t hash_murmur3(const char* key, size_t size) { return sh_murmur3(key, size, 0); }
+uint64_t hash_fnv1a(const char* key, size_t size)   { size = size; return sh_fnv1a(key); }
+uint64_t hash_wyhash(const char* key, size_t size)  { return sh_wyhash(key, size, 0); }
+uint64_t hash_xxhash(const char* key, size_t size)  { return sh_xxhash(key, size, 0); }
+
+struct { const char* name; uint64_t (*func)(const char* key, size_t size); } hashes[] = {
+	{ "murmur3", hash_murmur3 },
+	{ "fnv1a",   hash_fnv1a },
+	{ "wyhash",  hash_wyhash },
+	{ "xxhash",  hash_xxhash },
+};
+const size_t hash_count = sizeof(hashes) / sizeof(hashes[0]);
+const size_t key_sizes[] = { 4, 8, 16, 32, 64, 128, 256, 1024, 4096 };
+const size_t key_size_count = sizeof(key_sizes) / sizeof(key_sizes[0]);
+
+// Keeps the compiler from optimizing the hash calls away
+volatile uint64_t sink = 0;
+
+// Hashmaps with integer keys, one hashed with sh_murmur3() (like SH_GEN_HASH_IMPL() did before
+// sh_value_hash()) and one generated with SH_GEN_HASH_IMPL()
+SH_GEN_DECL(int_murmur3, int64_t, int64_t);
+SH_GEN_IMPL(int_murmur3, int64_t, int64_t, sh_murmur3(&key, sizeof(key), 0), a == b, key, 0,
+	calloc(capacity, slot_size), free(ptr));
+SH_GEN_DECL(int_value, int64_t, int64_t);
+SH_GEN_HASH_IMPL(int_value, int64_t, int64_t);
+
+
+/**
+ * Fills `count` zero terminated keys of `size` bytes (each followed by a zero byte) into `keys`.
+ * All keys share the same random looking prefix, only the last few chars contain a hex counter.
+ */
+void fill_keys(char* keys, size_t size, size_t count) {
+	for(size_t i = 0; i < count; i++) {
+		char* key = keys + i * (size + 1);
+		for(size_t j = 0; j < size; j++)
+			key[j] = 'a' + (j * 7) % 26;
+
+		size_t counter = i;
+		for(size_t j = 0; j < 8 && j < size; j++) {
+			key[size - 1 - j] = "0123456789abcdef"[counter & 15];
+			counter >>= 4;
+		}
+		key[size] = '\0';
+	}
+}
+
+/**
+ * Hashes keys of `size` bytes for a while and returns the throughput in GB/s. Also stores the time
+ * per key in nanoseconds in `ns_per_key`. The keys fit into the cache so this measures just the
+ * hash function.
+ */
+double measure_throughput(uint64_t (*func)(const char* key, size_t size), size_t size, double* ns_per_key) {
+	size_t count = (256 * 1024) / (size + 1) + 1;
+	char* keys = malloc(count * (size + 1));
+	fill_keys(keys, size, count);
+
+	size_t hashed = 0;
+	clock_t start = clock(), end;
+	do {
+		for(size_t i = 0; i < count; i++)
+			sink += func(keys + i * (size + 1), size);
+		hashed += count;
+		end = clock();
+	} while (end - start < CLOCKS_PER_SEC / 4);
+
+	free(keys);
+	double seconds = (double)(end - start) / CLOCKS_PER_SEC;
+	*ns_per_key = seconds * 1e9 / hashed;
+	return (double)hashed * size / seconds / 1e9;
+}
+
+/**
+ * Hashes 64k keys of `size` bytes into 16k buckets (using the lower bits of the hash) and returns
+ * the chi-squared value divided by its degrees of freedom. About 1.0 for a perfectly random hash.
+ */
+double measure_distribution(uint64_t (*func)(const char* key, size_t size), size_t size) {
+	const size_t count = 64 * 1024, bucket_count = 16 * 1024;
+	char* keys = malloc(count * (size + 1));
+	uint32_t* buckets = calloc(bucket_count, sizeof(buckets[0]));
+	fill_keys(keys, size, count);
+
+	for(size_t i = 0; i < count; i++)
+		buckets[func(keys + i * (size + 1), size) & (bucket_count - 1)]++;
+
+	double expected = (double)count / bucket_count, chi_squared = 0;
+	for(size_t i = 0; i < bucket_count; i++)
+		chi_squared += (buckets[i] - expected) * (buckets[i] - expected) / expected;
+
+	free(buckets);
+	free(keys);
+	return chi_squared / (bucket_count - 1);
+}
+
+/**
+ * Distribution of 64k integer keys (multiples of `stride`) in 16k buckets, see
+ * measure_distribution().
+ */
+double measure_int_distribution(uint32_t (*func)(int64_t key), int64_t stride) {
+	const size_t count = 64 * 1024, bucket_count = 16 * 1024;
+	uint32_t* buckets = calloc(bucket_count, sizeof(buckets[0]));
+	for(size_t i = 0; i < count; i++)
+		buckets[func(i * stride) & (bucket_count - 1)]++;
+	
+	double expected = (double)count / bucket_count, chi_squared = 0;
+	for(size_t i = 0; i < bucket_count; i++)
+		chi_squared += (buckets[i] - expected) * (buckets[i] - expected) / expected;
+	
+	free(buckets);
+	return chi_squared / (bucket_count - 1);
+}
+
+uint32_t int_hash_murmur3(int64_t key) { return sh_murmur3(&key, sizeof(key), 0); }
+uint32_t int_hash_value(int64_t key)   { return sh_value_hash(&key, sizeof(key)); }
+
+// Generates a function that looks up 1M keys in a hashmap with 1M integer keys and returns the time
+// per lookup in nanoseconds
+#define GEN_MEASURE_INT_LOOKUPS(name)                                           \
+	double name##_measure_lookups() {                                           \
+		const int64_t count = 1024 * 1024;                                      \
+		struct name map;                                                        \
+		name##_new(&map);                                                       \
+		for(int64_t i = 0; i < count; i++)                                      \
+			name##_put(&map, i * 7, i);                                         \
+		                                                                        \
+		clock_t start = clock();                                                \
+		for(int round = 0; round < 4; round++) {                                \
+			for(int64_t i = 0; i < count; i++)                                  \
+				sink += name##_get(&map, i * 7, 0);                             \
+		}                                                                       \
+		clock_t end = clock();                                                  \
+		                                                                        \
+		name##_destroy(&map);                                                   \
+		return (double)(end - start) / CLOCKS_PER_SEC * 1e9 / (count * 4);      \
+	}
+
+GEN_MEASURE_INT_LOOKUPS(int_murmur3)
+GEN_MEASURE_INT_LOOKUPS(int_value)
+
+int main() {
+	printf("Throughput in GB/s (ns per key in brackets)\n\n%8s", "bytes");
+	for(size_t h = 0; h < hash_count; h++)
+		printf("  %18s", hashes[h].name);
+	printf("\n");
+
+	for(size_t s = 0; s < key_size_count; s++) {
+		printf("%8zu", key_sizes[s]);
+		for(size_t h = 0; h < hash_count; h++) {
+			double ns_per_key = 0;
+			double gb_per_second = measure_throughput(hashes[h].func, key_sizes[s], &ns_per_key);
+			printf("  %7.2f (%7.1f ns)", gb_per_second, ns_per_key);
+		}
+		printf("\n");
+	}
+
+	printf("\nDistribution of 64k keys with a counter in 16k buckets (chi-squared / df, ideal 1.0)\n\n%8s", "bytes");
+	for(size_t h = 0; h < hash_count; h++)
+		printf("  %18s", hashes[h].name);
+	printf("\n");
+
+	for(size_t s = 0; s < key_size_count; s++) {
+		printf("%8zu", key_sizes[s]);
+		for(size_t h = 0; h < hash_count; h++)
+			printf("  %18.3f", measure_distribution(hashes[h].func, key_sizes[s]));
+		printf("\n");
+	}
+
+	printf("\nInteger keys (int64_t): murmur3 vs. sh_value_hash() used by SH_GEN_HASH_IMPL()\n\n");
+	printf("%-34s  %10s  %14s\n", "", "murmur3", "sh_value_hash");
+	printf("%-34s  %7.1f ns  %11.1f ns\n", "lookup in a map with 1M keys",
+		int_murmur3_measure_lookups(), int_value_measure_lookups());
+	int64_t strides[] = { 1, 8, 1024 };
+	for(size_t i = 0; i < sizeof(strides) / sizeof(strides[0]); i++) {
+		char label[64];
+		snprintf(label, sizeof(label), "distribution of keys i * %d", (int)strides[i]);
+		printf("%-34s  %10.3f  %14.3f\n", label, measure_int_distribution(int_hash_murmur3, strides[i]),
+			measure_int_distribution(int_hash_value, strides[i]));
+	}
+
+	return 0;
+}
@@ -0,0 +1,225 @@
+/**
+ * Multithreaded throughput of a hashmap shared by many threads. Build and run it with "make bench".
+ *
+ * Compares a normal hashmap protected by one global mutex with a SH_GEN_CONCURRENT_DECL() hashmap
+ * that has a reader/writer lock per shard. The threads share a fixed amount of work, looking up
+ * and inserting random keys of a prefilled hashmap. Shows the total number of operations per
+ * second for different thread counts and read/write ratios. Of course the threads can only run in
+ * parallel on a machine with enough cores.
+ *
+ * Also measures how long it takes to build a table of BUILD_KEYS items, with a single-threaded
+ * table_put() loop and with SH_GEN_ATOMIC_DECL() tables built by more and more threads.
+ *
+ * And how long it takes to merge MERGE_MAPS hashmaps (e.g. filled by different threads) into one:
+ * With a loop over all items and table_put(), with table_merge() and with ..._reduce() of the
+ * sharded hashmap with more and more threads.
+ */
+#define _POSIX_C_SOURCE 200809L
+#define SLIM_HASH_CONCURRENT
+#define SLIM_HASH_IMPLEMENTATION
+#include "../slim_hash.h"
+#include <stdio.h>
+#include <time.h>
+
+
+SH_GEN_DECL(table, int64_t, int64_t);
+SH_GEN_HASH_IMPL(table, int64_t, int64_t);
+SH_GEN_CONCURRENT_DECL(shared_table, table, int64_t, int64_t);
+SH_GEN_CONCURRENT_HASH_IMPL(shared_table, table, int64_t, int64_t);
+SH_GEN_ATOMIC_DECL(atomic_table, int64_t, int64_t);
+SH_GEN_ATOMIC_HASH_IMPL(atomic_table, int64_t, int64_t);
+
+#define KEY_RANGE       (1024 * 1024)
+#define TOTAL_OPS       (4 * 1000 * 1000)
+#define SHARD_COUNT     256
+#define BUILD_KEYS      (4 * 1024 * 1024)
+#define MERGE_MAPS      8
+#define MERGE_KEYS      (512 * 1024)
+
+const int thread_counts[] = { 1, 2, 4, 8, 16, 32 };
+const int thread_count_count = sizeof(thread_counts) / sizeof(thread_counts[0]);
+const int write_percentages[] = { 5, 50 };
+const int write_percentage_count = sizeof(write_percentages) / sizeof(write_percentages[0]);
+
+// The hashmap with a global mutex
+pthread_mutex_t global_lock = PTHREAD_MUTEX_INITIALIZER;
+table_t global_table;
+
+// The sharded hashmap
+shared_table_t sharded_table;
+
+struct worker {
+	pthread_t thread;
+	int ops;
+	uint64_t random_state;
+	int write_percentage;
+	bool sharded;
+	int64_t sum;
+};
+
+
+// xorshift64 so the threads don't share the state of rand()
+uint64_t next_random(uint64_t* state) {
+	*state ^= *state << 13;
+	*state ^= *state >> 7;
+	*state ^= *state << 17;
+	return *state;
+}
+
+void* work(void* arg) {
+	struct worker* worker = arg;
+	for(int i = 0; i < worker->ops; i++) {
+		uint64_t random = next_random(&worker->random_state);
+		int64_t key = random % KEY_RANGE;
+		bool write = (int)((random >> 32) % 100) < worker->write_percentage;
+
+		if (worker->sharded) {
+			if (write)
+				shared_table_put(&sharded_table, key, i);
+			else
+				worker->sum += shared_table_get(&sharded_table, key, 0);
+		} else {
+			pthread_mutex_lock(&global_lock);
+			if (write)
+				table_put(&global_table, key, i);
+			else
+				worker->sum += table_get(&global_table, key, 0);
+			pthread_mutex_unlock(&global_lock);
+		}
+	}
+	return NULL;
+}
+
+double now() {
+	struct timespec time;
+	clock_gettime(CLOCK_MONOTONIC, &time);
+	return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// Runs the workers and returns the total number of operations per second (in millions)
+double measure(int thread_count, int write_percentage, bool sharded) {
+	struct worker workers[32];
+	double start = now();
+	for(int i = 0; i < thread_count; i++) {
+		workers[i] = (struct worker){ .ops = TOTAL_OPS / thread_count,
+			.random_state = 0x9e3779b97f4a7c15 * (i + 1),
+			.write_percentage = write_percentage, .sharded = sharded, .sum = 0 };
+		pthread_create(&workers[i].thread, NULL, work, &workers[i]);
+	}
+	for(int i = 0; i < thread_count; i++)
+		pthread_join(workers[i].thread, NULL);
+	double seconds = now() - start;
+
+	return (double)(TOTAL_OPS / thread_count) * thread_count / seconds / 1e6;
+}
+
+// Builds a table with BUILD_KEYS random keys and returns the million inserts per second. A
+// thread_count of 0 uses table_put() instead of an atomic table.
+double measure_build(int64_t* keys, int64_t* values, int thread_count) {
+	double start = now(), seconds = 0;
+	if (thread_count == 0) {
+		table_t t;
+		table_new(&t);
+		for(size_t i = 0; i < BUILD_KEYS; i++)
+			table_put(&t, keys[i], values[i]);
+		seconds = now() - start;
+		table_destroy(&t);
+	} else {
+		atomic_table_t t;
+		atomic_table_build_from_arrays(&t, keys, values, BUILD_KEYS, thread_count);
+		seconds = now() - start;
+		atomic_table_destroy(&t);
+	}
+	return BUILD_KEYS / seconds / 1e6;
+}
+
+void add(int64_t* dst_value, int64_t src_value, void* data) {
+	*dst_value += src_value;
+	data = data;  // avoid unused variable warning
+}
+
+// Merges the maps and returns the million merged items per second. A thread_count of 0 uses a
+// loop with table_put(), -1 uses table_merge() and everything else shared_table_reduce().
+double measure_merge(table_t* maps, int thread_count) {
+	double start = now(), seconds = 0;
+	if (thread_count <= 0) {
+		table_t t;
+		table_new(&t);
+		for(int m = 0; m < MERGE_MAPS; m++) {
+			if (thread_count == 0) {
+				for(table_it_p it = table_start(&maps[m]); it; it = table_next(&maps[m], it))
+					*table_put_ptr(&t, it->key) += it->value;
+			} else {
+				table_merge(&t, &maps[m], add, NULL);
+			}
+		}
+		seconds = now() - start;
+		table_destroy(&t);
+	} else {
+		shared_table_t t;
+		shared_table_new(&t, SHARD_COUNT);
+		shared_table_reduce(&t, maps, MERGE_MAPS, add, NULL, thread_count);
+		seconds = now() - start;
+		shared_table_destroy(&t);
+	}
+	return MERGE_MAPS * MERGE_KEYS / seconds / 1e6;
+}
+
+int main() {
+	table_new(&global_table);
+	shared_table_new(&sharded_table, SHARD_COUNT);
+	for(int64_t key = 0; key < KEY_RANGE; key += 2) {
+		table_put(&global_table, key, key);
+		shared_table_put(&sharded_table, key, key);
+	}
+
+	printf("Million operations per second, %d random keys, %d shards\n\n", KEY_RANGE, SHARD_COUNT);
+	printf("%8s  %8s  %14s  %14s\n", "threads", "writes", "global mutex", "sharded");
+	for(int w = 0; w < write_percentage_count; w++) {
+		for(int t = 0; t < thread_count_count; t++) {
+			double global = measure(thread_counts[t], write_percentages[w], false);
+			double sharded = measure(thread_counts[t], write_percentages[w], true);
+			printf("%8d  %7d%%  %14.2f  %14.2f\n", thread_counts[t], write_percentages[w], global, sharded);
+		}
+	}
+
+	table_destroy(&global_table);
+	shared_table_destroy(&sharded_table);
+	
+	int64_t* keys = malloc(BUILD_KEYS * sizeof(keys[0]));
+	int64_t* values = malloc(BUILD_KEYS * sizeof(values[0]));
+	uint64_t random_state = 0x9e3779b97f4a7c15;
+	for(size_t i = 0; i < BUILD_KEYS; i++) {
+		keys[i] = next_random(&random_state);
+		values[i] = i;
+	}
+	
+	printf("\nBuilding a table with %d random keys, million inserts per second\n\n", BUILD_KEYS);
+	printf("%8s  %14s\n", "threads", "inserts");
+	printf("%8s  %14.2f\n", "put loop", measure_build(keys, values, 0));
+	for(int t = 0; t < thread_count_count; t++)
+		printf("%8d  %14.2f\n", thread_counts[t], measure_build(keys, values, thread_counts[t]));
+	
+	free(keys);
+	free(values);
+	
+	// Each map gets MERGE_KEYS keys of a range twice that size, so about half of the keys of
+	// each map are also in the others
+	table_t maps[MERGE_MAPS];
+	for(int m = 0; m < MERGE_MAPS; m++) {
+		table_new(&maps[m]);
+		for(size_t i = 0; i < MERGE_KEYS; i++)
+			table_put(&maps[m], next_random(&random_state) % (2 * MERGE_KEYS), 1);
+	}
+	
+	printf("\nMerging %d hashmaps with %d keys each, million items per second\n\n", MERGE_MAPS, MERGE_KEYS);
+	printf("%8s  %14s\n", "threads", "items");
+	printf("%8s  %14.2f\n", "put loop", measure_merge(maps, 0));
+	printf("%8s  %14.2f\n", "merge", measure_merge(maps, -1));
+	for(int t = 0; t < thread_count_count; t++)
+		printf("%8d  %14.2f\n", thread_counts[t], measure_merge(maps, thread_counts[t]));
+	
+	for(int m = 0; m < MERGE_MAPS; m++)
+		table_destroy(&maps[m]);
+	return 0;
+}
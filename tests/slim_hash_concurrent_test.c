@@ -0,0 +1,355 @@
+// pthread rwlocks are part of POSIX, not C99
+#define _POSIX_C_SOURCE 200809L
+#define SLIM_HASH_CONCURRENT
+#define SLIM_HASH_IMPLEMENTATION
+#include "../slim_hash.h"
+#define SLIM_TEST_IMPLEMENTATION
+#include "../slim_test.h"
+
+
+SH_GEN_DECL(table, int64_t, int);
+SH_GEN_HASH_IMPL(table, int64_t, int);
+SH_GEN_CONCURRENT_DECL(shared_table, table, int64_t, int);
+SH_GEN_CONCURRENT_HASH_IMPL(shared_table, table, int64_t, int);
+
+SH_GEN_DECL(dict, const char*, int);
+SH_GEN_RH_DICT_IMPL(dict, const char*, int);
+SH_GEN_CONCURRENT_DECL(shared_dict, dict, const char*, int);
+SH_GEN_CONCURRENT_DICT_IMPL(shared_dict, dict, const char*, int);
+
+SH_GEN_SOA_DECL(soa, int64_t, int);
+SH_GEN_SOA_HASH_IMPL(soa, int64_t, int);
+SH_GEN_CONCURRENT_DECL(shared_soa, soa, int64_t, int);
+SH_GEN_CONCURRENT_HASH_IMPL(shared_soa, soa, int64_t, int);
+
+SH_GEN_INCREMENTAL_DECL(inc, int64_t, int);
+SH_GEN_INCREMENTAL_HASH_IMPL(inc, int64_t, int);
+SH_GEN_CONCURRENT_DECL(shared_inc, inc, int64_t, int);
+SH_GEN_CONCURRENT_HASH_IMPL(shared_inc, inc, int64_t, int);
+
+SH_GEN_ATOMIC_DECL(atomic_table, int64_t, int);
+SH_GEN_ATOMIC_HASH_IMPL(atomic_table, int64_t, int);
+SH_GEN_ATOMIC_DECL(atomic_dict, const char*, int);
+SH_GEN_ATOMIC_DICT_IMPL(atomic_dict, const char*, int);
+
+void increment(int* value, bool inserted, void* data) {
+	*value = inserted ? 1 : *value + 1;
+	data = data;  // avoid unused variable warning
+}
+
+void test_api() {
+	shared_table_t t;
+	st_check_int(shared_table_new(&t, 5), true);
+	st_check_int(t.shard_bits, 3);
+	
+	for(int i = 0; i < 1000; i++)
+		st_check_int(shared_table_put(&t, i, i * 2), true);
+	st_check_int((int)shared_table_length(&t), 1000);
+	for(int i = 0; i < 1000; i++) {
+		st_check_int(shared_table_get(&t, i, -1), i * 2);
+		st_check_int(shared_table_contains(&t, i), true);
+	}
+	st_check_int(shared_table_get(&t, 1000, -1), -1);
+	st_check_int(shared_table_contains(&t, 1000), false);
+	
+	// Keys are spread over all shards
+	for(uint32_t i = 0; i < 8; i++)
+		st_check(t.shards[i].hashmap.length > 50);
+	
+	st_check_int(shared_table_del(&t, 7), true);
+	st_check_int(shared_table_del(&t, 7), false);
+	st_check_int(shared_table_get(&t, 7, -1), -1);
+	
+	shared_table_update(&t, 7, increment, NULL);
+	shared_table_update(&t, 7, increment, NULL);
+	st_check_int(shared_table_get(&t, 7, -1), 2);
+	
+	shared_table_destroy(&t);
+	st_check_null(t.shards);
+}
+
+void test_dict_and_soa_shards() {
+	shared_dict_t d;
+	shared_dict_new(&d, 4);
+	char key[32];
+	for(int i = 0; i < 500; i++) {
+		snprintf(key, sizeof(key), "key %d", i);
+		shared_dict_put(&d, key, i);
+	}
+	for(int i = 0; i < 500; i++) {
+		snprintf(key, sizeof(key), "key %d", i);
+		st_check_int(shared_dict_get(&d, key, -1), i);
+	}
+	st_check_int(shared_dict_del(&d, "key 3"), true);
+	st_check_int((int)shared_dict_length(&d), 499);
+	shared_dict_destroy(&d);
+	
+	shared_soa_t s;
+	shared_soa_new(&s, 1);
+	st_check_int(s.shard_bits, 0);
+	for(int i = 0; i < 500; i++)
+		shared_soa_put(&s, i, i);
+	for(int i = 0; i < 500; i++)
+		st_check_int(shared_soa_get(&s, i, -1), i);
+	shared_soa_destroy(&s);
+}
+
+
+#define THREAD_COUNT     8
+#define KEYS_PER_THREAD  20000
+#define COUNTER_KEYS     16
+
+struct worker {
+	pthread_t thread;
+	shared_table_t* table;
+	int index, mismatches;
+};
+
+// Each worker inserts its own range of keys, reads back the keys it inserted so far, deletes every
+// other one and increments the shared counters.
+void* work(void* arg) {
+	struct worker* worker = arg;
+	int64_t base = (int64_t)worker->index * KEYS_PER_THREAD;
+	for(int i = 0; i < KEYS_PER_THREAD; i++) {
+		shared_table_put(worker->table, base + i, i);
+		if (shared_table_get(worker->table, base + i / 2, -1) != i / 2)
+			worker->mismatches++;
+		shared_table_update(worker->table, 1000000000 + i % COUNTER_KEYS, increment, NULL);
+	}
+	for(int i = 0; i < KEYS_PER_THREAD; i += 2)
+		shared_table_del(worker->table, base + i);
+	return NULL;
+}
+
+void test_threads() {
+	shared_table_t t;
+	shared_table_new(&t, 4 * THREAD_COUNT);
+	
+	struct worker workers[THREAD_COUNT];
+	for(int i = 0; i < THREAD_COUNT; i++) {
+		workers[i] = (struct worker){ .table = &t, .index = i, .mismatches = 0 };
+		st_check_int(pthread_create(&workers[i].thread, NULL, work, &workers[i]), 0);
+	}
+	for(int i = 0; i < THREAD_COUNT; i++) {
+		pthread_join(workers[i].thread, NULL);
+		st_check_int(workers[i].mismatches, 0);
+	}
+	
+	st_check_int((int)shared_table_length(&t), THREAD_COUNT * KEYS_PER_THREAD / 2 + COUNTER_KEYS);
+	for(int64_t key = 0; key < THREAD_COUNT * KEYS_PER_THREAD; key++)
+		st_check_int(shared_table_get(&t, key, -1), (key % 2 == 0) ? -1 : (int)(key % KEYS_PER_THREAD));
+	for(int i = 0; i < COUNTER_KEYS; i++)
+		st_check_int(shared_table_get(&t, 1000000000 + i, 0), THREAD_COUNT * KEYS_PER_THREAD / COUNTER_KEYS);
+	
+	shared_table_destroy(&t);
+}
+
+
+void test_atomic_api() {
+	atomic_table_t t;
+	st_check_int(atomic_table_new(&t, 100), true);
+	st_check_int(t.capacity, 256);
+	
+	bool inserted = false;
+	for(int i = 0; i < 100; i++) {
+		int* value = atomic_table_insert(&t, i, i * 2, &inserted);
+		st_check_not_null(value);
+		st_check_int(*value, i * 2);
+		st_check_int(inserted, true);
+	}
+	
+	// Inserting an existing key keeps the first value
+	int* value = atomic_table_insert(&t, 7, -7, &inserted);
+	st_check_int(inserted, false);
+	st_check_int(*value, 14);
+	
+	st_check_int((int)atomic_table_length(&t), 100);
+	for(int i = 0; i < 100; i++) {
+		st_check_int(atomic_table_get(&t, i, -1), i * 2);
+		st_check_int(atomic_table_contains(&t, i), true);
+	}
+	st_check_int(atomic_table_get(&t, 100, -1), -1);
+	st_check_null(atomic_table_get_ptr(&t, 100));
+	
+	int sum = 0;
+	for(atomic_table_it_p it = atomic_table_start(&t); it; it = atomic_table_next(&t, it))
+		sum += it->value;
+	st_check_int(sum, 99 * 100);
+	
+	// Fill the table completely, the next insert of a new key fails
+	for(int i = 100; i < 256; i++)
+		st_check_not_null(atomic_table_insert(&t, i, i * 2, &inserted));
+	st_check_null(atomic_table_insert(&t, 256, 0, &inserted));
+	st_check_int(atomic_table_get(&t, 255, -1), 255 * 2);
+	st_check_int(atomic_table_get(&t, 256, -1), -1);
+	st_check_int(*atomic_table_insert(&t, 3, 0, &inserted), 6);
+	
+	atomic_table_destroy(&t);
+	st_check_null(t.slots);
+	
+	atomic_dict_t d;
+	atomic_dict_new(&d, 10);
+	char key[32] = "foo";
+	atomic_dict_insert(&d, key, 1, &inserted);
+	strcpy(key, "bar");
+	atomic_dict_insert(&d, key, 2, &inserted);
+	st_check_int(atomic_dict_get(&d, "foo", -1), 1);
+	st_check_int(atomic_dict_get(&d, "bar", -1), 2);
+	atomic_dict_insert(&d, "foo", 3, &inserted);
+	st_check_int(inserted, false);
+	atomic_dict_destroy(&d);
+}
+
+
+struct atomic_worker {
+	pthread_t thread;
+	atomic_table_t* table;
+	int index, inserted, mismatches;
+};
+
+// All workers insert the same keys (in a different order) so they race for the same slots. Each
+// key must be inserted by exactly one of them.
+void* atomic_work(void* arg) {
+	struct atomic_worker* worker = arg;
+	for(int i = 0; i < KEYS_PER_THREAD; i++) {
+		int64_t key = (i + worker->index * 997) % KEYS_PER_THREAD;
+		bool inserted = false;
+		int* value = atomic_table_insert(worker->table, key, worker->index, &inserted);
+		if (value == NULL)
+			worker->mismatches++;
+		else if (inserted)
+			worker->inserted++;
+		
+		if (atomic_table_get(worker->table, key, -1) == -1)
+			worker->mismatches++;
+	}
+	return NULL;
+}
+
+void test_atomic_threads() {
+	atomic_table_t t;
+	atomic_table_new(&t, KEYS_PER_THREAD);
+	
+	struct atomic_worker workers[THREAD_COUNT];
+	for(int i = 0; i < THREAD_COUNT; i++) {
+		workers[i] = (struct atomic_worker){ .table = &t, .index = i, .inserted = 0, .mismatches = 0 };
+		st_check_int(pthread_create(&workers[i].thread, NULL, atomic_work, &workers[i]), 0);
+	}
+	int inserted = 0;
+	for(int i = 0; i < THREAD_COUNT; i++) {
+		pthread_join(workers[i].thread, NULL);
+		st_check_int(workers[i].mismatches, 0);
+		inserted += workers[i].inserted;
+	}
+	
+	st_check_int(inserted, KEYS_PER_THREAD);
+	st_check_int((int)atomic_table_length(&t), KEYS_PER_THREAD);
+	atomic_table_destroy(&t);
+}
+
+void test_atomic_build_from_arrays() {
+	const size_t count = THREAD_COUNT * KEYS_PER_THREAD;
+	int64_t* keys = malloc(count * sizeof(keys[0]));
+	int* values = malloc(count * sizeof(values[0]));
+	for(size_t i = 0; i < count; i++) {
+		keys[i] = (int64_t)(i % (count / 2)) * 3;  // every key twice
+		values[i] = (int)(i % (count / 2));
+	}
+	
+	atomic_table_t t;
+	st_check_int(atomic_table_build_from_arrays(&t, keys, values, count, THREAD_COUNT), true);
+	st_check_int((int)atomic_table_length(&t), (int)count / 2);
+	for(size_t i = 0; i < count / 2; i++)
+		st_check_int(atomic_table_get(&t, (int64_t)i * 3, -1), (int)i);
+	st_check_int(atomic_table_contains(&t, 1), false);
+	atomic_table_destroy(&t);
+	
+	st_check_int(atomic_table_build_from_arrays(&t, keys, values, 0, 0), true);
+	st_check_int((int)atomic_table_length(&t), 0);
+	atomic_table_destroy(&t);
+	
+	free(keys);
+	free(values);
+}
+
+void add(int* dst_value, int src_value, void* data) {
+	*dst_value += src_value;
+	data = data;  // avoid unused variable warning
+}
+
+void test_reduce() {
+	// Word counts of several threads, "word i" occurs i % 7 times in each map that has it
+	dict_t counts[THREAD_COUNT];
+	char key[32];
+	for(int t = 0; t < THREAD_COUNT; t++) {
+		dict_new(&counts[t]);
+		for(int i = t * 100; i < 2000; i++) {
+			snprintf(key, sizeof(key), "word %d", i);
+			dict_put(&counts[t], key, i % 7);
+		}
+	}
+	
+	shared_dict_t total;
+	shared_dict_new(&total, 16);
+	shared_dict_put(&total, "word 0", 1000);
+	st_check_int(shared_dict_reduce(&total, counts, THREAD_COUNT, add, NULL, 4), true);
+	for(int t = 0; t < THREAD_COUNT; t++)
+		dict_destroy(&counts[t]);
+	
+	st_check_int((int)shared_dict_length(&total), 2000);
+	st_check_int(shared_dict_get(&total, "word 0", -1), 1000);
+	for(int i = 1; i < 2000; i++) {
+		snprintf(key, sizeof(key), "word %d", i);
+		int maps_with_word = (i / 100 + 1 < THREAD_COUNT) ? i / 100 + 1 : THREAD_COUNT;
+		st_check_int(shared_dict_get(&total, key, -1), maps_with_word * (i % 7));
+	}
+	shared_dict_destroy(&total);
+	
+	// More threads than shards and maps, without combine function
+	soa_t maps[2];
+	for(int m = 0; m < 2; m++) {
+		soa_new(&maps[m]);
+		for(int i = 0; i < 1000; i++)
+			soa_put(&maps[m], i * (m + 1), m + 1);
+	}
+	shared_soa_t s;
+	shared_soa_new(&s, 4);
+	st_check_int(shared_soa_reduce(&s, maps, 2, NULL, NULL, 16), true);
+	st_check_int((int)shared_soa_length(&s), 1500);
+	st_check_int(shared_soa_get(&s, 999, -1), 1);
+	st_check_int(shared_soa_get(&s, 1000, -1), 2);
+	for(uint32_t i = 0; i < 4; i++)
+		st_check(s.shards[i].hashmap.length > 0);
+	shared_soa_destroy(&s);
+	for(int m = 0; m < 2; m++)
+		soa_destroy(&maps[m]);
+	
+	// Items that are still in the old slots of an incremental resize are merged as well
+	inc_t inc;
+	inc_new(&inc);
+	int64_t inc_length = 0;
+	while (inc.old_slots == NULL || inc.migrated == 0) {
+		inc_put(&inc, inc_length, 1);
+		inc_length++;
+	}
+	shared_inc_t si;
+	shared_inc_new(&si, 8);
+	st_check_int(shared_inc_reduce(&si, &inc, 1, add, NULL, 3), true);
+	st_check_int(shared_inc_reduce(&si, &inc, 1, add, NULL, 3), true);
+	st_check_int((int)shared_inc_length(&si), inc_length);
+	for(int64_t i = 0; i < inc_length; i++)
+		st_check_int(shared_inc_get(&si, i, -1), 2);
+	shared_inc_destroy(&si);
+	inc_destroy(&inc);
+}
+
+int main() {
+	st_run(test_api);
+	st_run(test_dict_and_soa_shards);
+	st_run(test_threads);
+	st_run(test_atomic_api);
+	st_run(test_atomic_threads);
+	st_run(test_atomic_build_from_arrays);
+	st_run(test_reduce);
+	return st_show_report();
+}
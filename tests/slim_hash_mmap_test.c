@@ -0,0 +1,197 @@
+#define SLIM_HASH_MMAP
+#define SLIM_HASH_IMPLEMENTATION
+#include "../slim_hash.h"
+#define SLIM_TEST_IMPLEMENTATION
+#include "../slim_test.h"
+
+
+SH_GEN_DECL(sh, int64_t, int);
+SH_GEN_HASH_IMPL(sh, int64_t, int);
+
+SH_GEN_DECL(rh, int64_t, int);
+SH_GEN_RH_HASH_IMPL(rh, int64_t, int);
+
+SH_GEN_DECL(swiss, int64_t, int);
+SH_GEN_SWISS_HASH_IMPL(swiss, int64_t, int);
+
+SH_GEN_INCREMENTAL_DECL(inc, int64_t, int);
+SH_GEN_INCREMENTAL_HASH_IMPL(inc, int64_t, int);
+
+SH_GEN_SOA_DECL(soa, int64_t, int);
+SH_GEN_SOA_HASH_IMPL(soa, int64_t, int);
+
+// Same types as sh but a different hash function
+SH_GEN_DECL(other_hash, int64_t, int);
+SH_GEN_IMPL(other_hash, int64_t, int, sh_murmur3(&key, sizeof(key), 0), a == b, key, 0,
+	calloc(capacity, slot_size), free(ptr));
+
+// Same key type as sh but a larger value
+SH_GEN_DECL(other_value, int64_t, int64_t);
+SH_GEN_HASH_IMPL(other_value, int64_t, int64_t);
+
+// Dictionaries get no ..._save() and ..._open_mmap() since their keys are pointers
+SH_GEN_DECL(dict, const char*, int);
+SH_GEN_DICT_IMPL(dict, const char*, int);
+
+SH_GEN_SOA_DECL(soa_dict, const char*, int);
+SH_GEN_SOA_DICT_IMPL(soa_dict, const char*, int);
+
+SH_GEN_STR_DICT_DECL(words, int);
+SH_GEN_STR_DICT_IMPL(words, int);
+
+const char* path = "tests/slim_hash_mmap_test.tmp";
+
+void test_save_and_open() {
+	sh_t hash;
+	sh_new(&hash);
+	for(int64_t i = 0; i < 10000; i++)
+		sh_put(&hash, i * 7, i);
+	for(int64_t i = 0; i < 10000; i += 2)
+		sh_del(&hash, i * 7);
+	st_check_int(sh_save(&hash, path), true);
+	sh_destroy(&hash);
+	
+	sh_t mapped;
+	st_check_int(sh_open_mmap(&mapped, path), true);
+	st_check_int(mapped.length, 5000);
+	for(int64_t i = 0; i < 10000; i++)
+		st_check_int(sh_get(&mapped, i * 7, -1), (i % 2) ? i : -1);
+	
+	int count = 0;
+	for(sh_it_p it = sh_start(&mapped); it != NULL; it = sh_next(&mapped, it))
+		count++;
+	st_check_int(count, 5000);
+	
+	sh_close_mmap(&mapped);
+	st_check_null(mapped.slots);
+	st_check_int(mapped.length, 0);
+	remove(path);
+}
+
+void test_probing_schemes() {
+	rh_t rh;
+	swiss_t swiss;
+	rh_new(&rh);
+	swiss_new(&swiss);
+	for(int64_t i = 0; i < 10000; i++) {
+		rh_put(&rh, i, i);
+		swiss_put(&swiss, i, i);
+	}
+	
+	st_check_int(rh_save(&rh, path), true);
+	rh_destroy(&rh);
+	st_check_int(rh_open_mmap(&rh, path), true);
+	for(int64_t i = 0; i < 10000; i++)
+		st_check_int(rh_get(&rh, i, -1), i);
+	st_check_int(rh_contains(&rh, 10000), false);
+	rh_close_mmap(&rh);
+	
+	st_check_int(swiss_save(&swiss, path), true);
+	swiss_destroy(&swiss);
+	st_check_int(swiss_open_mmap(&swiss, path), true);
+	for(int64_t i = 0; i < 10000; i++)
+		st_check_int(swiss_get(&swiss, i, -1), i);
+	st_check_int(swiss_contains(&swiss, 10000), false);
+	swiss_close_mmap(&swiss);
+	
+	remove(path);
+}
+
+void test_incremental_during_resize() {
+	inc_t inc;
+	inc_new(&inc);
+	int64_t key = 0;
+	while (inc.old_slots == NULL) {
+		inc_put(&inc, key, key);
+		key++;
+	}
+	
+	// Saving finishes the resize first
+	st_check_int(inc_save(&inc, path), true);
+	st_check_null(inc.old_slots);
+	inc_destroy(&inc);
+	
+	st_check_int(inc_open_mmap(&inc, path), true);
+	st_check_int(inc.length, key);
+	for(int64_t i = 0; i < key; i++)
+		st_check_int(inc_get(&inc, i, -1), i);
+	inc_close_mmap(&inc);
+	remove(path);
+}
+
+void test_soa() {
+	soa_t soa;
+	soa_new(&soa);
+	for(int64_t i = 0; i < 10000; i++)
+		soa_put(&soa, i, i);
+	st_check_int(soa_save(&soa, path), true);
+	soa_destroy(&soa);
+	
+	st_check_int(soa_open_mmap(&soa, path), true);
+	st_check_int(soa.length, 10000);
+	for(int64_t i = 0; i < 10000; i++)
+		st_check_int(soa_get(&soa, i, -1), i);
+	
+	int count = 0;
+	for(sh_size_t i = soa_start(&soa); i < soa.capacity; i = soa_next(&soa, i))
+		count++;
+	st_check_int(count, 10000);
+	
+	soa_close_mmap(&soa);
+	st_check_null(soa.hashes);
+	remove(path);
+}
+
+void test_invalid_files() {
+	sh_t hash;
+	st_check_int(sh_open_mmap(&hash, "tests/does_not_exist.tmp"), false);
+	
+	sh_new(&hash);
+	for(int64_t i = 0; i < 100; i++)
+		sh_put(&hash, i, i);
+	st_check_int(sh_save(&hash, path), true);
+	
+	// Hashmaps with another name or another value size
+	rh_t rh;
+	other_value_t other_value;
+	st_check_int(rh_open_mmap(&rh, path), false);
+	st_check_int(other_value_open_mmap(&other_value, path), false);
+	
+	// A hashmap with the same name but another hash function, e.g. after the code changed
+	FILE* file = fopen(path, "r+b");
+	fseek(file, offsetof(struct sh_file_header, name), SEEK_SET);
+	char name[32] = "other_hash";
+	fwrite(name, sizeof(name), 1, file);
+	fclose(file);
+	other_hash_t other_hash;
+	st_check_int(other_hash_open_mmap(&other_hash, path), false);
+	st_check_null(other_hash.slots);
+	
+	// Truncated file
+	st_check_int(sh_save(&hash, path), true);
+	file = fopen(path, "rb");
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	char* data = malloc(size);
+	fseek(file, 0, SEEK_SET);
+	st_check_int(fread(data, size, 1, file), 1);
+	fclose(file);
+	file = fopen(path, "wb");
+	fwrite(data, size - 64, 1, file);
+	fclose(file);
+	free(data);
+	sh_t mapped;
+	st_check_int(sh_open_mmap(&mapped, path), false);
+	
+	sh_destroy(&hash);
+	remove(path);
+}
+
+int main() {
+	st_run(test_save_and_open);
+	st_run(test_probing_schemes);
+	st_run(test_incremental_during_resize);
+	st_run(test_soa);
+	st_run(test_invalid_files);
+	return st_show_report();
+}
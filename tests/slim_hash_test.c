@@ -1,3 +1,7 @@
+// Count the resizes reported by the stats hook
+int resize_counter = 0;
+#define SH_RESIZE_STATS(name, old_capacity, new_capacity, length, seconds)  (resize_counter++)
+
 #define SLIM_HASH_IMPLEMENTATION
 #include "../slim_hash.h"
 #define SLIM_TEST_IMPLEMENTATION
@@ -10,6 +14,69 @@ SH_GEN_HASH_IMPL(sh, int64_t, int);
 SH_GEN_DECL(dict, const char*, int);
 SH_GEN_DICT_IMPL(dict, const char*, int);
 
+SH_GEN_DECL(rh, int64_t, int);
+SH_GEN_RH_HASH_IMPL(rh, int64_t, int);
+
+SH_GEN_DECL(rh_dict, const char*, int);
+SH_GEN_RH_DICT_IMPL(rh_dict, const char*, int);
+
+// Hashmaps where all keys have the same hash, so every key collides with every other key
+SH_GEN_DECL(collide, int, int);
+SH_GEN_IMPL(collide, int, int, 7, a == b, key, 0, calloc(capacity, slot_size), free(ptr));
+
+SH_GEN_DECL(rh_collide, int, int);
+SH_GEN_RH_IMPL(rh_collide, int, int, 7, a == b, key, 0, calloc(capacity, slot_size), free(ptr));
+
+SH_GEN_DECL(swiss, int64_t, int);
+SH_GEN_SWISS_HASH_IMPL(swiss, int64_t, int);
+
+SH_GEN_DECL(swiss_dict, const char*, int);
+SH_GEN_SWISS_DICT_IMPL(swiss_dict, const char*, int);
+
+SH_GEN_DECL(swiss_collide, int, int);
+SH_GEN_SWISS_IMPL(swiss_collide, int, int, 7, a == b, key, 0, calloc(capacity, slot_size), free(ptr));
+
+SH_GEN_SOA_DECL(soa, int64_t, int);
+SH_GEN_SOA_HASH_IMPL(soa, int64_t, int);
+
+SH_GEN_SOA_DECL(soa_dict, const char*, int);
+SH_GEN_SOA_DICT_IMPL(soa_dict, const char*, int);
+
+SH_GEN_STR_DICT_DECL(words, int);
+SH_GEN_STR_DICT_IMPL(words, int);
+
+SH_GEN_ARENA_DICT_DECL(arena_dict, const char*, int);
+SH_GEN_ARENA_DICT_IMPL(arena_dict, const char*, int);
+
+SH_GEN_SSO_DICT_DECL(tags, int);
+SH_GEN_SSO_DICT_IMPL(tags, int);
+
+SH_GEN_INCREMENTAL_DECL(inc, int64_t, int);
+SH_GEN_INCREMENTAL_HASH_IMPL(inc, int64_t, int);
+
+SH_GEN_INCREMENTAL_DECL(inc_dict, const char*, int);
+SH_GEN_INCREMENTAL_DICT_IMPL(inc_dict, const char*, int);
+
+SH_GEN_FROZEN_DECL(sh_frozen, sh, int64_t, int);
+SH_GEN_FROZEN_HASH_IMPL(sh_frozen, sh, int64_t, int);
+
+SH_GEN_FROZEN_DECL(dict_frozen, dict, const char*, int);
+SH_GEN_FROZEN_DICT_IMPL(dict_frozen, dict, const char*, int);
+
+SH_GEN_SET_DECL(set, int64_t);
+SH_GEN_SET_HASH_IMPL(set, int64_t);
+
+SH_GEN_SET_DECL(str_set, const char*);
+SH_GEN_SET_DICT_IMPL(str_set, const char*);
+
+// Hashmap that counts how often keys are hashed
+int hash_counter = 0;
+SH_GEN_DECL(counted, int, int);
+SH_GEN_IMPL(counted, int, int,
+	(hash_counter++, sh_murmur3(&key, sizeof(key), 0)),
+	a == b, key, 0, calloc(capacity, slot_size), free(ptr)
+);
+
 
 void test_new_and_destroy() {
 	sh_t hash;
@@ -36,6 +103,67 @@ void test_put_ptr() {
 	sh_destroy(&hash);
 }
 
+void test_upsert() {
+	counted_t hash;
+	counted_new(&hash);
+	
+	// Each call hashes the key only once
+	hash_counter = 0;
+	bool inserted = false;
+	for(int i = 0; i < 1000; i++)
+		(*counted_upsert(&hash, i % 10, &inserted))++;
+	st_check_int(hash_counter, 1000);
+	st_check_int(hash.length, 10);
+	st_check_int(inserted, false);
+	for(int i = 0; i < 10; i++)
+		st_check_int(counted_get(&hash, i, 0), 100);
+	
+	// A key inserted into a deleted slot starts with a zeroed value
+	counted_del(&hash, 3);
+	int* value = counted_upsert(&hash, 3, &inserted);
+	st_check_int(inserted, true);
+	st_check_int(*value, 0);
+	counted_destroy(&hash);
+	
+	// The key is only duplicated when it's inserted
+	dict_t dict;
+	dict_new(&dict);
+	char key[] = "foo";
+	dict_upsert(&dict, key, &inserted);
+	st_check_int(inserted, true);
+	dict_it_p it = dict_start(&dict);
+	const char* stored_key = it->key;
+	st_check(stored_key != key);
+	dict_upsert(&dict, key, &inserted);
+	st_check_int(inserted, false);
+	st_check(dict_start(&dict)->key == stored_key);
+	dict_destroy(&dict);
+	
+	// Other hashmap variants
+	inc_t inc;
+	soa_t soa;
+	words_t words;
+	inc_new(&inc);
+	soa_new(&soa);
+	words_new(&words);
+	for(int i = 0; i < 10000; i++) {
+		(*inc_upsert(&inc, i % 5000, &inserted))++;
+		(*soa_upsert(&soa, i % 5000, &inserted))++;
+		(*words_upsert_n(&words, "abcdef" + i % 5, 1, &inserted))++;
+	}
+	st_check_int(inc.length, 5000);
+	st_check_int(soa.length, 5000);
+	st_check_int(words.length, 5);
+	for(int i = 0; i < 5000; i++) {
+		st_check_int(inc_get(&inc, i, 0), 2);
+		st_check_int(soa_get(&soa, i, 0), 2);
+	}
+	st_check_int(words_get_n(&words, "c", 1, 0), 2000);
+	inc_destroy(&inc);
+	soa_destroy(&soa);
+	words_destroy(&words);
+}
+
 void test_get_ptr() {
 	sh_t hash;
 	sh_new(&hash);
@@ -243,6 +371,604 @@ void test_dict_update() {
 	dict_destroy(&dict);
 }
 
+void test_put_existing_key() {
+	sh_t hash;
+	sh_new(&hash);
+	
+	int* first_ptr = sh_put_ptr(&hash, 174);
+	int* second_ptr = sh_put_ptr(&hash, 174);
+	st_check(first_ptr == second_ptr);
+	st_check_int(hash.length, 1);
+	
+	sh_destroy(&hash);
+}
+
+void test_put_after_deleted_slot() {
+	collide_t hash;
+	collide_new(&hash);
+	
+	collide_put(&hash, 1, 10);
+	collide_put(&hash, 2, 20);
+	collide_del(&hash, 1);
+	st_check_int(hash.length, 1);
+	
+	// The deleted slot of key 1 is in front of key 2. Putting key 2 again must not reuse it.
+	collide_put(&hash, 2, 30);
+	st_check_int(hash.length, 1);
+	st_check_int(collide_get(&hash, 2, 0), 30);
+	collide_del(&hash, 2);
+	st_check_int(collide_contains(&hash, 2), false);
+	
+	collide_destroy(&hash);
+}
+
+void test_get_and_put_many() {
+	sh_t hash;
+	sh_new(&hash);
+	
+	// More keys than fit into one batch and a duplicate key
+	int64_t keys[40];
+	int values[40];
+	for(size_t i = 0; i < 40; i++) {
+		keys[i] = i * 3;
+		values[i] = i;
+	}
+	keys[39] = 0;
+	
+	bool success = sh_put_many(&hash, keys, values, 40);
+	st_check_int(success, true);
+	st_check_int(hash.length, 39);
+	st_check_int(sh_get(&hash, 0, -1), 39);
+	st_check_int(sh_get(&hash, 3, -1), 1);
+	
+	int64_t lookup_keys[3] = { 3, 4, 114 };
+	int* value_ptrs[3];
+	size_t found = sh_get_many(&hash, lookup_keys, 3, value_ptrs);
+	st_check_int(found, 2);
+	st_check(value_ptrs[0] == sh_get_ptr(&hash, 3));
+	st_check_null(value_ptrs[1]);
+	st_check_int(*value_ptrs[2], 38);
+	
+	sh_destroy(&hash);
+}
+
+void test_swiss_get_and_put_many() {
+	swiss_t hash;
+	swiss_new(&hash);
+	
+	int64_t keys[1000];
+	int values[1000];
+	for(size_t i = 0; i < 1000; i++) {
+		keys[i] = i;
+		values[i] = i * 2;
+	}
+	st_check_int(swiss_put_many(&hash, keys, values, 1000), true);
+	st_check_int(hash.length, 1000);
+	
+	for(size_t i = 0; i < 1000; i++)
+		keys[i] = i * 2;
+	int* value_ptrs[1000];
+	st_check_int(swiss_get_many(&hash, keys, 1000, value_ptrs), 500);
+	for(size_t i = 0; i < 500; i++)
+		st_check_int(*value_ptrs[i], (int)i * 4);
+	for(size_t i = 500; i < 1000; i++)
+		st_check_null(value_ptrs[i]);
+	
+	swiss_destroy(&hash);
+}
+
+void test_soa_get_and_put_many() {
+	soa_t soa;
+	soa_new(&soa);
+	
+	int64_t keys[1000];
+	int values[1000];
+	for(size_t i = 0; i < 1000; i++) {
+		keys[i] = i;
+		values[i] = i * 2;
+	}
+	keys[999] = 0;
+	st_check_int(soa_put_many(&soa, keys, values, 1000), true);
+	st_check_int(soa.length, 999);
+	st_check_int(soa_get(&soa, 0, -1), 999 * 2);
+	
+	for(size_t i = 0; i < 1000; i++)
+		keys[i] = i * 2;
+	int* value_ptrs[1000];
+	st_check_int(soa_get_many(&soa, keys, 1000, value_ptrs), 500);
+	st_check(value_ptrs[1] == soa_get_ptr(&soa, 2));
+	for(size_t i = 1; i < 500; i++)
+		st_check_int(*value_ptrs[i], (int)i * 4);
+	for(size_t i = 500; i < 1000; i++)
+		st_check_null(value_ptrs[i]);
+	
+	soa_destroy(&soa);
+}
+
+void test_incremental_get_and_put_many() {
+	inc_t hash;
+	inc_new(&hash);
+	
+	int64_t keys[1000];
+	int values[1000];
+	for(size_t i = 0; i < 1000; i++) {
+		keys[i] = i;
+		values[i] = i * 3;
+	}
+	
+	// Lookups find keys in the old and the current slots
+	size_t length = 0;
+	while (hash.old_slots == NULL) {
+		inc_put(&hash, length, length * 2);
+		length++;
+	}
+	int* value_ptrs[1000];
+	st_check_int(inc_get_many(&hash, keys, 1000, value_ptrs), length);
+	for(size_t i = 0; i < length; i++)
+		st_check_int(*value_ptrs[i], (int)i * 2);
+	for(size_t i = length; i < 1000; i++)
+		st_check_null(value_ptrs[i]);
+	
+	// The batch grows the hashmap only once, even while items are still moved
+	resize_counter = 0;
+	st_check_int(inc_put_many(&hash, keys, values, 1000), true);
+	st_check_int(resize_counter, 1);
+	st_check_int(hash.length, 1000);
+	for(int64_t i = 0; i < 1000; i++)
+		st_check_int(inc_get(&hash, i, -1), i * 3);
+	
+	inc_destroy(&hash);
+}
+
+void test_new_with_capacity_and_reserve() {
+	sh_t hash;
+	resize_counter = 0;
+	st_check_int(sh_new_with_capacity(&hash, 1000), true);
+	st_check_int(resize_counter, 1);
+	st_check_int(hash.capacity, 2048);
+	
+	for(int i = 0; i < 1000; i++)
+		sh_put(&hash, i, i);
+	st_check_int(resize_counter, 1);
+	st_check_int(hash.capacity, 2048);
+	
+	// Reserving less than the capacity does nothing, more grows the hashmap once
+	st_check_int(sh_reserve(&hash, 10), true);
+	st_check_int(resize_counter, 1);
+	st_check_int(sh_reserve(&hash, 5000), true);
+	st_check_int(resize_counter, 2);
+	st_check_int(hash.capacity, 16384);
+	for(int i = 1000; i < 5000; i++)
+		sh_put(&hash, i, i);
+	st_check_int(resize_counter, 2);
+	for(int i = 0; i < 5000; i++)
+		st_check_int(sh_get(&hash, i, -1), i);
+	
+	sh_destroy(&hash);
+	
+	sh_new(&hash);
+	st_check_int(hash.capacity, 8);
+	sh_destroy(&hash);
+}
+
+void test_build_from_arrays() {
+	const char* keys[4] = { "a", "b", "c", "a" };
+	int values[4] = { 1, 2, 3, 4 };
+	
+	dict_t dict;
+	resize_counter = 0;
+	st_check_int(dict_build_from_arrays(&dict, keys, values, 4), true);
+	st_check_int(resize_counter, 1);
+	st_check_int(dict.length, 3);
+	st_check_int(dict_get(&dict, "a", 0), 4);
+	st_check_int(dict_get(&dict, "b", 0), 2);
+	st_check_int(dict_get(&dict, "c", 0), 3);
+	dict_destroy(&dict);
+	
+	int64_t int_keys[1000];
+	int int_values[1000];
+	for(size_t i = 0; i < 1000; i++) {
+		int_keys[i] = i * 7;
+		int_values[i] = i;
+	}
+	
+	inc_t inc;
+	resize_counter = 0;
+	st_check_int(inc_build_from_arrays(&inc, int_keys, int_values, 1000), true);
+	st_check_int(resize_counter, 1);
+	st_check_int(inc.length, 1000);
+	st_check_null(inc.old_slots);
+	for(size_t i = 0; i < 1000; i++)
+		st_check_int(inc_get(&inc, i * 7, -1), (int)i);
+	inc_destroy(&inc);
+	
+	soa_t soa;
+	resize_counter = 0;
+	st_check_int(soa_build_from_arrays(&soa, int_keys, int_values, 1000), true);
+	st_check_int(resize_counter, 1);
+	st_check_int(soa.length, 1000);
+	for(size_t i = 0; i < 1000; i++)
+		st_check_int(soa_get(&soa, i * 7, -1), (int)i);
+	soa_destroy(&soa);
+}
+
+// A failed new_with_capacity() leaves a hashmap without any slots. It still has to work.
+#define CHECK_FAILED_NEW_WITH_CAPACITY(prefix) do {                       \
+	prefix##_t map;                                                       \
+	st_check_int(prefix##_new_with_capacity(&map, SIZE_MAX), false);      \
+	st_check_int(map.capacity, 0);                                        \
+	st_check_int(prefix##_contains(&map, 5), false);                      \
+	st_check_null(prefix##_get_ptr(&map, 5));                             \
+	st_check_int(prefix##_get(&map, 5, -1), -1);                          \
+	st_check_int(prefix##_del(&map, 5), false);                           \
+	                                                                      \
+	prefix##_put(&map, 5, 7);                                             \
+	st_check_int(prefix##_get(&map, 5, -1), 7);                           \
+	prefix##_destroy(&map);                                               \
+} while(0)
+
+void test_failed_new_with_capacity() {
+	CHECK_FAILED_NEW_WITH_CAPACITY(sh);
+	CHECK_FAILED_NEW_WITH_CAPACITY(rh);
+	CHECK_FAILED_NEW_WITH_CAPACITY(swiss);
+	CHECK_FAILED_NEW_WITH_CAPACITY(soa);
+	CHECK_FAILED_NEW_WITH_CAPACITY(inc);
+	
+	int64_t keys[3] = { 1, 2, 3 };
+	int* values[3] = { NULL, NULL, NULL };
+	sh_t hash;
+	st_check_int(sh_new_with_capacity(&hash, SIZE_MAX), false);
+	st_check_int(sh_get_many(&hash, keys, 3, values), 0);
+	st_check_null(values[0]);
+	sh_destroy(&hash);
+	
+	set_t set;
+	st_check_int(set_new_with_capacity(&set, SIZE_MAX), false);
+	st_check_int(set_contains(&set, 5), false);
+	st_check_int(set_del(&set, 5), false);
+	st_check_int(set_insert(&set, 5), true);
+	st_check_int(set_contains(&set, 5), true);
+	set_destroy(&set);
+}
+
+void test_resize_reuses_hashes() {
+	counted_t hash;
+	hash_counter = 0;
+	resize_counter = 0;
+	counted_new(&hash);
+	st_check_int(resize_counter, 1);
+	
+	for(int i = 0; i < 100; i++)
+		counted_put(&hash, i, i*2);
+	st_check(resize_counter > 1);
+	st_check_int(hash_counter, 100);
+	
+	for(int i = 0; i < 100; i++)
+		st_check_int(counted_get(&hash, i, -1), i*2);
+	
+	for(int i = 0; i < 100; i++)
+		counted_del(&hash, i);
+	st_check(hash.capacity < 100);
+	st_check_int(hash_counter, 300);
+	
+	counted_destroy(&hash);
+}
+
+void test_incremental_resize() {
+	inc_t hash;
+	inc_new(&hash);
+	
+	// Fill the hashmap until it starts to grow with more old slots than a put moves
+	int64_t key = 0;
+	while (hash.old_slots == NULL || hash.old_capacity <= SH_MIGRATE_SLOTS) {
+		inc_put(&hash, key, key * 2);
+		key++;
+	}
+	st_check_int(hash.migrated, 0);
+	st_check_int(hash.length, key);
+	
+	// Each put moves a limited number of old slots
+	inc_put(&hash, key, key * 2);
+	key++;
+	st_check_int(hash.migrated, SH_MIGRATE_SLOTS);
+	
+	// Items in old and current slots are found and iterated over
+	for(int64_t i = 0; i < key; i++)
+		st_check_int(inc_get(&hash, i, -1), i * 2);
+	uint32_t count = 0;
+	for(inc_it_p it = inc_start(&hash); it != NULL; it = inc_next(&hash, it))
+		count++;
+	st_check_int(count, hash.length);
+	
+	// Keep going until all old slots are moved
+	while (hash.old_slots != NULL) {
+		inc_put(&hash, key, key * 2);
+		key++;
+	}
+	st_check_int(hash.length, key);
+	for(int64_t i = 0; i < key; i++)
+		st_check_int(inc_get(&hash, i, -1), i * 2);
+	
+	inc_destroy(&hash);
+}
+
+// Inserts and deletes pseudo random keys and compares the hashmap against a plain array. key_range
+// can use the operation index i to grow and shrink the hashmap over time.
+#define CHECK_CHURN(prefix, hash, key_count, op_count, key_range) do {    \
+	int reference[key_count];                                             \
+	for(size_t i = 0; i < key_count; i++)                                 \
+		reference[i] = -1;                                                \
+                                                                          \
+	uint32_t random = 1;                                                  \
+	for(size_t i = 0; i < op_count; i++) {                                \
+		random = random * 1103515245 + 12345;                             \
+		int64_t key = (random >> 8) % (key_range);                        \
+		if ((random >> 4) % 3 == 0) {                                     \
+			bool was_found = prefix##_del(&(hash), key);                  \
+			st_check_int(was_found, reference[key] != -1);                \
+			reference[key] = -1;                                          \
+		} else {                                                          \
+			prefix##_put(&(hash), key, i);                                \
+			reference[key] = i;                                           \
+		}                                                                 \
+	}                                                                     \
+                                                                          \
+	uint32_t length = 0;                                                  \
+	for(size_t i = 0; i < key_count; i++) {                               \
+		st_check_int(prefix##_get(&(hash), i, -1), reference[i]);         \
+		st_check_int(prefix##_contains(&(hash), i), reference[i] != -1);  \
+		if (reference[i] != -1)                                           \
+			length++;                                                     \
+	}                                                                     \
+	st_check_int((hash).length, length);                                  \
+} while(0)
+
+// Replaces, deletes and keeps string keys of a dict
+#define CHECK_DICT(prefix, dict) do {                                     \
+	prefix##_put(&(dict), "a", 1);                                        \
+	prefix##_put(&(dict), "b", 2);                                        \
+	prefix##_put(&(dict), "a", 3);                                        \
+	st_check_int((dict).length, 2);                                       \
+	st_check_int(prefix##_get(&(dict), "a", 0), 3);                       \
+	st_check_int(prefix##_get(&(dict), "b", 0), 2);                       \
+                                                                          \
+	prefix##_del(&(dict), "a");                                           \
+	st_check_int(prefix##_contains(&(dict), "a"), false);                 \
+	st_check_int(prefix##_get(&(dict), "b", 0), 2);                       \
+} while(0)
+
+void test_incremental_churn() {
+	inc_t hash;
+	inc_new(&hash);
+	// Grow and shrink the hashmap every few thousand operations
+	CHECK_CHURN(inc, hash, 4096, 50000, (i / 5000) % 2 ? 4096 : 256);
+	inc_destroy(&hash);
+}
+
+void test_incremental_remove_during_iteration() {
+	inc_t hash;
+	inc_new(&hash);
+	
+	int64_t key = 0;
+	while (hash.old_slots == NULL) {
+		inc_put(&hash, key, key * 2);
+		key++;
+	}
+	
+	for(inc_it_p it = inc_start(&hash); it != NULL; it = inc_next(&hash, it)) {
+		if (it->key % 2 == 1)
+			inc_remove(&hash, it);
+	}
+	st_check_int(hash.length, (key + 1) / 2);
+	for(int64_t i = 0; i < key; i++)
+		st_check_int(inc_get(&hash, i, -1), (i % 2 == 0) ? i*2 : -1);
+	
+	inc_destroy(&hash);
+}
+
+void test_incremental_dict() {
+	inc_dict_t dict;
+	inc_dict_new(&dict);
+	CHECK_DICT(inc_dict, dict);
+	
+	char key[16];
+	for(int i = 0; i < 100; i++) {
+		snprintf(key, sizeof(key), "key %d", i);
+		inc_dict_put(&dict, key, i);
+	}
+	for(int i = 0; i < 100; i += 2) {
+		snprintf(key, sizeof(key), "key %d", i);
+		inc_dict_put(&dict, key, i * 10);
+	}
+	st_check_int(dict.length, 101);
+	st_check_int(inc_dict_get(&dict, "key 4", -1), 40);
+	st_check_int(inc_dict_get(&dict, "key 5", -1), 5);
+	
+	inc_dict_del(&dict, "key 4");
+	st_check_int(inc_dict_contains(&dict, "key 4"), false);
+	
+	// Destroy while items are still moved
+	inc_dict_destroy(&dict);
+}
+
+void test_rh_churn() {
+	rh_t hash;
+	rh_new(&hash);
+	CHECK_CHURN(rh, hash, 512, 20000, 512);
+	// Backward shift deletion never leaves deleted slots behind
+	st_check_int(hash.deleted, 0);
+	rh_destroy(&hash);
+}
+
+void test_rh_collisions() {
+	rh_collide_t hash;
+	rh_collide_new(&hash);
+	
+	rh_collide_put(&hash, 1, 10);
+	rh_collide_put(&hash, 2, 20);
+	rh_collide_put(&hash, 3, 30);
+	
+	// Deleting the first key of the probe chain shifts the others back
+	rh_collide_del(&hash, 1);
+	st_check_int(hash.length, 2);
+	st_check_int(hash.deleted, 0);
+	st_check_int(rh_collide_get(&hash, 1, 0), 0);
+	st_check_int(rh_collide_get(&hash, 2, 0), 20);
+	st_check_int(rh_collide_get(&hash, 3, 0), 30);
+	
+	rh_collide_put(&hash, 3, 31);
+	st_check_int(hash.length, 2);
+	st_check_int(rh_collide_get(&hash, 3, 0), 31);
+	
+	rh_collide_destroy(&hash);
+}
+
+void test_rh_remove_during_iteration() {
+	rh_t hash;
+	rh_new(&hash);
+	
+	for(int64_t i = 0; i < 20; i++)
+		rh_put(&hash, i, i*2);
+	
+	for(rh_it_p it = rh_start(&hash); it != NULL; it = rh_next(&hash, it)) {
+		if (it->key % 2 == 1)
+			rh_remove(&hash, it);
+	}
+	st_check_int(hash.length, 10);
+	
+	// Deleting keys next to the slots left behind by rh_remove() must not cut off other keys
+	for(int64_t i = 0; i < 20; i += 4)
+		rh_del(&hash, i);
+	for(int64_t i = 0; i < 20; i++)
+		st_check_int(rh_get(&hash, i, -1), (i % 4 == 2) ? i*2 : -1);
+	
+	// Putting keys has to look past the deleted slots before it reuses one
+	bool inserted = true;
+	*rh_upsert(&hash, 6, &inserted) = 7;
+	st_check_int(inserted, false);
+	st_check_int(hash.length, 5);
+	*rh_upsert(&hash, 3, &inserted) = 9;
+	st_check_int(inserted, true);
+	st_check_int(hash.length, 6);
+	for(int64_t i = 0; i < 20; i++)
+		st_check_int(rh_get(&hash, i, -1), (i == 6) ? 7 : (i == 3) ? 9 : (i % 4 == 2) ? i*2 : -1);
+	
+	rh_destroy(&hash);
+}
+
+void test_rh_dict() {
+	rh_dict_t dict;
+	rh_dict_new(&dict);
+	CHECK_DICT(rh_dict, dict);
+	rh_dict_destroy(&dict);
+}
+
+void test_swiss_churn() {
+	swiss_t hash;
+	swiss_new(&hash);
+	// Large enough to use many groups of control bytes
+	CHECK_CHURN(swiss, hash, 4096, 50000, 4096);
+	
+	uint32_t length = 0;
+	for(swiss_it_p it = swiss_start(&hash); it != NULL; it = swiss_next(&hash, it))
+		length++;
+	st_check_int(hash.length, length);
+	
+	swiss_destroy(&hash);
+}
+
+void test_swiss_collisions() {
+	swiss_collide_t hash;
+	swiss_collide_new(&hash);
+	
+	// All keys have the same control byte and fill up more than one group
+	for(int i = 0; i < 40; i++)
+		swiss_collide_put(&hash, i, i*2);
+	st_check_int(hash.length, 40);
+	for(int i = 0; i < 40; i++)
+		st_check_int(swiss_collide_get(&hash, i, -1), i*2);
+	
+	for(int i = 0; i < 40; i += 2)
+		swiss_collide_del(&hash, i);
+	st_check_int(hash.length, 20);
+	for(int i = 0; i < 40; i++)
+		st_check_int(swiss_collide_get(&hash, i, -1), (i % 2 == 1) ? i*2 : -1);
+	
+	swiss_collide_put(&hash, 1, 7);
+	st_check_int(hash.length, 20);
+	st_check_int(swiss_collide_get(&hash, 1, -1), 7);
+	
+	swiss_collide_destroy(&hash);
+}
+
+void test_swiss_remove_during_iteration() {
+	swiss_t hash;
+	swiss_new(&hash);
+	
+	for(int64_t i = 0; i < 20; i++)
+		swiss_put(&hash, i, i*2);
+	
+	for(swiss_it_p it = swiss_start(&hash); it != NULL; it = swiss_next(&hash, it)) {
+		if (it->key % 2 == 1)
+			swiss_remove(&hash, it);
+	}
+	st_check_int(hash.length, 10);
+	for(int64_t i = 0; i < 20; i++)
+		st_check_int(swiss_get(&hash, i, -1), (i % 2 == 0) ? i*2 : -1);
+	
+	swiss_destroy(&hash);
+}
+
+void test_swiss_dict() {
+	swiss_dict_t dict;
+	swiss_dict_new(&dict);
+	CHECK_DICT(swiss_dict, dict);
+	swiss_dict_destroy(&dict);
+}
+
+void test_soa_churn() {
+	soa_t hash;
+	soa_new(&hash);
+	CHECK_CHURN(soa, hash, 512, 20000, 512);
+	soa_destroy(&hash);
+}
+
+void test_soa_iteration() {
+	soa_t hash;
+	soa_new(&hash);
+	
+	uint32_t start = soa_start(&hash);
+	st_check_int(start, hash.capacity);
+	
+	for(int64_t i = 0; i < 20; i++)
+		soa_put(&hash, i, i*2);
+	
+	uint32_t count = 0;
+	for(uint32_t i = soa_start(&hash); i < hash.capacity; i = soa_next(&hash, i)) {
+		st_check_int(hash.values[i], hash.keys[i] * 2);
+		if (hash.keys[i] % 2 == 1)
+			soa_remove(&hash, i);
+		count++;
+	}
+	st_check_int(count, 20);
+	st_check_int(hash.length, 10);
+	for(int64_t i = 0; i < 20; i++)
+		st_check_int(soa_get(&hash, i, -1), (i % 2 == 0) ? i*2 : -1);
+	
+	soa_destroy(&hash);
+	st_check_int(hash.capacity, 0);
+	st_check_null(hash.hashes);
+	st_check_null(hash.keys);
+	st_check_null(hash.values);
+}
+
+void test_soa_dict() {
+	soa_dict_t dict;
+	soa_dict_new(&dict);
+	CHECK_DICT(soa_dict, dict);
+	soa_dict_destroy(&dict);
+}
+
 // Key expression test, make sure key_put_expr and key_del_expr are called properly
 int ket_put_counter = 0;
 int ket_del_counter = 0;
@@ -258,6 +984,560 @@ SH_GEN_IMPL(ket_hash, int, int,
 );
 
 
+void test_str_dict() {
+	// Count the words of a buffer without copying or terminating them
+	const char* text = "foo bar foo baz foobar foo";
+	words_t words;
+	words_new(&words);
+	
+	const char* start = text;
+	while (*start != '\0') {
+		const char* end = start;
+		while (*end != ' ' && *end != '\0')
+			end++;
+		(*words_put_ptr_n(&words, start, end - start))++;
+		start = (*end == ' ') ? end + 1 : end;
+	}
+	
+	st_check_int(words.length, 4);
+	st_check_int(words_get_n(&words, "foo", 3, 0), 3);
+	st_check_int(words_get_n(&words, "foobar", 6, 0), 1);
+	st_check_int(words_get_n(&words, "foobar", 3, 0), 3);
+	st_check_int(words_get_n(&words, "foobar", 2, 0), 0);
+	st_check_int(words_get(&words, sh_str_n("baz", 3), 0), 1);
+	st_check_int(words_contains_n(&words, text + 4, 3), true);
+	st_check_int(words_contains_n(&words, "", 0), false);
+	
+	// Keys can contain zero bytes, the length tells them apart
+	words_put_n(&words, "a\0b", 3, 7);
+	words_put_n(&words, "a", 1, 8);
+	st_check_int(words_get_n(&words, "a\0b", 3, 0), 7);
+	st_check_int(words_get_n(&words, "a", 1, 0), 8);
+	
+	// Stored keys are copies and zero terminated
+	for(words_it_p it = words_start(&words); it; it = words_next(&words, it)) {
+		st_check(it->key.ptr < text || it->key.ptr > text + strlen(text));
+		st_check_int(it->key.ptr[it->key.length], '\0');
+	}
+	
+	st_check_int(words_del_n(&words, "bar", 3), true);
+	st_check_int(words_del_n(&words, "bar", 3), false);
+	st_check_int(words.length, 5);
+	
+	words_destroy(&words);
+}
+
+void test_arena_dict() {
+	arena_dict_t dict;
+	arena_dict_new(&dict);
+	
+	char key[16];
+	for(int i = 0; i < 10000; i++) {
+		snprintf(key, sizeof(key), "key %d", i);
+		arena_dict_put(&dict, key, i);
+	}
+	st_check_int(dict.length, 10000);
+	st_check_not_null(dict.arena);
+	st_check_not_null(dict.arena->next);
+	
+	// Keys are copies in the arena
+	arena_dict_it_p it = arena_dict_start(&dict);
+	st_check(it->key != key);
+	
+	for(int i = 0; i < 10000; i += 2) {
+		snprintf(key, sizeof(key), "key %d", i);
+		st_check_int(arena_dict_del(&dict, key), true);
+	}
+	
+	st_check_int(arena_dict_compact_keys(&dict), true);
+	st_check_null(dict.arena->next);
+	for(int i = 0; i < 10000; i++) {
+		snprintf(key, sizeof(key), "key %d", i);
+		st_check_int(arena_dict_get(&dict, key, -1), (i % 2 == 0) ? -1 : i);
+	}
+	
+	arena_dict_put(&dict, "new key", 1);
+	st_check_int(arena_dict_get(&dict, "new key", -1), 1);
+	
+	arena_dict_destroy(&dict);
+	st_check_null(dict.arena);
+}
+
+// Same as SH_GEN_ARENA_DICT_IMPL() but counts how often key_del_expr is executed
+int arena_del_counter = 0;
+
+SH_GEN_ARENA_DICT_DECL(counted_arena, const char*, int);
+SH_GEN_LINEAR_PROBING(counted_arena, const char*, int, (strcmp(a, b) == 0))
+SH_GEN_MAP_FUNCTIONS(counted_arena, const char*, int,
+	sh_bytes_hash(key, strlen(key)),
+	sh_arena_strdup(&hashmap->arena, key),
+	(arena_del_counter++, NULL),
+	calloc(capacity, slot_size),
+	free(ptr),
+	sh_arena_free(&hashmap->arena),
+	false,
+	SH_GEN_NO_MMAP_FUNCTIONS
+)
+
+void test_arena_dict_destroy() {
+	counted_arena_t dict;
+	counted_arena_new(&dict);
+	
+	char key[16];
+	for(int i = 0; i < 1000; i++) {
+		snprintf(key, sizeof(key), "key %d", i);
+		counted_arena_put(&dict, key, i);
+	}
+	counted_arena_del(&dict, "key 5");
+	st_check_int(arena_del_counter, 1);
+	
+	// Destroying just frees the arena, the keys are never looked at
+	counted_arena_destroy(&dict);
+	st_check_int(arena_del_counter, 1);
+	st_check_null(dict.arena);
+	st_check_null(dict.slots);
+}
+
+void test_sso_dict() {
+	tags_t tags;
+	tags_new(&tags);
+	
+	const char* long_key = "a key that is too long to be stored inline";
+	tags_put(&tags, sh_sso_from("de"), 1);
+	tags_put(&tags, sh_sso_from("fifteen chars.."), 2);
+	tags_put(&tags, sh_sso_from("sixteen chars..."), 3);
+	tags_put(&tags, sh_sso_from(long_key), 4);
+	st_check_int(tags.length, 4);
+	
+	st_check_int(tags_get(&tags, sh_sso_from("de"), 0), 1);
+	st_check_int(tags_get(&tags, sh_sso_from("fifteen chars.."), 0), 2);
+	st_check_int(tags_get(&tags, sh_sso_from("sixteen chars..."), 0), 3);
+	st_check_int(tags_get(&tags, sh_sso_from("a key that is too long to be stored inline"), 0), 4);
+	st_check_int(tags_get(&tags, sh_sso_from("d"), 0), 0);
+	st_check_int(tags_get(&tags, sh_sso_from("sixteen chars..!"), 0), 0);
+	
+	// Short keys are stored inline, long keys are copied
+	for(tags_it_p it = tags_start(&tags); it; it = tags_next(&tags, it)) {
+		const char* str = sh_sso_chars(&it->key);
+		if (strlen(str) < SH_SSO_SIZE) {
+			st_check(!sh_sso_is_long(&it->key));
+			st_check(str == it->key.bytes);
+		} else {
+			st_check(sh_sso_is_long(&it->key));
+			st_check(str != long_key);
+		}
+	}
+	
+	st_check_int(tags_del(&tags, sh_sso_from(long_key)), true);
+	st_check_int(tags_del(&tags, sh_sso_from("de")), true);
+	st_check_int(tags_contains(&tags, sh_sso_from(long_key)), false);
+	st_check_int(tags.length, 2);
+	
+	char key[32];
+	for(int i = 0; i < 1000; i++) {
+		snprintf(key, sizeof(key), (i % 2) ? "%d" : "a longer key number %d", i);
+		tags_put(&tags, sh_sso_from(key), i);
+	}
+	for(int i = 0; i < 1000; i++) {
+		snprintf(key, sizeof(key), (i % 2) ? "%d" : "a longer key number %d", i);
+		st_check_int(tags_get(&tags, sh_sso_from(key), -1), i);
+	}
+	
+	tags_destroy(&tags);
+}
+
+void test_load_factors() {
+	sh_t map;
+	sh_new(&map);
+	
+	// Invalid arguments are rejected and the defaults stay
+	st_check_int(sh_set_load_factors(&map, 1.0, 0.25, 2), false);
+	st_check_int(sh_set_load_factors(&map, 0.5, 0.5, 2), false);
+	st_check_int(sh_set_load_factors(&map, 0.5, 0.25, 3), false);
+	st_check(map.max_load == (float)SH_MAX_LOAD && map.growth_factor == SH_GROWTH_FACTOR);
+	
+	// Run at a high load, grow by 4 and never shrink
+	st_check_int(sh_set_load_factors(&map, 0.875, 0, 4), true);
+	for(int i = 0; i < 7; i++)
+		sh_put(&map, i, i);
+	st_check_int(map.capacity, 8);
+	sh_put(&map, 7, 7);
+	st_check_int(map.capacity, 32);
+	for(int i = 8; i < 28; i++)
+		sh_put(&map, i, i);
+	st_check_int(map.capacity, 32);
+	for(int i = 0; i < 28; i++)
+		st_check_int(sh_get(&map, i, -1), i);
+	
+	// Lowering max_load grows the hashmap right away
+	st_check_int(sh_set_load_factors(&map, 0.5, 0, 2), true);
+	st_check_int(map.capacity, 64);
+	for(int i = 0; i < 28; i++)
+		st_check_int(sh_get(&map, i, -1), i);
+	for(int i = 0; i < 28; i++)
+		sh_del(&map, i);
+	st_check_int(map.length, 0);
+	st_check_int(map.capacity, 64);
+	sh_destroy(&map);
+	
+	// Hysteresis: adding and removing an item around the shrink boundary doesn't resize back and
+	// forth. Robin Hood hashing doesn't leave deleted slots behind so there is no resizing at all.
+	rh_t rh_map;
+	rh_new(&rh_map);
+	for(int i = 0; i < 32; i++)
+		rh_put(&rh_map, i, i);
+	for(int i = 15; i < 32; i++)
+		rh_del(&rh_map, i);
+	st_check_int(rh_map.capacity, 64);
+	resize_counter = 0;
+	for(int i = 0; i < 100; i++) {
+		rh_put(&rh_map, 15, 15);
+		rh_del(&rh_map, 15);
+	}
+	st_check_int(resize_counter, 0);
+	st_check_int(rh_map.capacity, 64);
+	rh_destroy(&rh_map);
+	
+	// With linear probing deleted slots pile up, the hashmap is rebuilt but doesn't grow
+	sh_new_with_capacity(&map, 16);
+	for(int i = 0; i < 7; i++)
+		sh_put(&map, i, i);
+	st_check_int(map.capacity, 32);
+	for(int i = 0; i < 1000; i++) {
+		sh_put(&map, 100 + i, i);
+		sh_del(&map, 100 + i);
+	}
+	st_check_int(map.capacity, 32);
+	for(int i = 0; i < 7; i++)
+		st_check_int(sh_get(&map, i, -1), i);
+	sh_destroy(&map);
+	
+	// The other probing schemes and hashmap layouts at a load of 0.9
+	rh_new(&rh_map);
+	swiss_t swiss_map;
+	swiss_new(&swiss_map);
+	inc_t inc_map;
+	inc_new(&inc_map);
+	soa_t soa_map;
+	soa_new(&soa_map);
+	st_check_int(rh_set_load_factors(&rh_map, 0.9, 0.2, 2), true);
+	st_check_int(swiss_set_load_factors(&swiss_map, 0.9, 0.2, 2), true);
+	st_check_int(inc_set_load_factors(&inc_map, 0.9, 0.2, 2), true);
+	st_check_int(soa_set_load_factors(&soa_map, 0.9, 0.2, 2), true);
+	for(int i = 0; i < 900; i++) {
+		rh_put(&rh_map, i, i);
+		swiss_put(&swiss_map, i, i);
+		inc_put(&inc_map, i, i);
+		soa_put(&soa_map, i, i);
+	}
+	st_check_int(rh_map.capacity, 1024);
+	st_check_int(swiss_map.capacity, 1024);
+	st_check_int(inc_map.capacity, 1024);
+	st_check_int(soa_map.capacity, 1024);
+	for(int i = 0; i < 1000; i++) {
+		int expected = (i < 900) ? i : -1;
+		st_check_int(rh_get(&rh_map, i, -1), expected);
+		st_check_int(swiss_get(&swiss_map, i, -1), expected);
+		st_check_int(inc_get(&inc_map, i, -1), expected);
+		st_check_int(soa_get(&soa_map, i, -1), expected);
+	}
+	for(int i = 0; i < 900; i++) {
+		rh_del(&rh_map, i);
+		swiss_del(&swiss_map, i);
+		inc_del(&inc_map, i);
+		soa_del(&soa_map, i);
+	}
+	st_check_int(rh_map.capacity, 8);
+	st_check_int(swiss_map.capacity, 8);
+	st_check_int(inc_map.capacity, 8);
+	st_check_int(soa_map.capacity, 8);
+	rh_destroy(&rh_map);
+	swiss_destroy(&swiss_map);
+	inc_destroy(&inc_map);
+	soa_destroy(&soa_map);
+}
+
+void add(int* dst_value, int src_value, void* data) {
+	*dst_value += src_value;
+	data = data;  // avoid unused variable warning
+}
+
+void test_merge() {
+	// Word counts of two threads, the keys of src are copied so src can be destroyed
+	dict_t dst, src;
+	dict_new(&dst);
+	dict_new(&src);
+	dict_put(&dst, "a", 1);
+	dict_put(&dst, "b", 2);
+	char key[32];
+	strcpy(key, "b");
+	dict_put(&src, key, 10);
+	strcpy(key, "c");
+	dict_put(&src, key, 20);
+	
+	st_check_int(dict_merge(&dst, &src, add, NULL), true);
+	dict_destroy(&src);
+	st_check_int(dst.length, 3);
+	st_check_int(dict_get(&dst, "a", -1), 1);
+	st_check_int(dict_get(&dst, "b", -1), 12);
+	st_check_int(dict_get(&dst, "c", -1), 20);
+	dict_destroy(&dst);
+	
+	// Without combine function the values of src win, dst grows as needed
+	rh_t rh_dst, rh_src;
+	rh_new(&rh_dst);
+	rh_new(&rh_src);
+	for(int i = 0; i < 1000; i++) {
+		rh_put(&rh_dst, i, 1);
+		rh_put(&rh_src, i + 500, 2);
+	}
+	st_check_int(rh_merge(&rh_dst, &rh_src, NULL, NULL), true);
+	st_check_int(rh_dst.length, 1500);
+	for(int i = 0; i < 1500; i++)
+		st_check_int(rh_get(&rh_dst, i, -1), (i < 500) ? 1 : 2);
+	rh_destroy(&rh_dst);
+	rh_destroy(&rh_src);
+	
+	// Incremental hashmaps in the middle of a resize, items in the old slots are merged as well
+	inc_t inc_dst, inc_src;
+	inc_new(&inc_dst);
+	inc_new(&inc_src);
+	int64_t count = 0;
+	while (inc_src.old_slots == NULL || inc_dst.old_slots == NULL) {
+		inc_put(&inc_src, count, 1);
+		inc_put(&inc_dst, count * 2, 1);
+		count++;
+	}
+	st_check_int(inc_merge(&inc_dst, &inc_src, add, NULL), true);
+	uint32_t length = 0;
+	for(int64_t i = 0; i < count * 2; i++) {
+		int expected = (i < count) + (i % 2 == 0);
+		st_check_int(inc_get(&inc_dst, i, 0), expected);
+		length += (expected > 0);
+	}
+	st_check_int(inc_dst.length, length);
+	inc_destroy(&inc_dst);
+	inc_destroy(&inc_src);
+	
+	soa_dict_t soa_dst, soa_src;
+	soa_dict_new(&soa_dst);
+	soa_dict_new(&soa_src);
+	for(int i = 0; i < 100; i++) {
+		snprintf(key, sizeof(key), "key %d", i);
+		soa_dict_put((i < 50) ? &soa_dst : &soa_src, key, i);
+		soa_dict_put(&soa_src, key, 1);
+	}
+	st_check_int(soa_dict_merge(&soa_dst, &soa_src, add, NULL), true);
+	soa_dict_destroy(&soa_src);
+	st_check_int(soa_dst.length, 100);
+	for(int i = 0; i < 100; i++) {
+		snprintf(key, sizeof(key), "key %d", i);
+		st_check_int(soa_dict_get(&soa_dst, key, -1), (i < 50) ? i + 1 : 1);
+	}
+	soa_dict_destroy(&soa_dst);
+}
+
+void test_frozen() {
+	sh_t hash;
+	sh_new(&hash);
+	for(int64_t i = 0; i < 100000; i++)
+		sh_put(&hash, i * 3, i);
+	
+	sh_frozen_t frozen;
+	st_check_int(sh_frozen_build(&frozen, &hash), true);
+	st_check_int(frozen.length, 100000);
+	sh_destroy(&hash);
+	
+	for(int64_t i = 0; i < 300000; i++)
+		st_check_int(sh_frozen_get(&frozen, i, -1), (i % 3 == 0) ? i / 3 : -1);
+	st_check_int(sh_frozen_contains(&frozen, -3), false);
+	*sh_frozen_get_ptr(&frozen, 3) = 7;
+	st_check_int(sh_frozen_get(&frozen, 3, -1), 7);
+	
+	// Every item is used by exactly one key
+	int64_t sum = 0;
+	for(size_t i = 0; i < frozen.length; i++)
+		sum += frozen.items[i].key;
+	st_check(sum == (int64_t)3 * 99999 * 100000 / 2);
+	sh_frozen_destroy(&frozen);
+	st_check_null(frozen.items);
+	
+	// Empty hashmap
+	sh_new(&hash);
+	st_check_int(sh_frozen_build(&frozen, &hash), true);
+	st_check_int(sh_frozen_get(&frozen, 1, -1), -1);
+	sh_frozen_destroy(&frozen);
+	sh_destroy(&hash);
+}
+
+void test_frozen_dict() {
+	dict_t dict;
+	dict_new(&dict);
+	char key[32];
+	for(int i = 0; i < 1000; i++) {
+		snprintf(key, sizeof(key), "key %d", i);
+		dict_put(&dict, key, i);
+	}
+	
+	// The frozen table has its own copies of the keys
+	dict_frozen_t frozen;
+	st_check_int(dict_frozen_build(&frozen, &dict), true);
+	dict_destroy(&dict);
+	
+	for(int i = 0; i < 2000; i++) {
+		snprintf(key, sizeof(key), "key %d", i);
+		st_check_int(dict_frozen_get(&frozen, key, -1), (i < 1000) ? i : -1);
+	}
+	dict_frozen_destroy(&frozen);
+}
+
+void test_set() {
+	set_t set;
+	set_new(&set);
+	st_check_int(sizeof(set.slots[0]), 16);
+	
+	for(int64_t i = 0; i < 10000; i++)
+		st_check_int(set_insert(&set, i * 3), true);
+	st_check_int(set_insert(&set, 0), false);
+	st_check_int(set.length, 10000);
+	for(int64_t i = 0; i < 30000; i++)
+		st_check_int(set_contains(&set, i), i % 3 == 0);
+	
+	for(int64_t i = 0; i < 10000; i += 2)
+		st_check_int(set_del(&set, i * 3), true);
+	st_check_int(set_del(&set, 0), false);
+	st_check_int(set.length, 5000);
+	
+	int count = 0;
+	for(set_it_p it = set_start(&set); it != NULL; it = set_next(&set, it)) {
+		st_check_int(it->key % 6, 3);
+		set_remove(&set, it);
+		count++;
+	}
+	st_check_int(count, 5000);
+	st_check_int(set.length, 0);
+	st_check_int(set_shrink_if_necessary(&set), true);
+	
+	set_destroy(&set);
+}
+
+void test_set_union_and_intersect() {
+	set_t a, b;
+	set_new(&a);
+	set_new(&b);
+	for(int64_t i = 0; i < 1000; i++) {
+		set_insert(&a, i * 2);
+		set_insert(&b, i * 3);
+	}
+	
+	set_t both;
+	set_new(&both);
+	st_check_int(set_union(&both, &a), true);
+	st_check_int(set_union(&both, &b), true);
+	st_check_int(both.length, 1000 + 1000 - 334);
+	for(int64_t i = 0; i < 3000; i++)
+		st_check_int(set_contains(&both, i), (i < 2000 && i % 2 == 0) || i % 3 == 0);
+	
+	set_intersect(&a, &b);
+	st_check_int(a.length, 334);
+	for(int64_t i = 0; i < 3000; i++)
+		st_check_int(set_contains(&a, i), i < 2000 && i % 6 == 0);
+	st_check_int(b.length, 1000);
+	
+	// Intersecting with an empty set removes everything
+	set_t empty;
+	set_new(&empty);
+	set_intersect(&both, &empty);
+	st_check_int(both.length, 0);
+	
+	set_destroy(&a);
+	set_destroy(&b);
+	set_destroy(&both);
+	set_destroy(&empty);
+}
+
+void test_str_set() {
+	str_set_t a, b;
+	str_set_new(&a);
+	str_set_new(&b);
+	char key[32];
+	for(int i = 0; i < 100; i++) {
+		snprintf(key, sizeof(key), "key %d", i);
+		str_set_insert(&a, key);
+		snprintf(key, sizeof(key), "key %d", i + 50);
+		str_set_insert(&b, key);
+	}
+	
+	// Both sets have their own copies of the keys
+	str_set_union(&a, &b);
+	str_set_destroy(&b);
+	st_check_int(a.length, 150);
+	st_check_int(str_set_contains(&a, "key 149"), true);
+	st_check_int(str_set_del(&a, "key 149"), true);
+	st_check_int(str_set_contains(&a, "key 149"), false);
+	
+	str_set_destroy(&a);
+}
+
+void test_hash_functions() {
+	// Test vectors of the FNV-1a reference and the wyhash reference implementation
+	st_check(sh_fnv1a("") == 0x811c9dc5);
+	st_check(sh_fnv1a("a") == 0xe40c292c);
+	st_check(sh_fnv1a("foobar") == 0xbf9cf968);
+	st_check(sh_wyhash("", 0, 0) == 0x93228a4de0eec5a2);
+	st_check(sh_wyhash("a", 1, 1) == 0xc5bac3db178713c4);
+	
+	// The seed changes the hash for short and long keys
+	char buffer[3001];
+	for(size_t i = 0; i < sizeof(buffer); i++)
+		buffer[i] = 'a' + (i * 7) % 26;
+	st_check(sh_wyhash(buffer, 10, 0) != sh_wyhash(buffer, 10, 1));
+	st_check(sh_xxhash(buffer, 3000, 0) != sh_xxhash(buffer, 3000, 1));
+	
+	// Unaligned keys hash the same as aligned ones (3000 bytes cover several blocks of stripes)
+	uint64_t aligned[3000 / 8];
+	memcpy(aligned, buffer + 1, sizeof(aligned));
+	st_check(sh_wyhash(buffer + 1, sizeof(aligned), 0) == sh_wyhash(aligned, sizeof(aligned), 0));
+	st_check(sh_xxhash(buffer + 1, sizeof(aligned), 0) == sh_xxhash(aligned, sizeof(aligned), 0));
+	
+	// All prefixes of the buffer get different hashes (covers every size class of both functions)
+	uint64_t wy_hashes[301], xx_hashes[301];
+	for(size_t i = 0; i < 301; i++) {
+		wy_hashes[i] = sh_wyhash(buffer, i, 0);
+		xx_hashes[i] = sh_xxhash(buffer, i, 0);
+	}
+	size_t collisions = 0;
+	for(size_t i = 0; i < 301; i++) {
+		for(size_t j = i + 1; j < 301; j++) {
+			if (wy_hashes[i] == wy_hashes[j] || xx_hashes[i] == xx_hashes[j])
+				collisions++;
+		}
+	}
+	st_check_int((int)collisions, 0);
+}
+
+void test_value_hash() {
+	// Small keys are hashed as integers, larger ones with murmur3
+	int64_t i64 = -5;
+	int32_t i32 = 7;
+	uint16_t u16 = 300;
+	char c = 'x';
+	double d = 1.5;
+	struct { int64_t a, b; } pair = { 1, 2 };
+	st_check(sh_value_hash(&i64, sizeof(i64)) == sh_int_hash((uint64_t)i64));
+	st_check(sh_value_hash(&i32, sizeof(i32)) == sh_int_hash(7));
+	st_check(sh_value_hash(&u16, sizeof(u16)) == sh_int_hash(300));
+	st_check(sh_value_hash(&c, sizeof(c)) == sh_int_hash('x'));
+	st_check(sh_value_hash(&d, sizeof(d)) != sh_value_hash(&i64, sizeof(i64)));
+	st_check(sh_value_hash(&pair, sizeof(pair)) == sh_bytes_hash(&pair, sizeof(pair)));
+	
+	// Neighboring keys and keys with the same lower bits end up in different slots
+	uint32_t mask = 1024 - 1;
+	st_check((sh_int_hash(0) & mask) != (sh_int_hash(1) & mask));
+	st_check((sh_int_hash(1024) & mask) != (sh_int_hash(2048) & mask));
+	st_check(sh_int_hash(1ULL << 32) != sh_int_hash(1));
+}
+
 void test_key_del_expr_on_hash_destroy() {
 	ket_hash_t hash;
 	ket_hash_new(&hash);
@@ -350,6 +1630,7 @@ void test_example() {
 int main() {
 	st_run(test_new_and_destroy);
 	st_run(test_put_ptr);
+	st_run(test_upsert);
 	st_run(test_get_ptr);
 	st_run(test_get_ptr_not_found);
 	st_run(test_del);
@@ -361,6 +1642,44 @@ int main() {
 	st_run(test_shrinking);
 	st_run(test_dict);
 	st_run(test_dict_update);
+	st_run(test_put_existing_key);
+	st_run(test_put_after_deleted_slot);
+	st_run(test_get_and_put_many);
+	st_run(test_resize_reuses_hashes);
+	st_run(test_incremental_resize);
+	st_run(test_incremental_churn);
+	st_run(test_incremental_remove_during_iteration);
+	st_run(test_incremental_dict);
+	st_run(test_swiss_get_and_put_many);
+	st_run(test_soa_get_and_put_many);
+	st_run(test_incremental_get_and_put_many);
+	st_run(test_new_with_capacity_and_reserve);
+	st_run(test_build_from_arrays);
+	st_run(test_failed_new_with_capacity);
+	st_run(test_rh_churn);
+	st_run(test_rh_collisions);
+	st_run(test_rh_remove_during_iteration);
+	st_run(test_rh_dict);
+	st_run(test_swiss_churn);
+	st_run(test_swiss_collisions);
+	st_run(test_swiss_remove_during_iteration);
+	st_run(test_swiss_dict);
+	st_run(test_soa_churn);
+	st_run(test_soa_iteration);
+	st_run(test_soa_dict);
+	st_run(test_str_dict);
+	st_run(test_arena_dict);
+	st_run(test_arena_dict_destroy);
+	st_run(test_sso_dict);
+	st_run(test_load_factors);
+	st_run(test_merge);
+	st_run(test_frozen);
+	st_run(test_frozen_dict);
+	st_run(test_set);
+	st_run(test_set_union_and_intersect);
+	st_run(test_str_set);
+	st_run(test_hash_functions);
+	st_run(test_value_hash);
 	st_run(test_example);
 	st_run(test_key_del_expr_on_hash_destroy);
 	return st_show_report();